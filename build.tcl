@@ -52,6 +52,15 @@ if { [info exists ::user_project_name] } {
 variable script_file
 set script_file "build.tcl"
 
+# Number of AXI CDMA engines in the block design, 1 to 4
+set num_cdma 1
+
+# Datapath of every CDMA engine: M_AXI data width in bits, longest burst in
+# beats, and the clock it runs on (pl_clk0 at 100 MHz or the MIG ui_clk)
+set cdma_data_width 128
+set cdma_burst_len 16
+set cdma_clk pl_clk0
+
 # Help information for this script
 proc print_help {} {
   variable script_file
@@ -64,6 +73,10 @@ proc print_help {} {
   puts "$script_file"
   puts "$script_file -tclargs \[--origin_dir <path>\]"
   puts "$script_file -tclargs \[--project_name <name>\]"
+  puts "$script_file -tclargs \[--num_cdma <n>\]"
+  puts "$script_file -tclargs \[--cdma_data_width <bits>\]"
+  puts "$script_file -tclargs \[--cdma_burst_len <beats>\]"
+  puts "$script_file -tclargs \[--cdma_clk <pl_clk0|ui_clk>\]"
   puts "$script_file -tclargs \[--help\]\n"
   puts "Usage:"
   puts "Name                   Description"
@@ -75,6 +88,20 @@ proc print_help {} {
   puts "\[--project_name <name>\] Create project with the specified name. Default"
   puts "                       name is the name of the project from where this"
   puts "                       script was generated.\n"
+  puts "\[--num_cdma <n>\]       Number of AXI CDMA engines, 1 to 4. Default is"
+  puts "                       1. Every engine gets its own register block at"
+  puts "                       0xA000_0000 + n * 0x1_0000 and interrupt line"
+  puts "                       pl_ps_irq0\[n\].\n"
+  puts "\[--cdma_data_width <bits>\] M_AXI data width of the CDMA engines,"
+  puts "                       32, 64, 128, 256 or 512. Default is 128. The"
+  puts "                       PS DDR side stays behind the 128 bit S_AXI_HP0.\n"
+  puts "\[--cdma_burst_len <beats>\] Longest M_AXI burst of the CDMA engines,"
+  puts "                       2 to 256, a power of 2, at most 4KB per burst."
+  puts "                       Default is 16.\n"
+  puts "\[--cdma_clk <pl_clk0|ui_clk>\] Clock of the CDMA engines and the"
+  puts "                       slave side of axi_interconnect_1. pl_clk0 (100"
+  puts "                       MHz, default) or ui_clk of the MIG (266 MHz),"
+  puts "                       which drops the clock crossing to the PL DDR4.\n"
   puts "\[--help\]               Print help information for this script"
   puts "-------------------------------------------------------------------------\n"
   exit 0
@@ -86,6 +113,10 @@ if { $::argc > 0 } {
     switch -regexp -- $option {
       "--origin_dir"   { incr i; set origin_dir [lindex $::argv $i] }
       "--project_name" { incr i; set _xil_proj_name_ [lindex $::argv $i] }
+      "--num_cdma"     { incr i; set num_cdma [lindex $::argv $i] }
+      "--cdma_data_width" { incr i; set cdma_data_width [lindex $::argv $i] }
+      "--cdma_burst_len" { incr i; set cdma_burst_len [lindex $::argv $i] }
+      "--cdma_clk"     { incr i; set cdma_clk [lindex $::argv $i] }
       "--help"         { print_help }
       default {
         if { [regexp {^-} $option] } {
@@ -97,6 +128,27 @@ if { $::argc > 0 } {
   }
 }
 
+if { ![string is integer -strict $num_cdma] || $num_cdma < 1 || $num_cdma > 4 } {
+  puts "ERROR: --num_cdma must be 1 to 4, got '$num_cdma'\n"
+  return 1
+}
+if { [lsearch -exact {32 64 128 256 512} $cdma_data_width] < 0 } {
+  puts "ERROR: --cdma_data_width must be 32, 64, 128, 256 or 512, got '$cdma_data_width'\n"
+  return 1
+}
+if { [lsearch -exact {2 4 8 16 32 64 128 256} $cdma_burst_len] < 0 } {
+  puts "ERROR: --cdma_burst_len must be a power of 2 from 2 to 256, got '$cdma_burst_len'\n"
+  return 1
+}
+if { $cdma_data_width / 8 * $cdma_burst_len > 4096 } {
+  puts "ERROR: a burst of $cdma_burst_len x $cdma_data_width bits crosses the 4KB AXI boundary\n"
+  return 1
+}
+if { [lsearch -exact {pl_clk0 ui_clk} $cdma_clk] < 0 } {
+  puts "ERROR: --cdma_clk must be pl_clk0 or ui_clk, got '$cdma_clk'\n"
+  return 1
+}
+
 # Set the directory path for the original project from where this script was exported
 set orig_proj_dir "[file normalize "$origin_dir/"]"
 
@@ -362,6 +414,9 @@ proc cr_bd_config_mpsoc { parentCell } {
   xilinx.com:ip:proc_sys_reset:5.0\
   xilinx.com:ip:zynq_ultra_ps_e:3.2\
   "
+     if { $num_cdma > 1 } {
+        append list_check_ips " xilinx.com:ip:xlconcat:2.1"
+     }
 
    set list_ips_missing ""
    common::send_msg_id "BD_TCL-006" "INFO" "Checking if the following IPs exist in the project's IP catalog: $list_check_ips ."
@@ -419,6 +474,10 @@ proc write_ddr4_file_config_mpsoc_ddr4_0_1 { str_filepath } {
 
 
   variable script_folder
+  variable num_cdma
+  variable cdma_data_width
+  variable cdma_burst_len
+  variable cdma_clk
 
   if { $parentCell eq "" } {
      set parentCell [get_bd_cells /]
@@ -458,13 +517,15 @@ proc write_ddr4_file_config_mpsoc_ddr4_0_1 { str_filepath } {
    CONFIG.POLARITY {ACTIVE_HIGH} \
  ] $reset
 
-  # Create instance: axi_cdma_0, and set properties
-  set axi_cdma_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_cdma:4.1 axi_cdma_0 ]
+  # Create instances: axi_cdma_0 .. axi_cdma_<num_cdma - 1>, and set properties
+  for {set i 0} {$i < $num_cdma} {incr i} {
+  set axi_cdma [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_cdma:4.1 axi_cdma_$i ]
   set_property -dict [ list \
    CONFIG.C_ADDR_WIDTH {40} \
-   CONFIG.C_M_AXI_DATA_WIDTH {128} \
-   CONFIG.C_M_AXI_MAX_BURST_LEN {16} \
- ] $axi_cdma_0
+   CONFIG.C_M_AXI_DATA_WIDTH $cdma_data_width \
+   CONFIG.C_M_AXI_MAX_BURST_LEN $cdma_burst_len \
+ ] $axi_cdma
+  }
 
   # Create instance: axi_interconnect_0, and set properties
   set axi_interconnect_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_interconnect:2.1 axi_interconnect_0 ]
@@ -477,13 +538,13 @@ proc write_ddr4_file_config_mpsoc_ddr4_0_1 { str_filepath } {
   set axi_interconnect_1 [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_interconnect:2.1 axi_interconnect_1 ]
   set_property -dict [ list \
    CONFIG.NUM_MI {2} \
-   CONFIG.NUM_SI {2} \
+   CONFIG.NUM_SI [expr {2 * $num_cdma}] \
  ] $axi_interconnect_1
 
   # Create instance: axi_interconnect_2, and set properties
   set axi_interconnect_2 [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_interconnect:2.1 axi_interconnect_2 ]
   set_property -dict [ list \
-   CONFIG.NUM_MI {1} \
+   CONFIG.NUM_MI $num_cdma \
  ] $axi_interconnect_2
 
   # Create instance: ddr4_0, and set properties
@@ -521,6 +582,14 @@ proc write_ddr4_file_config_mpsoc_ddr4_0_1 { str_filepath } {
    CONFIG.RESET_BOARD_INTERFACE {reset} \
  ] $ddr4_0
 
+  # Create instance: xlconcat_0, and set properties
+  if { $num_cdma > 1 } {
+  set xlconcat_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:xlconcat:2.1 xlconcat_0 ]
+  set_property -dict [ list \
+   CONFIG.NUM_PORTS $num_cdma \
+ ] $xlconcat_0
+  }
+
   # Create instance: rst_ddr4_0_266M, and set properties
   set rst_ddr4_0_266M [ create_bd_cell -type ip -vlnv xilinx.com:ip:proc_sys_reset:5.0 rst_ddr4_0_266M ]
 
@@ -1054,45 +1123,87 @@ proc write_ddr4_file_config_mpsoc_ddr4_0_1 { str_filepath } {
  ] $zynq_ultra_ps_e_0
 
   # Create interface connections
-  connect_bd_intf_net -intf_net axi_cdma_0_M_AXI [get_bd_intf_pins axi_cdma_0/M_AXI] [get_bd_intf_pins axi_interconnect_1/S00_AXI]
-  connect_bd_intf_net -intf_net axi_cdma_0_M_AXI_SG [get_bd_intf_pins axi_cdma_0/M_AXI_SG] [get_bd_intf_pins axi_interconnect_1/S01_AXI]
+  # CDMA n masters on axi_interconnect_1 S<2n> (data) and S<2n+1> (SG), its
+  # registers on axi_interconnect_2 M<n>
+  for {set i 0} {$i < $num_cdma} {incr i} {
+  set si_data [format "S%02d" [expr {2 * $i}]]
+  set si_sg [format "S%02d" [expr {2 * $i + 1}]]
+  set mi_lite [format "M%02d" $i]
+  connect_bd_intf_net -intf_net axi_cdma_${i}_M_AXI [get_bd_intf_pins axi_cdma_$i/M_AXI] [get_bd_intf_pins axi_interconnect_1/${si_data}_AXI]
+  connect_bd_intf_net -intf_net axi_cdma_${i}_M_AXI_SG [get_bd_intf_pins axi_cdma_$i/M_AXI_SG] [get_bd_intf_pins axi_interconnect_1/${si_sg}_AXI]
+  connect_bd_intf_net -intf_net axi_interconnect_2_${mi_lite}_AXI [get_bd_intf_pins axi_cdma_$i/S_AXI_LITE] [get_bd_intf_pins axi_interconnect_2/${mi_lite}_AXI]
+  }
   connect_bd_intf_net -intf_net axi_interconnect_0_M00_AXI [get_bd_intf_pins axi_interconnect_0/M00_AXI] [get_bd_intf_pins ddr4_0/C0_DDR4_S_AXI]
   connect_bd_intf_net -intf_net axi_interconnect_1_M00_AXI [get_bd_intf_pins axi_interconnect_1/M00_AXI] [get_bd_intf_pins zynq_ultra_ps_e_0/S_AXI_HP0_FPD]
   connect_bd_intf_net -intf_net axi_interconnect_1_M01_AXI [get_bd_intf_pins axi_interconnect_0/S01_AXI] [get_bd_intf_pins axi_interconnect_1/M01_AXI]
-  connect_bd_intf_net -intf_net axi_interconnect_2_M00_AXI [get_bd_intf_pins axi_cdma_0/S_AXI_LITE] [get_bd_intf_pins axi_interconnect_2/M00_AXI]
   connect_bd_intf_net -intf_net clk_300mhz_1 [get_bd_intf_ports clk_300mhz] [get_bd_intf_pins ddr4_0/C0_SYS_CLK]
   connect_bd_intf_net -intf_net ddr4_0_C0_DDR4 [get_bd_intf_ports ddr4_rtl] [get_bd_intf_pins ddr4_0/C0_DDR4]
   connect_bd_intf_net -intf_net zynq_ultra_ps_e_0_M_AXI_HPM0_FPD [get_bd_intf_pins axi_interconnect_2/S00_AXI] [get_bd_intf_pins zynq_ultra_ps_e_0/M_AXI_HPM0_FPD]
   connect_bd_intf_net -intf_net zynq_ultra_ps_e_0_M_AXI_HPM1_FPD [get_bd_intf_pins axi_interconnect_0/S00_AXI] [get_bd_intf_pins zynq_ultra_ps_e_0/M_AXI_HPM1_FPD]
 
   # Create port connections
+  if { $num_cdma == 1 } {
   connect_bd_net -net axi_cdma_0_cdma_introut [get_bd_pins axi_cdma_0/cdma_introut] [get_bd_pins zynq_ultra_ps_e_0/pl_ps_irq0]
-  connect_bd_net -net ddr4_0_c0_ddr4_ui_clk [get_bd_pins axi_interconnect_0/ACLK] [get_bd_pins axi_interconnect_0/M00_ACLK] [get_bd_pins axi_interconnect_0/S00_ACLK] [get_bd_pins axi_interconnect_0/S01_ACLK] [get_bd_pins axi_interconnect_1/M01_ACLK] [get_bd_pins ddr4_0/c0_ddr4_ui_clk] [get_bd_pins rst_ddr4_0_266M/slowest_sync_clk] [get_bd_pins zynq_ultra_ps_e_0/maxihpm1_fpd_aclk]
+  } else {
+  for {set i 0} {$i < $num_cdma} {incr i} {
+  connect_bd_net -net axi_cdma_${i}_cdma_introut [get_bd_pins axi_cdma_$i/cdma_introut] [get_bd_pins xlconcat_0/In$i]
+  }
+  connect_bd_net -net xlconcat_0_dout [get_bd_pins xlconcat_0/dout] [get_bd_pins zynq_ultra_ps_e_0/pl_ps_irq0]
+  }
   connect_bd_net -net ddr4_0_c0_ddr4_ui_clk_sync_rst [get_bd_pins ddr4_0/c0_ddr4_ui_clk_sync_rst] [get_bd_pins rst_ddr4_0_266M/ext_reset_in]
   connect_bd_net -net reset_1 [get_bd_ports reset] [get_bd_pins ddr4_0/sys_rst]
-  connect_bd_net -net rst_ddr4_0_266M_peripheral_aresetn [get_bd_pins axi_interconnect_0/ARESETN] [get_bd_pins axi_interconnect_0/M00_ARESETN] [get_bd_pins axi_interconnect_0/S00_ARESETN] [get_bd_pins axi_interconnect_0/S01_ARESETN] [get_bd_pins axi_interconnect_1/M01_ARESETN] [get_bd_pins ddr4_0/c0_ddr4_aresetn] [get_bd_pins rst_ddr4_0_266M/peripheral_aresetn]
-  connect_bd_net -net rst_ps8_0_100M_peripheral_aresetn [get_bd_pins axi_interconnect_1/ARESETN] [get_bd_pins axi_interconnect_1/M00_ARESETN] [get_bd_pins axi_interconnect_1/S00_ARESETN] [get_bd_pins axi_interconnect_1/S01_ARESETN] [get_bd_pins axi_interconnect_2/ARESETN] [get_bd_pins axi_interconnect_2/M00_ARESETN] [get_bd_pins axi_interconnect_2/S00_ARESETN] [get_bd_pins rst_ps8_0_100M/peripheral_aresetn]
-  connect_bd_net -net zynq_ultra_ps_e_0_pl_clk0 [get_bd_pins axi_cdma_0/m_axi_aclk] [get_bd_pins axi_cdma_0/s_axi_lite_aclk] [get_bd_pins axi_interconnect_1/ACLK] [get_bd_pins axi_interconnect_1/M00_ACLK] [get_bd_pins axi_interconnect_1/S00_ACLK] [get_bd_pins axi_interconnect_1/S01_ACLK] [get_bd_pins axi_interconnect_2/ACLK] [get_bd_pins axi_interconnect_2/M00_ACLK] [get_bd_pins axi_interconnect_2/S00_ACLK] [get_bd_pins rst_ps8_0_100M/slowest_sync_clk] [get_bd_pins zynq_ultra_ps_e_0/maxihpm0_fpd_aclk] [get_bd_pins zynq_ultra_ps_e_0/pl_clk0] [get_bd_pins zynq_ultra_ps_e_0/saxihp0_fpd_aclk]
+  set ui_resetn_pins [list axi_interconnect_0/ARESETN axi_interconnect_0/M00_ARESETN axi_interconnect_0/S00_ARESETN axi_interconnect_0/S01_ARESETN axi_interconnect_1/M01_ARESETN ddr4_0/c0_ddr4_aresetn rst_ddr4_0_266M/peripheral_aresetn]
+  set ui_clk_pins [list axi_interconnect_0/ACLK axi_interconnect_0/M00_ACLK axi_interconnect_0/S00_ACLK axi_interconnect_0/S01_ACLK axi_interconnect_1/M01_ACLK ddr4_0/c0_ddr4_ui_clk rst_ddr4_0_266M/slowest_sync_clk zynq_ultra_ps_e_0/maxihpm1_fpd_aclk]
+  set pl_resetn0_pins [list axi_interconnect_1/M00_ARESETN axi_interconnect_2/ARESETN axi_interconnect_2/S00_ARESETN rst_ps8_0_100M/peripheral_aresetn]
+  set pl_clk0_pins [list axi_interconnect_1/M00_ACLK axi_interconnect_2/ACLK axi_interconnect_2/S00_ACLK rst_ps8_0_100M/slowest_sync_clk zynq_ultra_ps_e_0/maxihpm0_fpd_aclk zynq_ultra_ps_e_0/pl_clk0 zynq_ultra_ps_e_0/saxihp0_fpd_aclk]
+
+  # The CDMA engines, the slave side of axi_interconnect_1 and the register
+  # ports of axi_interconnect_2 follow --cdma_clk
+  set cdma_resetn_pins [list axi_interconnect_1/ARESETN]
+  set cdma_clk_pins [list axi_interconnect_1/ACLK]
+  for {set i 0} {$i < $num_cdma} {incr i} {
+  set si_data [format "S%02d" [expr {2 * $i}]]
+  set si_sg [format "S%02d" [expr {2 * $i + 1}]]
+  set mi_lite [format "M%02d" $i]
+  lappend cdma_resetn_pins axi_interconnect_1/${si_data}_ARESETN axi_interconnect_1/${si_sg}_ARESETN axi_interconnect_2/${mi_lite}_ARESETN
+  lappend cdma_clk_pins axi_cdma_$i/m_axi_aclk axi_cdma_$i/s_axi_lite_aclk axi_interconnect_1/${si_data}_ACLK axi_interconnect_1/${si_sg}_ACLK axi_interconnect_2/${mi_lite}_ACLK
+  }
+  if { $cdma_clk eq "ui_clk" } {
+  set ui_resetn_pins [concat $ui_resetn_pins $cdma_resetn_pins]
+  set ui_clk_pins [concat $ui_clk_pins $cdma_clk_pins]
+  } else {
+  set pl_resetn0_pins [concat $pl_resetn0_pins $cdma_resetn_pins]
+  set pl_clk0_pins [concat $pl_clk0_pins $cdma_clk_pins]
+  }
+  connect_bd_net -net ddr4_0_c0_ddr4_ui_clk [get_bd_pins $ui_clk_pins]
+  connect_bd_net -net rst_ddr4_0_266M_peripheral_aresetn [get_bd_pins $ui_resetn_pins]
+  connect_bd_net -net rst_ps8_0_100M_peripheral_aresetn [get_bd_pins $pl_resetn0_pins]
+  connect_bd_net -net zynq_ultra_ps_e_0_pl_clk0 [get_bd_pins $pl_clk0_pins]
   connect_bd_net -net zynq_ultra_ps_e_0_pl_resetn0 [get_bd_pins rst_ps8_0_100M/ext_reset_in] [get_bd_pins zynq_ultra_ps_e_0/pl_resetn0]
 
   # Create address segments
-  create_bd_addr_seg -range 0x000800000000 -offset 0x004800000000 [get_bd_addr_spaces axi_cdma_0/Data] [get_bd_addr_segs ddr4_0/C0_DDR4_MEMORY_MAP/C0_DDR4_ADDRESS_BLOCK] SEG_ddr4_0_C0_DDR4_ADDRESS_BLOCK
-  create_bd_addr_seg -range 0x000800000000 -offset 0x004800000000 [get_bd_addr_spaces axi_cdma_0/Data_SG] [get_bd_addr_segs ddr4_0/C0_DDR4_MEMORY_MAP/C0_DDR4_ADDRESS_BLOCK] SEG_ddr4_0_C0_DDR4_ADDRESS_BLOCK
-  create_bd_addr_seg -range 0x80000000 -offset 0x00000000 [get_bd_addr_spaces axi_cdma_0/Data] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_DDR_LOW] SEG_zynq_ultra_ps_e_0_HP0_DDR_LOW
-  create_bd_addr_seg -range 0x80000000 -offset 0x00000000 [get_bd_addr_spaces axi_cdma_0/Data_SG] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_DDR_LOW] SEG_zynq_ultra_ps_e_0_HP0_DDR_LOW
-  create_bd_addr_seg -range 0x01000000 -offset 0xFF000000 [get_bd_addr_spaces axi_cdma_0/Data] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_LPS_OCM] SEG_zynq_ultra_ps_e_0_HP0_LPS_OCM
-  create_bd_addr_seg -range 0x01000000 -offset 0xFF000000 [get_bd_addr_spaces axi_cdma_0/Data_SG] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_LPS_OCM] SEG_zynq_ultra_ps_e_0_HP0_LPS_OCM
-  create_bd_addr_seg -range 0x20000000 -offset 0xC0000000 [get_bd_addr_spaces axi_cdma_0/Data] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_QSPI] SEG_zynq_ultra_ps_e_0_HP0_QSPI
-  create_bd_addr_seg -range 0x20000000 -offset 0xC0000000 [get_bd_addr_spaces axi_cdma_0/Data_SG] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_QSPI] SEG_zynq_ultra_ps_e_0_HP0_QSPI
-  create_bd_addr_seg -range 0x00010000 -offset 0xA0000000 [get_bd_addr_spaces zynq_ultra_ps_e_0/Data] [get_bd_addr_segs axi_cdma_0/S_AXI_LITE/Reg] SEG_axi_cdma_0_Reg
+  for {set i 0} {$i < $num_cdma} {incr i} {
+  foreach space {Data Data_SG} {
+  create_bd_addr_seg -range 0x000800000000 -offset 0x004800000000 [get_bd_addr_spaces axi_cdma_$i/$space] [get_bd_addr_segs ddr4_0/C0_DDR4_MEMORY_MAP/C0_DDR4_ADDRESS_BLOCK] SEG_ddr4_0_C0_DDR4_ADDRESS_BLOCK
+  create_bd_addr_seg -range 0x80000000 -offset 0x00000000 [get_bd_addr_spaces axi_cdma_$i/$space] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_DDR_LOW] SEG_zynq_ultra_ps_e_0_HP0_DDR_LOW
+  create_bd_addr_seg -range 0x01000000 -offset 0xFF000000 [get_bd_addr_spaces axi_cdma_$i/$space] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_LPS_OCM] SEG_zynq_ultra_ps_e_0_HP0_LPS_OCM
+  create_bd_addr_seg -range 0x20000000 -offset 0xC0000000 [get_bd_addr_spaces axi_cdma_$i/$space] [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_QSPI] SEG_zynq_ultra_ps_e_0_HP0_QSPI
+  }
+  create_bd_addr_seg -range 0x00010000 -offset [format "0x%08X" [expr {0xA0000000 + $i * 0x10000}]] [get_bd_addr_spaces zynq_ultra_ps_e_0/Data] [get_bd_addr_segs axi_cdma_$i/S_AXI_LITE/Reg] SEG_axi_cdma_${i}_Reg
+  }
   create_bd_addr_seg -range 0x000800000000 -offset 0x004800000000 [get_bd_addr_spaces zynq_ultra_ps_e_0/Data] [get_bd_addr_segs ddr4_0/C0_DDR4_MEMORY_MAP/C0_DDR4_ADDRESS_BLOCK] SEG_ddr4_0_C0_DDR4_ADDRESS_BLOCK
 
   # Exclude Address Segments
-  create_bd_addr_seg -range 0x00010000 -offset 0xA0000000 [get_bd_addr_spaces axi_cdma_0/Data] [get_bd_addr_segs axi_cdma_0/S_AXI_LITE/Reg] SEG_axi_cdma_0_Reg
-  exclude_bd_addr_seg [get_bd_addr_segs axi_cdma_0/Data/SEG_axi_cdma_0_Reg]
+  # The CDMA register blocks are only for the PS, not for any CDMA
+  for {set i 0} {$i < $num_cdma} {incr i} {
+  foreach space {Data Data_SG} {
+  for {set j 0} {$j < $num_cdma} {incr j} {
+  create_bd_addr_seg -range 0x00010000 -offset [format "0x%08X" [expr {0xA0000000 + $j * 0x10000}]] [get_bd_addr_spaces axi_cdma_$i/$space] [get_bd_addr_segs axi_cdma_$j/S_AXI_LITE/Reg] SEG_axi_cdma_${j}_Reg
+  exclude_bd_addr_seg [get_bd_addr_segs axi_cdma_$i/$space/SEG_axi_cdma_${j}_Reg]
 
-  create_bd_addr_seg -range 0x00010000 -offset 0xA0000000 [get_bd_addr_spaces axi_cdma_0/Data_SG] [get_bd_addr_segs axi_cdma_0/S_AXI_LITE/Reg] SEG_axi_cdma_0_Reg
-  exclude_bd_addr_seg [get_bd_addr_segs axi_cdma_0/Data_SG/SEG_axi_cdma_0_Reg]
+  }
+  }
+  }
 
 
 
@@ -0,0 +1,64 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sim_platform.h
+ *
+ * Stand-ins for the parts of the Xilinx standalone BSP that the SODIMM tester
+ * uses, so that sdk_src/ builds on a Linux host against the simulated HAL
+ * backend in sodimm_hal_sim.c.
+ *
+ * The address map matches the ZCU104 design in build.tcl. The PL DDR4 window
+ * is smaller than the real 32 GB so a full sweep finishes in seconds; build
+ * with -DSIM_PL_DDR4_SIZE=<bytes> to change it.
+ *
+ ****************************************************************************/
+#ifndef SIM_PLATFORM_H
+#define SIM_PLATFORM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**************************** Type Definitions *******************************/
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef uintptr_t UINTPTR;
+
+/******************** Constant Definitions **********************************/
+
+#define XST_SUCCESS		0L
+#define XST_FAILURE		1L
+
+#ifndef SIM_PL_DDR4_SIZE
+#define SIM_PL_DDR4_SIZE	0x10000000UL	/* 256 MB */
+#endif
+
+#define XPAR_AXICDMA_0_DEVICE_ID		0
+#define XPAR_PSU_OCM_RAM_0_S_AXI_BASEADDR	0xFFFC0000UL
+#define XPAR_PSU_OCM_RAM_0_S_AXI_HIGHADDR	0xFFFFFFFFUL
+#define XPAR_PSU_DDR_0_S_AXI_BASEADDR		0x00000000UL
+#define XPAR_PSU_DDR_0_S_AXI_HIGHADDR		0x7FFFFFFFUL
+#define XPAR_DDR4_0_BASEADDR			0x4800000000UL
+#define XPAR_DDR4_0_HIGHADDR	(XPAR_DDR4_0_BASEADDR + SIM_PL_DDR4_SIZE - 1)
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+#define XDBG_DEBUG_ERROR	0x00000001
+#ifdef DEBUG
+#define xdbg_printf(type, ...)	fprintf(stderr, __VA_ARGS__)
+#else
+#define xdbg_printf(type, ...)
+#endif
+
+/************************** Function Prototypes ******************************/
+
+void xil_printf(const char *format, ...);
+
+#endif /* SIM_PLATFORM_H */
@@ -0,0 +1,306 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_benchcmp.c
+ *
+ * Comparison of two runs of the kernel benchmark, kernel_benchmark in
+ * helloworld.c.
+ *
+ *   sodimm_benchcmp [-t pct] [-v] baseline results
+ *
+ * Both files are read for their "kbench," lines, so a whole console log of
+ * the board works as well as the output of ./sodimm_bench. Single results
+ * move by tens of percent between two runs of the same code, so they are
+ * only listed, those outside pct percent and those missing from either
+ * run; -v lists every result. The gate is per kernel: the geometric mean
+ * of the now / baseline time ratios of its results, over the host drift,
+ * the median ratio of all results. A kernel more than pct percent
+ * (default CMP_DEFAULT_TOLERANCE) slower than the drift regressed.
+ * Results under CMP_MIN_NS per call in the baseline are too short to time
+ * and left out.
+ *
+ * The drift takes out a host that runs the whole benchmark faster or
+ * slower, which a shared build host does by a third between two runs. It
+ * also takes out a change that slows every kernel alike; the drift line
+ * shows that one.
+ *
+ * Exits with 0 if no kernel regressed, 1 if one did or a file could not
+ * be read.
+ *
+ ****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************** Constant Definitions **********************************/
+
+#define CMP_DEFAULT_TOLERANCE	50	/* percent */
+#define CMP_LINE_LEN		256
+#define CMP_MIN_NS		1000UL	/* shorter results are not gated */
+#define CMP_MAX_KERNELS		32
+
+/**************************** Type Definitions *******************************/
+
+/* One result line of the kernel benchmark */
+typedef struct {
+	char Kernel[32];
+	char Mode[8];		/* pattern mode, "-" for a kernel without */
+	unsigned long Bytes;
+	unsigned long Calls;
+	unsigned long Ns;	/* per call */
+	unsigned long MBps;
+	int Matched;
+} CmpResult;
+
+typedef struct {
+	CmpResult *Results;
+	unsigned int Count;
+} CmpRun;
+
+/* Geometric mean of the time ratios of one kernel */
+typedef struct {
+	const char *Kernel;
+	double LogSum;		/* of now / baseline */
+	unsigned int Count;
+	unsigned int Short;	/* results under CMP_MIN_NS, left out */
+} CmpKernel;
+
+/*****************************************************************************/
+
+static int LoadRun(const char *Path, CmpRun *RunPtr)
+{
+	char Line[CMP_LINE_LEN];
+	CmpResult Result;
+	FILE *File;
+
+	File = fopen(Path, "r");
+	if (File == NULL) {
+		perror(Path);
+		return -1;
+	}
+
+	memset(RunPtr, 0, sizeof(*RunPtr));
+	memset(&Result, 0, sizeof(Result));
+	while (fgets(Line, sizeof(Line), File) != NULL) {
+		/* The header line fails on the numeric fields */
+		if (sscanf(Line, "kbench,%31[^,],%7[^,],%lu,%lu,%lu,%lu",
+				Result.Kernel, Result.Mode, &Result.Bytes,
+				&Result.Calls, &Result.Ns, &Result.MBps) != 6) {
+			continue;
+		}
+
+		RunPtr->Results = realloc(RunPtr->Results,
+			(RunPtr->Count + 1) * sizeof(CmpResult));
+		if (RunPtr->Results == NULL) {
+			fprintf(stderr, "out of memory\n");
+			fclose(File);
+			return -1;
+		}
+		RunPtr->Results[RunPtr->Count++] = Result;
+	}
+	fclose(File);
+
+	if (RunPtr->Count == 0) {
+		fprintf(stderr, "%s: no kernel benchmark results\n", Path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static CmpResult *FindResult(CmpRun *RunPtr, const CmpResult *Key)
+{
+	unsigned int Index;
+
+	for (Index = 0; Index < RunPtr->Count; Index++) {
+		if (RunPtr->Results[Index].Bytes == Key->Bytes &&
+		    strcmp(RunPtr->Results[Index].Kernel, Key->Kernel) == 0 &&
+		    strcmp(RunPtr->Results[Index].Mode, Key->Mode) == 0) {
+			return &RunPtr->Results[Index];
+		}
+	}
+
+	return NULL;
+}
+
+static int CompareRatio(const void *A, const void *B)
+{
+	double Diff = *(const double *)A - *(const double *)B;
+
+	return (Diff > 0) - (Diff < 0);
+}
+
+static CmpKernel *FindKernel(CmpKernel *Kernels, unsigned int *NumKernels,
+		const char *Name)
+{
+	unsigned int Index;
+
+	for (Index = 0; Index < *NumKernels; Index++) {
+		if (strcmp(Kernels[Index].Kernel, Name) == 0) {
+			return &Kernels[Index];
+		}
+	}
+	if (*NumKernels == CMP_MAX_KERNELS) {
+		return NULL;
+	}
+
+	memset(&Kernels[*NumKernels], 0, sizeof(CmpKernel));
+	Kernels[*NumKernels].Kernel = Name;
+
+	return &Kernels[(*NumKernels)++];
+}
+
+static void PrintResult(const CmpResult *Result, const CmpResult *Base,
+		const char *Verdict)
+{
+	printf("%-10s  %4s  %9lu  ", Result->Kernel, Result->Mode,
+		Result->Bytes);
+	if (Base == NULL) {
+		printf("%12s  %12lu  %7s  %s\n", "-", Result->Ns, "-", Verdict);
+	} else {
+		printf("%12lu  %12lu  %+6.1f%%  %s\n", Base->Ns, Result->Ns,
+			Base->Ns ? 100.0 * ((double)Result->Ns - Base->Ns) /
+			Base->Ns : 0.0, Verdict);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *Paths[2];
+	CmpRun Base;
+	CmpRun Run;
+	CmpResult *Result;
+	CmpResult *BaseResult;
+	CmpKernel Kernels[CMP_MAX_KERNELS];
+	CmpKernel *Kernel;
+	double *Ratios;
+	unsigned int NumRatios = 0;
+	double Drift = 0.0;
+	unsigned long Tolerance = CMP_DEFAULT_TOLERANCE;
+	unsigned int NumPaths = 0;
+	unsigned int NumKernels = 0;
+	unsigned int Slower = 0;
+	unsigned int Faster = 0;
+	unsigned int New = 0;
+	unsigned int Missing = 0;
+	unsigned int Regressed = 0;
+	unsigned int Index;
+	double Change;
+	const char *Verdict;
+	int Verbose = 0;
+	int Arg;
+
+	for (Arg = 1; Arg < argc; Arg++) {
+		if (strcmp(argv[Arg], "-t") == 0 && Arg + 1 < argc) {
+			Tolerance = strtoul(argv[++Arg], NULL, 0);
+		} else if (strcmp(argv[Arg], "-v") == 0) {
+			Verbose = 1;
+		} else if (argv[Arg][0] != '-' && NumPaths < 2) {
+			Paths[NumPaths++] = argv[Arg];
+		} else {
+			NumPaths = 0;
+			break;
+		}
+	}
+	if (NumPaths != 2) {
+		fprintf(stderr, "usage: %s [-t pct] [-v] baseline results\n",
+			argv[0]);
+		return 2;
+	}
+
+	if (LoadRun(Paths[0], &Base) || LoadRun(Paths[1], &Run)) {
+		return 1;
+	}
+	Ratios = malloc(Run.Count * sizeof(double));
+	if (Ratios == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	printf("kernel      mode      bytes   baseline ns       now ns   change\n");
+	for (Index = 0; Index < Run.Count; Index++) {
+		Result = &Run.Results[Index];
+		BaseResult = FindResult(&Base, Result);
+		if (BaseResult == NULL) {
+			New++;
+			PrintResult(Result, NULL, "not in baseline");
+			continue;
+		}
+		BaseResult->Matched = 1;
+
+		Kernel = FindKernel(Kernels, &NumKernels, Result->Kernel);
+		if (Kernel != NULL && BaseResult->Ns < CMP_MIN_NS) {
+			Kernel->Short++;
+		} else if (Kernel != NULL) {
+			Ratios[NumRatios] = log((double)(Result->Ns ? Result->Ns : 1) /
+				BaseResult->Ns);
+			Kernel->LogSum += Ratios[NumRatios++];
+			Kernel->Count++;
+		}
+
+		if (Result->Ns * 100 > BaseResult->Ns * (100 + Tolerance)) {
+			Slower++;
+			Verdict = "SLOWER";
+		} else if (Result->Ns * (100 + Tolerance) < BaseResult->Ns * 100) {
+			Faster++;
+			Verdict = "faster";
+		} else if (Verbose) {
+			Verdict = "";
+		} else {
+			continue;
+		}
+		PrintResult(Result, BaseResult, Verdict);
+	}
+
+	for (Index = 0; Index < Base.Count; Index++) {
+		if (!Base.Results[Index].Matched) {
+			Missing++;
+			printf("%-10s  %4s  %9lu  %12lu  %12s  %7s  not measured\n",
+				Base.Results[Index].Kernel, Base.Results[Index].Mode,
+				Base.Results[Index].Bytes, Base.Results[Index].Ns, "-",
+				"-");
+		}
+	}
+
+	printf("\n%u results, %u slower and %u faster than the baseline by more "
+		"than %lu%%, %u not in the baseline, %u not measured\n",
+		Run.Count, Slower, Faster, Tolerance, New, Missing);
+
+	if (NumRatios > 0) {
+		qsort(Ratios, NumRatios, sizeof(double), CompareRatio);
+		Drift = Ratios[NumRatios / 2];
+	}
+	printf("\nhost drift %+.1f%%, the median change of %u results\n",
+		100.0 * (exp(Drift) - 1.0), NumRatios);
+
+	printf("\nkernel      results  short   change  over drift\n");
+	for (Index = 0; Index < NumKernels; Index++) {
+		Kernel = &Kernels[Index];
+		if (Kernel->Count == 0) {
+			printf("%-10s  %7u  %5u  %7s  %10s\n", Kernel->Kernel, 0,
+				Kernel->Short, "-", "-");
+			continue;
+		}
+
+		Change = 100.0 * (exp(Kernel->LogSum / Kernel->Count - Drift) -
+			1.0);
+		Verdict = "";
+		if (Change > (double)Tolerance) {
+			Regressed++;
+			Verdict = "  SLOWER";
+		}
+		printf("%-10s  %7u  %5u  %+6.1f%%  %+9.1f%%%s\n", Kernel->Kernel,
+			Kernel->Count, Kernel->Short,
+			100.0 * (exp(Kernel->LogSum / Kernel->Count) - 1.0), Change,
+			Verdict);
+	}
+	printf("\n%u of %u kernels slower than the drift by more than %lu%%\n",
+		Regressed, NumKernels, Tolerance);
+
+	free(Ratios);
+	free(Base.Results);
+	free(Run.Results);
+
+	return Regressed ? 1 : 0;
+}
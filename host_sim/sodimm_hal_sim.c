@@ -0,0 +1,1096 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_hal_sim.c
+ *
+ * Linux backend of the SODIMM tester HAL.
+ *
+ * The three address windows the tester uses are backed by lazily populated
+ * anonymous mappings:
+ *
+ *   PS DDR   0x0000_0000 - 0x7FFF_FFFF   (TX/RX buffers at 0x0100_0000)
+ *   OCM      0xFFFC_0000 - 0xFFFF_FFFF   (BD space)
+ *   PL DDR4  0x48_0000_0000 + SIM_PL_DDR4_SIZE
+ *
+ * The BD ring is laid out in the OCM window with the AXI CDMA descriptor
+ * format. A worker thread plays the part of the CDMA: it walks the BDs handed
+ * to hardware, does the copy and stamps each BD with the time at which the
+ * modeled transfer ends. A BD is only reported complete once that time has
+ * passed, so the CPU sees the same overlap it would see on the board.
+ *
+ * The model is serial per engine:
+ *
+ *   Done = max(Now, EngineBusyUntil) + LatencyNs + Length / Bandwidth
+ *
+ * Bandwidth and latency are set with the SIM_CDMA_MBPS (0 means unlimited)
+ * and SIM_CDMA_LATENCY_NS environment variables.
+ *
+ * SIM_CDMA_CLK_MHZ (default 0, off) adds the AXI datapath of build.tcl:
+ * a BD is cut into bursts of SIM_CDMA_BURST_LEN beats of
+ * SIM_CDMA_DATA_WIDTH bits (default 16 x 128), each of which takes its
+ * beats plus SIM_CDMA_BURST_GAP_CLKS clocks, and the slower of that and
+ * Length / Bandwidth sets the BD time.
+ *
+ * SIM_CDMAS engines (default HAL_MAX_CDMAS) run side by side, each with its
+ * own thread, BD ring and OCM slice, like the --num_cdma designs of
+ * build.tcl. They share the PL DDR4: every BD side that touches it also
+ * books its bytes on a calendar of SIM_DIMM_SLOT_NS slots that hold
+ * SIM_DIMM_MBPS worth of bytes each, from its start on, and is not done
+ * before the slot its last byte lands in. The engines stamp BDs ahead of
+ * real time in any order, so the calendar is what keeps them from each
+ * claiming the whole DIMM. SIM_DIMM_MBPS defaults to the peak of the 64-bit
+ * bus at the 2133 MT/s build.tcl clocks the MIG at.
+ *
+ * The PL DDR4 keeps one open row per bank, decoded with sodimm_geometry.c.
+ * A BD whose first burst finds another row open in its bank pays
+ * SIM_DRAM_ROW_MISS_NS on top (tRP + tRCD of the cfg-32gb.csv part by
+ * default, 0 turns the model off). Bursts past the first, tRRD and tFAW are
+ * not modeled.
+ *
+ * Interrupt driven completion (Hal_CdmaIntrEnable) is modeled by a second
+ * thread standing in for the CDMA interrupt line and the ISR. It fires on
+ * every Threshold-th BD to pass its DoneNs, or Delay x 125 AXI clocks
+ * (100 MHz) after the last completion if fewer are left, reaps and calls
+ * the DoneFn. Hal_CdmaWaitIntr is a cond wait.
+ *
+ * Hal_PersistStore writes a file, SIM_CHECKPOINT (default sodimm_sim.ckpt in
+ * the working directory), so the state outlives the process like the
+ * reserved PS DDR does a board reset. The result stream of Hal_LogWrite
+ * goes to SIM_LOG (default sodimm_sim.log), the file
+ * sodimm_logdump decodes.
+ *
+ * Hal_CpuRun starts one thread per modeled A53 core. SIM_CPUS sets how many
+ * (default and maximum HAL_MAX_CPUS).
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sodimm_geometry.h"
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+#define SIM_CDMA_DEFAULT_MBPS		2400
+#define SIM_CDMA_DEFAULT_LATENCY_NS	250
+#define SIM_CDMA_DEFAULT_DATA_WIDTH	128
+#define SIM_CDMA_DEFAULT_BURST_LEN	16
+#define SIM_CDMA_BURST_GAP_CLKS		2	/* address phase between bursts */
+#define SIM_DRAM_DEFAULT_ROW_MISS_NS	27	/* tRP + tRCD, 13.5 ns each */
+#define SIM_DIMM_DEFAULT_MBPS		17066	/* 2133 MT/s x 8 bytes */
+#define SIM_DIMM_SLOT_NS		1000
+#define SIM_DIMM_SLOTS			16384	/* calendar horizon, 16 ms */
+#define SIM_DEFAULT_CHECKPOINT		"sodimm_sim.ckpt"
+#define SIM_DEFAULT_LOG			"sodimm_sim.log"
+
+/* One unit of the coalescing delay timer: 125 clocks of a 100 MHz AXI clock */
+#define SIM_INTR_DELAY_UNIT_NS		1250
+
+#define SIM_OCM_BASE	XPAR_PSU_OCM_RAM_0_S_AXI_BASEADDR
+#define SIM_OCM_SIZE	(XPAR_PSU_OCM_RAM_0_S_AXI_HIGHADDR - SIM_OCM_BASE + 1)
+
+#define SIM_BD_ALIGNMENT	0x40
+
+/* BD status bits, as in the AXI CDMA descriptor */
+#define SIM_BD_STS_COMPLETE_MASK	0x80000000
+#define SIM_BD_STS_DEC_ERR_MASK		0x40000000
+#define SIM_BD_STS_ALL_ERR_MASK		0x70000000
+
+/**************************** Type Definitions *******************************/
+
+/* Same offsets as the AXI CDMA SG descriptor. DoneNs is kept in the words
+ * the hardware leaves to software.
+ */
+typedef struct {
+	u64 NextDesc;		/* 0x00 */
+	u64 SrcAddr;		/* 0x08 */
+	u64 DstAddr;		/* 0x10 */
+	u32 Control;		/* 0x18, transfer length */
+	u32 Status;		/* 0x1C */
+	u64 DoneNs;		/* 0x20, end of the modeled transfer */
+	u32 Pad[6];
+} SimBd;
+
+typedef struct {
+	UINTPTR Base;
+	u64 Size;
+	const char *Name;
+	u8 *HostPtr;
+} SimWindow;
+
+struct HalCdma {
+	u16 DeviceId;
+	pthread_t Thread;
+	pthread_mutex_t Lock;
+	pthread_cond_t Cond;
+
+	SimBd *Ring;		/* BD ring in the OCM window */
+	u32 BdCount;
+	u32 ChainBds;		/* BDs per chain, 0 if no chains are built */
+	u32 ChainLength;	/* bytes per BD in a chain */
+	u64 SubmitCnt;		/* BDs handed to hardware */
+	u64 EngineCnt;		/* BDs the engine has processed */
+	u64 ReapCnt;		/* BDs returned to software */
+	int Busy;		/* engine is processing a BD */
+	int ResetWait;		/* SimResetLocked waits for the BD to finish */
+	u32 Error;		/* engine halted on a bus error */
+
+	UINTPTR RingBase;	/* OCM slice of this engine */
+	u32 RingSpace;
+
+	u64 BusyUntilNs;
+	u64 MBps;
+	u64 LatencyNs;
+	HalDatapath Datapath;
+
+	pthread_t IrqThread;
+	pthread_cond_t IrqCond;	/* signaled after every DoneFn call */
+	int IrqStarted;
+	int IntrEnabled;
+	int IntrErrorSent;	/* the error was reported, wait for a reset */
+	u64 IntrMark;		/* completions counted by interrupts so far */
+	u64 IntrLastNs;		/* DoneNs of the last completion seen */
+	u32 Threshold;
+	u64 DelayNs;
+	HalCdmaDoneFn DoneFn;
+	void *DoneRef;
+};
+
+/* Bytes booked on the DIMM during slot Epoch, i.e. from Epoch *
+ * SIM_DIMM_SLOT_NS on
+ */
+typedef struct {
+	u64 Epoch;
+	u64 Bytes;
+} SimDimmSlot;
+
+/* The PL DDR4 behind all engines */
+typedef struct {
+	pthread_mutex_t Lock;
+	u64 MBps;
+	u64 RowMissNs;
+	u32 OpenRow[GEOM_NUM_BANKS];	/* row + 1 open in each bank, 0 if none */
+	SimDimmSlot Slot[SIM_DIMM_SLOTS];
+} SimDimm;
+
+/************************** Variable Definitions *****************************/
+
+static SimWindow SimWindows[] = {
+	{ XPAR_PSU_DDR_0_S_AXI_BASEADDR,
+	  XPAR_PSU_DDR_0_S_AXI_HIGHADDR - XPAR_PSU_DDR_0_S_AXI_BASEADDR + 1,
+	  "PS DDR", NULL },
+	{ SIM_OCM_BASE, SIM_OCM_SIZE, "OCM", NULL },
+	{ XPAR_DDR4_0_BASEADDR, SIM_PL_DDR4_SIZE, "PL DDR4", NULL },
+};
+
+#define SIM_NUM_WINDOWS	(sizeof(SimWindows) / sizeof(SimWindows[0]))
+
+static HalCdma SimCdmaInstance[HAL_MAX_CDMAS];
+static int SimCdmaStarted[HAL_MAX_CDMAS];
+
+static SimDimm SimDimmState = { PTHREAD_MUTEX_INITIALIZER };
+
+/*****************************************************************************/
+
+void xil_printf(const char *format, ...)
+{
+	va_list Args;
+
+	va_start(Args, format);
+	vprintf(format, Args);
+	va_end(Args);
+}
+
+static u64 SimNowNs(void)
+{
+	struct timespec Ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &Ts);
+	return (u64)Ts.tv_sec * 1000000000ULL + (u64)Ts.tv_nsec;
+}
+
+static u64 SimEnv(const char *Name, u64 Default)
+{
+	const char *Value = getenv(Name);
+
+	return Value ? strtoull(Value, NULL, 0) : Default;
+}
+
+static void SimMemInit(void)
+{
+	static int Mapped;
+	unsigned int Index;
+
+	if (Mapped) {
+		return;
+	}
+
+	for (Index = 0; Index < SIM_NUM_WINDOWS; Index++) {
+		void *Ptr = mmap(NULL, SimWindows[Index].Size,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+		if (Ptr == MAP_FAILED) {
+			fprintf(stderr, "sim: cannot map %s window\n",
+				SimWindows[Index].Name);
+			abort();
+		}
+		SimWindows[Index].HostPtr = Ptr;
+	}
+	Mapped = 1;
+}
+
+/* Translate a bus address range to a host pointer, or NULL if the range is
+ * not fully inside one window.
+ */
+static void *SimTranslate(UINTPTR Addr, u64 Length)
+{
+	unsigned int Index;
+
+	SimMemInit();
+	for (Index = 0; Index < SIM_NUM_WINDOWS; Index++) {
+		SimWindow *Win = &SimWindows[Index];
+
+		if (Addr >= Win->Base && Addr - Win->Base < Win->Size &&
+		    Length <= Win->Size - (Addr - Win->Base)) {
+			return Win->HostPtr + (Addr - Win->Base);
+		}
+	}
+
+	return NULL;
+}
+
+/*****************************************************************************/
+/**
+* CPU view of a bus address. An access outside the modeled windows would be
+* a data abort on the board, so it aborts here too.
+*
+******************************************************************************/
+void *Hal_Ptr(UINTPTR Addr)
+{
+	void *Ptr = SimTranslate(Addr, 1);
+
+	if (Ptr == NULL) {
+		fprintf(stderr, "sim: CPU access to unmapped address 0x%lx\n",
+			(unsigned long)Addr);
+		abort();
+	}
+
+	return Ptr;
+}
+
+/* Book one BD side at Addr on the DIMM from Start on, opening its row.
+ * Returns Done pushed out by a row miss and by the booking.
+ */
+static u64 SimDimmAccess(UINTPTR Addr, u64 Length, u64 Start, u64 Done)
+{
+	SimDimm *DimmPtr = &SimDimmState;
+	SimDimmSlot *SlotPtr;
+	GeomCoord Coord;
+	u64 SlotBytes;
+	u64 Epoch;
+	u64 Take;
+	u32 Bank;
+
+	if (Addr < XPAR_DDR4_0_BASEADDR || Addr > XPAR_DDR4_0_HIGHADDR) {
+		return Done;
+	}
+
+	pthread_mutex_lock(&DimmPtr->Lock);
+	if (DimmPtr->RowMissNs) {
+		Geom_Decode(Addr - XPAR_DDR4_0_BASEADDR, &Coord);
+		Bank = Geom_BankIndex(&Coord);
+		if (DimmPtr->OpenRow[Bank] != Coord.Row + 1U) {
+			DimmPtr->OpenRow[Bank] = Coord.Row + 1U;
+			Done += DimmPtr->RowMissNs;
+		}
+	}
+	if (DimmPtr->MBps) {
+		SlotBytes = DimmPtr->MBps * SIM_DIMM_SLOT_NS / 1000;
+		Epoch = Start / SIM_DIMM_SLOT_NS;
+		for (;;) {
+			SlotPtr = &DimmPtr->Slot[Epoch % SIM_DIMM_SLOTS];
+			if (SlotPtr->Epoch != Epoch) {
+				SlotPtr->Epoch = Epoch;
+				SlotPtr->Bytes = 0;
+			}
+			Take = SlotBytes - SlotPtr->Bytes;
+			if (Take >= Length) {
+				SlotPtr->Bytes += Length;
+				break;
+			}
+			SlotPtr->Bytes = SlotBytes;
+			Length -= Take;
+			Epoch++;
+		}
+		Start = Epoch * SIM_DIMM_SLOT_NS +
+			SlotPtr->Bytes * SIM_DIMM_SLOT_NS / SlotBytes;
+		if (Done < Start) {
+			Done = Start;
+		}
+	}
+	pthread_mutex_unlock(&DimmPtr->Lock);
+
+	return Done;
+}
+
+/* Time the engine moves Length bytes in, the slower of the bandwidth
+ * limit and the datapath.
+ */
+static u64 SimXferNs(const HalCdma *InstancePtr, u64 Length)
+{
+	const HalDatapath *PathPtr = &InstancePtr->Datapath;
+	u64 BurstBytes = (u64)PathPtr->DataWidth / 8 * PathPtr->BurstLen;
+	u64 Ns = 0;
+	u64 PathNs;
+
+	if (InstancePtr->MBps) {
+		Ns = Length * 1000 / InstancePtr->MBps;
+	}
+	if (PathPtr->ClockMHz && BurstBytes) {
+		PathNs = (Length + BurstBytes - 1) / BurstBytes *
+			(PathPtr->BurstLen + SIM_CDMA_BURST_GAP_CLKS) * 1000 /
+			PathPtr->ClockMHz;
+		if (PathNs > Ns) {
+			Ns = PathNs;
+		}
+	}
+
+	return Ns;
+}
+
+/*****************************************************************************/
+/*
+* The engine thread. Processes BDs in ring order until it hits an error, in
+* which case it halts like the CDMA does until it is reset.
+*
+******************************************************************************/
+static void *SimEngine(void *Arg)
+{
+	HalCdma *InstancePtr = Arg;
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	for (;;) {
+		SimBd *BdPtr;
+		void *Src;
+		void *Dst;
+		u64 Length;
+		u64 Start;
+		u64 Done;
+
+		while (InstancePtr->Error ||
+		       InstancePtr->EngineCnt == InstancePtr->SubmitCnt) {
+			pthread_cond_wait(&InstancePtr->Cond, &InstancePtr->Lock);
+		}
+
+		BdPtr = &InstancePtr->Ring[InstancePtr->EngineCnt %
+			InstancePtr->BdCount];
+		InstancePtr->Busy = 1;
+		pthread_mutex_unlock(&InstancePtr->Lock);
+
+		Length = BdPtr->Control;
+		Src = SimTranslate(BdPtr->SrcAddr, Length);
+		Dst = SimTranslate(BdPtr->DstAddr, Length);
+		if (Src != NULL && Dst != NULL) {
+			memmove(Dst, Src, Length);
+		}
+
+		Start = SimNowNs();
+		if (Start < InstancePtr->BusyUntilNs) {
+			Start = InstancePtr->BusyUntilNs;
+		}
+		Done = Start + InstancePtr->LatencyNs +
+			SimXferNs(InstancePtr, Length);
+		Done = SimDimmAccess(BdPtr->SrcAddr, Length, Start, Done);
+		Done = SimDimmAccess(BdPtr->DstAddr, Length, Start, Done);
+		InstancePtr->BusyUntilNs = Done;
+
+		pthread_mutex_lock(&InstancePtr->Lock);
+		InstancePtr->Busy = 0;
+		BdPtr->DoneNs = Done;
+		if (Src == NULL || Dst == NULL) {
+			BdPtr->Status = SIM_BD_STS_COMPLETE_MASK |
+				SIM_BD_STS_DEC_ERR_MASK;
+			InstancePtr->Error = 1;
+		} else {
+			BdPtr->Status = SIM_BD_STS_COMPLETE_MASK;
+		}
+		InstancePtr->EngineCnt++;
+
+		/* Every wakeup of a waiting thread costs a host context switch,
+		 * which on a shared core would be charged to the engine. Only
+		 * signal at the end of a chain, when the queue runs dry, on an
+		 * error or when a reset is waiting.
+		 */
+		if (InstancePtr->Error || InstancePtr->ResetWait ||
+		    InstancePtr->EngineCnt == InstancePtr->SubmitCnt ||
+		    (InstancePtr->ChainBds &&
+		     InstancePtr->EngineCnt % InstancePtr->ChainBds == 0)) {
+			pthread_cond_broadcast(&InstancePtr->Cond);
+		}
+	}
+
+	return NULL;
+}
+
+/* The engine stands in for hardware that runs next to the CPU. Keep it
+ * from preempting the test thread when both share a host core, so CPU-side
+ * stage timings are not inflated by the model doing its copies.
+ */
+static void SimEngineSchedule(pthread_t Thread)
+{
+	struct sched_param Param;
+
+	memset(&Param, 0, sizeof(Param));
+	pthread_setschedparam(Thread, SCHED_IDLE, &Param);
+}
+
+/* Drop everything in flight and clear the error state. Called with the
+ * lock held.
+ */
+static void SimResetLocked(HalCdma *InstancePtr)
+{
+	InstancePtr->ResetWait = 1;
+	while (InstancePtr->Busy) {
+		pthread_cond_wait(&InstancePtr->Cond, &InstancePtr->Lock);
+	}
+	InstancePtr->ResetWait = 0;
+
+	InstancePtr->SubmitCnt = 0;
+	InstancePtr->EngineCnt = 0;
+	InstancePtr->ReapCnt = 0;
+	InstancePtr->Error = 0;
+	InstancePtr->IntrErrorSent = 0;
+	InstancePtr->IntrMark = 0;
+	InstancePtr->IntrLastNs = 0;
+	InstancePtr->BusyUntilNs = 0;
+}
+
+HalCdma *Hal_CdmaInitialize(u16 DeviceId)
+{
+	u32 Engine = DeviceId - XPAR_AXICDMA_0_DEVICE_ID;
+	HalCdma *InstancePtr;
+	pthread_condattr_t CondAttr;
+
+	if (Engine >= (u32)Hal_CdmaCount()) {
+		xdbg_printf(XDBG_DEBUG_ERROR,
+		    "Cannot find config structure for device %d\r\n",
+			DeviceId);
+		return NULL;
+	}
+	InstancePtr = &SimCdmaInstance[Engine];
+
+	SimMemInit();
+
+	pthread_mutex_lock(&SimDimmState.Lock);
+	SimDimmState.MBps = SimEnv("SIM_DIMM_MBPS", SIM_DIMM_DEFAULT_MBPS);
+	SimDimmState.RowMissNs = SimEnv("SIM_DRAM_ROW_MISS_NS",
+		SIM_DRAM_DEFAULT_ROW_MISS_NS);
+	pthread_mutex_unlock(&SimDimmState.Lock);
+
+	if (!SimCdmaStarted[Engine]) {
+		InstancePtr->DeviceId = DeviceId;
+		InstancePtr->RingSpace = (SIM_OCM_SIZE / Hal_CdmaCount()) &
+			~(SIM_BD_ALIGNMENT - 1U);
+		InstancePtr->RingBase = SIM_OCM_BASE +
+			(UINTPTR)Engine * InstancePtr->RingSpace;
+		InstancePtr->MBps = SimEnv("SIM_CDMA_MBPS",
+			SIM_CDMA_DEFAULT_MBPS);
+		InstancePtr->LatencyNs = SimEnv("SIM_CDMA_LATENCY_NS",
+			SIM_CDMA_DEFAULT_LATENCY_NS);
+		InstancePtr->Datapath.DataWidth = (u32)SimEnv(
+			"SIM_CDMA_DATA_WIDTH", SIM_CDMA_DEFAULT_DATA_WIDTH);
+		InstancePtr->Datapath.BurstLen = (u32)SimEnv(
+			"SIM_CDMA_BURST_LEN", SIM_CDMA_DEFAULT_BURST_LEN);
+		InstancePtr->Datapath.ClockMHz = (u32)SimEnv(
+			"SIM_CDMA_CLK_MHZ", 0);
+		pthread_mutex_init(&InstancePtr->Lock, NULL);
+		pthread_condattr_init(&CondAttr);
+		pthread_condattr_setclock(&CondAttr, CLOCK_MONOTONIC);
+		pthread_cond_init(&InstancePtr->Cond, &CondAttr);
+		pthread_condattr_destroy(&CondAttr);
+		pthread_cond_init(&InstancePtr->IrqCond, NULL);
+		if (pthread_create(&InstancePtr->Thread, NULL, SimEngine,
+				InstancePtr) != 0) {
+			return NULL;
+		}
+		SimEngineSchedule(InstancePtr->Thread);
+		SimCdmaStarted[Engine] = 1;
+	}
+
+	/* Like XAxiCdma_CfgInitialize, re-initializing resets the engine */
+	pthread_mutex_lock(&InstancePtr->Lock);
+	SimResetLocked(InstancePtr);
+	InstancePtr->Ring = NULL;
+	InstancePtr->BdCount = 0;
+	InstancePtr->ChainBds = 0;
+	InstancePtr->IntrEnabled = 0;
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return InstancePtr;
+}
+
+/* Lay out BdCount BDs of Length bytes from the start of the OCM slice of
+ * the engine and link them in a ring, like XAxiCdma_BdRingCreate plus
+ * XAxiCdma_BdRingClone.
+ */
+static int SimRingCreate(HalCdma *InstancePtr, u32 BdCount, u32 Length)
+{
+	SimBd *Ring = SimTranslate(InstancePtr->RingBase, InstancePtr->RingSpace);
+	u32 Index;
+
+	if (BdCount == 0 || BdCount > InstancePtr->RingSpace / SIM_BD_ALIGNMENT) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "%u BDs do not fit in OCM\r\n",
+			BdCount);
+		return XST_FAILURE;
+	}
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	if (InstancePtr->SubmitCnt != InstancePtr->ReapCnt) {
+		pthread_mutex_unlock(&InstancePtr->Lock);
+		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD ring failed, BDs busy\r\n");
+		return XST_FAILURE;
+	}
+
+	memset(Ring, 0, InstancePtr->RingSpace);
+	for (Index = 0; Index < BdCount; Index++) {
+		Ring[Index].NextDesc = InstancePtr->RingBase +
+			((Index + 1) % BdCount) * SIM_BD_ALIGNMENT;
+		Ring[Index].Control = Length;
+	}
+
+	InstancePtr->Ring = Ring;
+	InstancePtr->BdCount = BdCount;
+	InstancePtr->ChainBds = 0;
+	InstancePtr->IntrEnabled = 0;
+	SimResetLocked(InstancePtr);
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return XST_SUCCESS;
+}
+
+int Hal_BdRingCreate(HalCdma *InstancePtr)
+{
+	return SimRingCreate(InstancePtr, InstancePtr->RingSpace /
+		SIM_BD_ALIGNMENT, 0);
+}
+
+int Hal_BdChainCreate(HalCdma *InstancePtr, int NumChains, int NumBd,
+		u32 Length)
+{
+	int Status;
+
+	Status = SimRingCreate(InstancePtr, NumChains * NumBd, Length);
+	if (Status != XST_SUCCESS) {
+		return Status;
+	}
+
+	InstancePtr->ChainBds = NumBd;
+	InstancePtr->ChainLength = Length;
+
+	return XST_SUCCESS;
+}
+
+/* Only the addresses are written, the length was set by Hal_BdChainCreate */
+int Hal_BdChainSubmit(HalCdma *InstancePtr, UINTPTR SrcAddr, UINTPTR DstAddr)
+{
+	u64 Next;
+	u32 Index;
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	if (InstancePtr->ChainBds == 0 || InstancePtr->Error ||
+	    InstancePtr->SubmitCnt + InstancePtr->ChainBds -
+	    InstancePtr->ReapCnt > InstancePtr->BdCount) {
+		pthread_mutex_unlock(&InstancePtr->Lock);
+		xdbg_printf(XDBG_DEBUG_ERROR, "Failed bd alloc\r\n");
+		return XST_FAILURE;
+	}
+
+	Next = InstancePtr->SubmitCnt;
+	for (Index = 0; Index < InstancePtr->ChainBds; Index++) {
+		SimBd *BdPtr = &InstancePtr->Ring[(Next + Index) %
+			InstancePtr->BdCount];
+
+		BdPtr->SrcAddr = SrcAddr;
+		BdPtr->DstAddr = DstAddr;
+		BdPtr->Status = 0;
+		BdPtr->DoneNs = 0;
+
+		SrcAddr += InstancePtr->ChainLength;
+		DstAddr += InstancePtr->ChainLength;
+	}
+
+	InstancePtr->SubmitCnt += InstancePtr->ChainBds;
+	pthread_cond_broadcast(&InstancePtr->Cond);
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return XST_SUCCESS;
+}
+
+int Hal_BdRingSubmit(HalCdma *InstancePtr, const HalXfer *XferPtr, int NumBd)
+{
+	u64 Next;
+	int Index;
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	if (InstancePtr->Ring == NULL || InstancePtr->Error ||
+	    InstancePtr->SubmitCnt + NumBd - InstancePtr->ReapCnt >
+	    InstancePtr->BdCount) {
+		pthread_mutex_unlock(&InstancePtr->Lock);
+		xdbg_printf(XDBG_DEBUG_ERROR, "Failed bd alloc\r\n");
+		return XST_FAILURE;
+	}
+
+	Next = InstancePtr->SubmitCnt;
+	for (Index = 0; Index < NumBd; Index++) {
+		SimBd *BdPtr = &InstancePtr->Ring[(Next + Index) %
+			InstancePtr->BdCount];
+
+		BdPtr->SrcAddr = XferPtr[Index].SrcAddr;
+		BdPtr->DstAddr = XferPtr[Index].DstAddr;
+		BdPtr->Control = XferPtr[Index].Length;
+		BdPtr->Status = 0;
+		BdPtr->DoneNs = 0;
+	}
+
+	InstancePtr->SubmitCnt += NumBd;
+	pthread_cond_broadcast(&InstancePtr->Cond);
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return XST_SUCCESS;
+}
+
+/* Return the BDs that have finished by Now to software, or -1 if one of
+ * them failed. Called with the lock held.
+ */
+static int SimReapLocked(HalCdma *InstancePtr, u64 Now)
+{
+	int BdCount = 0;
+
+	while (InstancePtr->ReapCnt + BdCount < InstancePtr->EngineCnt) {
+		SimBd *BdPtr = &InstancePtr->Ring[(InstancePtr->ReapCnt +
+			BdCount) % InstancePtr->BdCount];
+
+		if (BdPtr->Status & SIM_BD_STS_ALL_ERR_MASK) {
+			return -1;
+		}
+		if (BdPtr->DoneNs > Now) {
+			break;
+		}
+		BdPtr->Status = 0;
+		BdCount++;
+	}
+	InstancePtr->ReapCnt += BdCount;
+
+	return BdCount;
+}
+
+int Hal_BdRingReap(HalCdma *InstancePtr)
+{
+	int BdCount;
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	BdCount = SimReapLocked(InstancePtr, SimNowNs());
+	if (BdCount < 0) {
+		pthread_mutex_unlock(&InstancePtr->Lock);
+		return -1;
+	}
+
+	/* Nothing to report but copies still queued: the CPU would only be
+	 * polling, so give the engine thread the host core until it has
+	 * moved on, see SimEngine for when it signals.
+	 */
+	if (BdCount == 0 && !InstancePtr->Error &&
+	    InstancePtr->EngineCnt < InstancePtr->SubmitCnt) {
+		u64 EngineCnt = InstancePtr->EngineCnt;
+
+		while (InstancePtr->EngineCnt == EngineCnt && !InstancePtr->Error) {
+			pthread_cond_wait(&InstancePtr->Cond, &InstancePtr->Lock);
+		}
+	}
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return BdCount;
+}
+
+/* Wait for the engine until at most the absolute time WakeNs. Cond runs
+ * off CLOCK_MONOTONIC, like SimNowNs.
+ */
+static void SimWaitUntilLocked(HalCdma *InstancePtr, u64 WakeNs)
+{
+	struct timespec Ts;
+
+	Ts.tv_sec = WakeNs / 1000000000ULL;
+	Ts.tv_nsec = WakeNs % 1000000000ULL;
+
+	pthread_cond_timedwait(&InstancePtr->Cond, &InstancePtr->Lock, &Ts);
+}
+
+/*****************************************************************************/
+/*
+* The interrupt thread. Like the coalescing logic of the CDMA it counts
+* completed BDs, i.e. BDs whose DoneNs has passed, and raises the interrupt
+* on every Threshold-th completion, or when the delay timer runs out with
+* completions still uncounted. An engine error is raised at once. Each
+* interrupt reaps everything finished so far.
+*
+******************************************************************************/
+static void *SimIrq(void *Arg)
+{
+	HalCdma *InstancePtr = Arg;
+
+	/* The default 50 us timer slack would delay every interrupt */
+	prctl(PR_SET_TIMERSLACK, 1UL);
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	for (;;) {
+		HalCdmaDoneFn DoneFn;
+		void *DoneRef;
+		u64 Ready = 0;
+		u64 Pending;
+		u64 WakeNs = 0;
+		u64 Now;
+		int BdCount;
+
+		if (!InstancePtr->IntrEnabled || InstancePtr->IntrErrorSent ||
+		    (!InstancePtr->Error &&
+		     InstancePtr->ReapCnt == InstancePtr->EngineCnt &&
+		     InstancePtr->ReapCnt == InstancePtr->IntrMark)) {
+			pthread_cond_wait(&InstancePtr->Cond, &InstancePtr->Lock);
+			continue;
+		}
+
+		Now = SimNowNs();
+		while (!InstancePtr->Error &&
+		       InstancePtr->ReapCnt + Ready < InstancePtr->EngineCnt) {
+			SimBd *BdPtr = &InstancePtr->Ring[(InstancePtr->ReapCnt +
+				Ready) % InstancePtr->BdCount];
+
+			if (BdPtr->DoneNs > Now) {
+				WakeNs = BdPtr->DoneNs;
+				break;
+			}
+			InstancePtr->IntrLastNs = BdPtr->DoneNs;
+			Ready++;
+		}
+
+		/* Completions not yet counted by an interrupt */
+		Pending = InstancePtr->ReapCnt + Ready - InstancePtr->IntrMark;
+
+		if (!InstancePtr->Error && Pending < InstancePtr->Threshold &&
+		    (Pending == 0 || InstancePtr->DelayNs == 0 ||
+		     Now < InstancePtr->IntrLastNs + InstancePtr->DelayNs)) {
+			if (Pending && InstancePtr->DelayNs &&
+			    (WakeNs == 0 || InstancePtr->IntrLastNs +
+			     InstancePtr->DelayNs < WakeNs)) {
+				WakeNs = InstancePtr->IntrLastNs +
+					InstancePtr->DelayNs;
+			}
+
+			if (WakeNs == 0) {
+				/* Wait for the engine to finish the next BD */
+				pthread_cond_wait(&InstancePtr->Cond,
+					&InstancePtr->Lock);
+			} else {
+				SimWaitUntilLocked(InstancePtr, WakeNs);
+			}
+			continue;
+		}
+
+		/* The threshold counter only takes multiples of Threshold, the
+		 * rest carries over. The delay timer takes everything.
+		 */
+		if (Pending >= InstancePtr->Threshold) {
+			InstancePtr->IntrMark += Pending -
+				Pending % InstancePtr->Threshold;
+		} else {
+			InstancePtr->IntrMark += Pending;
+		}
+
+		BdCount = SimReapLocked(InstancePtr, Now);
+		if (BdCount < 0) {
+			InstancePtr->IntrErrorSent = 1;
+		} else if (BdCount == 0) {
+			continue;
+		}
+		DoneFn = InstancePtr->DoneFn;
+		DoneRef = InstancePtr->DoneRef;
+
+		pthread_mutex_unlock(&InstancePtr->Lock);
+		DoneFn(DoneRef, BdCount);
+		pthread_mutex_lock(&InstancePtr->Lock);
+
+		pthread_cond_broadcast(&InstancePtr->IrqCond);
+	}
+
+	return NULL;
+}
+
+int Hal_CdmaIntrEnable(HalCdma *InstancePtr, u32 Threshold, u32 Delay,
+		HalCdmaDoneFn DoneFn, void *DoneRef)
+{
+	if (Threshold == 0 || Threshold > 255 || Delay > 255) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Set coalesce failed\r\n");
+		return XST_FAILURE;
+	}
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	if (!InstancePtr->IrqStarted) {
+		if (pthread_create(&InstancePtr->IrqThread, NULL, SimIrq,
+				InstancePtr) != 0) {
+			pthread_mutex_unlock(&InstancePtr->Lock);
+			return XST_FAILURE;
+		}
+		InstancePtr->IrqStarted = 1;
+	}
+
+	InstancePtr->Threshold = Threshold;
+	InstancePtr->DelayNs = (u64)Delay * SIM_INTR_DELAY_UNIT_NS;
+	InstancePtr->DoneFn = DoneFn;
+	InstancePtr->DoneRef = DoneRef;
+	InstancePtr->IntrMark = InstancePtr->ReapCnt;
+	InstancePtr->IntrEnabled = 1;
+	pthread_cond_broadcast(&InstancePtr->Cond);
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return XST_SUCCESS;
+}
+
+void Hal_CdmaIntrDisable(HalCdma *InstancePtr)
+{
+	pthread_mutex_lock(&InstancePtr->Lock);
+	InstancePtr->IntrEnabled = 0;
+	pthread_cond_broadcast(&InstancePtr->IrqCond);
+	pthread_mutex_unlock(&InstancePtr->Lock);
+}
+
+/* The CPU sleeping in wfi is a cond wait here. The DoneFn runs without the
+ * lock, so *Value is rechecked after every broadcast.
+ */
+void Hal_CdmaWaitIntr(HalCdma *InstancePtr, volatile int *Value, int Seen)
+{
+	pthread_mutex_lock(&InstancePtr->Lock);
+	while (*Value == Seen && InstancePtr->IntrEnabled) {
+		pthread_cond_wait(&InstancePtr->IrqCond, &InstancePtr->Lock);
+	}
+	pthread_mutex_unlock(&InstancePtr->Lock);
+}
+
+int Hal_CdmaReset(HalCdma *InstancePtr, int TimeOut)
+{
+	(void)TimeOut;
+
+	pthread_mutex_lock(&InstancePtr->Lock);
+	SimResetLocked(InstancePtr);
+	pthread_mutex_unlock(&InstancePtr->Lock);
+
+	return XST_SUCCESS;
+}
+
+/* The host is cache coherent with the modeled engine */
+void Hal_DCacheFlushRange(UINTPTR Addr, u64 Length)
+{
+	(void)Addr;
+	(void)Length;
+}
+
+void Hal_DCacheInvalidateRange(UINTPTR Addr, u64 Length)
+{
+	(void)Addr;
+	(void)Length;
+}
+
+void Hal_DCacheFlushAll(void)
+{
+}
+
+/* The host mapping is fixed, report the page size it is mapped with */
+u64 Hal_CpuMapRange(UINTPTR Addr, u64 Length, int Map)
+{
+	(void)Addr;
+	(void)Length;
+	(void)Map;
+
+	return (u64)sysconf(_SC_PAGESIZE);
+}
+
+u64 Hal_TimeNow(void)
+{
+	return SimNowNs();
+}
+
+void Hal_SleepUs(u64 Us)
+{
+	struct timespec Nap;
+
+	Nap.tv_sec = (time_t)(Us / 1000000ULL);
+	Nap.tv_nsec = (long)(Us % 1000000ULL) * 1000L;
+	while (nanosleep(&Nap, &Nap) != 0) {
+		/* Interrupted, sleep the rest */
+	}
+}
+
+static const char *SimPersistPath(void)
+{
+	const char *Path = getenv("SIM_CHECKPOINT");
+
+	return Path ? Path : SIM_DEFAULT_CHECKPOINT;
+}
+
+int Hal_PersistStore(const void *Buf, u32 Length)
+{
+	FILE *File;
+	size_t Written;
+
+	if (Length > HAL_PERSIST_SIZE) {
+		return XST_FAILURE;
+	}
+
+	File = fopen(SimPersistPath(), "wb");
+	if (File == NULL) {
+		return XST_FAILURE;
+	}
+	Written = fwrite(Buf, 1, Length, File);
+	if (fclose(File) != 0 || Written != Length) {
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+int Hal_PersistLoad(void *Buf, u32 Length)
+{
+	FILE *File;
+	size_t Read;
+
+	if (Length > HAL_PERSIST_SIZE) {
+		return XST_FAILURE;
+	}
+
+	File = fopen(SimPersistPath(), "rb");
+	if (File == NULL) {
+		return XST_FAILURE;
+	}
+	Read = fread(Buf, 1, Length, File);
+	fclose(File);
+
+	return Read == Length ? XST_SUCCESS : XST_FAILURE;
+}
+
+int Hal_LogWrite(u64 Offset, const void *Buf, u32 Length)
+{
+	static FILE *File;
+	const char *Path;
+
+	if (Offset > HAL_LOG_SIZE || Length > HAL_LOG_SIZE - Offset) {
+		return XST_FAILURE;
+	}
+
+	/* Log_Init writes offset 0 first, which starts a new file */
+	if (File == NULL) {
+		Path = getenv("SIM_LOG");
+		File = fopen(Path ? Path : SIM_DEFAULT_LOG, "wb");
+		if (File == NULL) {
+			return XST_FAILURE;
+		}
+	}
+
+	if (fseek(File, (long)Offset, SEEK_SET) != 0 ||
+	    fwrite(Buf, 1, Length, File) != Length || fflush(File) != 0) {
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+void Hal_SpinLock(volatile u32 *Lock)
+{
+	struct timespec Nap = { 0, 1000 };
+
+	while (__atomic_exchange_n(Lock, 1, __ATOMIC_ACQUIRE)) {
+		nanosleep(&Nap, NULL);
+	}
+}
+
+int Hal_CdmaCount(void)
+{
+	const char *Env = getenv("SIM_CDMAS");
+	int NumCdmas = HAL_MAX_CDMAS;
+
+	if (Env != NULL && atoi(Env) > 0) {
+		NumCdmas = atoi(Env);
+	}
+
+	return NumCdmas < HAL_MAX_CDMAS ? NumCdmas : HAL_MAX_CDMAS;
+}
+
+void Hal_CdmaDatapath(HalCdma *InstancePtr, HalDatapath *PathPtr)
+{
+	*PathPtr = InstancePtr->Datapath;
+}
+
+int Hal_CpuCount(void)
+{
+	const char *Env = getenv("SIM_CPUS");
+	int NumCpus = HAL_MAX_CPUS;
+
+	if (Env != NULL && atoi(Env) > 0) {
+		NumCpus = atoi(Env);
+	}
+
+	return NumCpus < HAL_MAX_CPUS ? NumCpus : HAL_MAX_CPUS;
+}
+
+typedef struct {
+	HalCpuFn Fn;
+	void *Arg;
+	int Cpu;
+} SimCpuJob;
+
+static void *SimCpuThread(void *Arg)
+{
+	SimCpuJob *Job = Arg;
+
+	Job->Fn(Job->Cpu, Job->Arg);
+
+	return NULL;
+}
+
+void Hal_CpuRun(int NumCpus, HalCpuFn Fn, void *Arg)
+{
+	pthread_t Thread[HAL_MAX_CPUS];
+	SimCpuJob Job[HAL_MAX_CPUS];
+	int Started[HAL_MAX_CPUS];
+	int Cpu;
+
+	if (NumCpus > HAL_MAX_CPUS) {
+		NumCpus = HAL_MAX_CPUS;
+	}
+
+	for (Cpu = 1; Cpu < NumCpus; Cpu++) {
+		Job[Cpu].Fn = Fn;
+		Job[Cpu].Arg = Arg;
+		Job[Cpu].Cpu = Cpu;
+		Started[Cpu] = !pthread_create(&Thread[Cpu], NULL, SimCpuThread,
+			&Job[Cpu]);
+		if (!Started[Cpu]) {
+			/* Out of threads, run this share on the caller */
+			Fn(Cpu, Arg);
+		}
+	}
+
+	Fn(0, Arg);
+
+	for (Cpu = 1; Cpu < NumCpus; Cpu++) {
+		if (Started[Cpu]) {
+			pthread_join(Thread[Cpu], NULL);
+		}
+	}
+}
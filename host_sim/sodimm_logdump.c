@@ -0,0 +1,295 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_logdump.c
+ *
+ * Decoder of the binary result stream of sodimm_log.c.
+ *
+ *   sodimm_logdump [file]      one CSV line per record
+ *   sodimm_logdump -s [file]   per-phase statistics and the failures
+ *
+ * file defaults to sodimm_sim.log. On the board the stream is the
+ * HAL_LOG_SIZE bytes below the persistent region at the top of the PS DDR,
+ * dumped with xsct:
+ *
+ *   mrd -bin -file results.bin <address> <words>
+ *
+ * Only the records the header counts are decoded, so the whole region can
+ * be dumped.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sodimm_log.h"
+
+/******************** Constant Definitions **********************************/
+
+#define DUMP_DEFAULT_FILE	"sodimm_sim.log"
+#define DUMP_MAX_FAILURES	16	/* failures listed by the summary */
+
+/**************************** Type Definitions *******************************/
+
+/* What the summary keeps of one phase */
+typedef struct {
+	LogRecord Begin;
+	LogRecord End;		/* Type LOG_REC_HEADER until the END record */
+	u32 Batches;
+	u32 FailedBatches;
+	u32 *DmaNs;		/* per batch, sorted for the percentiles */
+	u32 *VerifyNs;
+	u32 Capacity;
+} DumpPhase;
+
+/************************** Variable Definitions *****************************/
+
+static const char *TypeName[] = {
+	"header", "phase", "batch", "fail", "end"
+};
+
+static const char *TestName[] = {
+	"access range", "pattern sweep", "direction sweep", "multi-core",
+	"refresh hold"
+};
+
+static const char *DirectionName[] = {
+	"write", "read", "copy", "duplex"
+};
+
+#define DUMP_NAME(Table, Index) \
+	((Index) < sizeof(Table) / sizeof(Table[0]) ? Table[Index] : "?")
+
+/*****************************************************************************/
+
+static int CompareU32(const void *A, const void *B)
+{
+	u32 Left = *(const u32 *)A;
+	u32 Right = *(const u32 *)B;
+
+	return Left < Right ? -1 : Left > Right;
+}
+
+/* Value below which Pct percent of the sorted samples lie */
+static u32 Percentile(const u32 *Sorted, u32 Count, u32 Pct)
+{
+	if (Count == 0) {
+		return 0;
+	}
+
+	return Sorted[(u64)(Count - 1) * Pct / 100];
+}
+
+static u64 Average(const u32 *Samples, u32 Count)
+{
+	u64 Sum = 0;
+	u32 Index;
+
+	for (Index = 0; Index < Count; Index++) {
+		Sum += Samples[Index];
+	}
+
+	return Count ? Sum / Count : 0;
+}
+
+static void PrintCsv(const LogRecord *Record)
+{
+	printf("%u,%s,%u,%s,%u,%s,0x%llx,%llu,%u,%u,%u,%u,%u,%u,0x%llx\n",
+		Record->Seq, DUMP_NAME(TypeName, Record->Type), Record->Phase,
+		DUMP_NAME(TestName, Record->Test), Record->Mode,
+		DUMP_NAME(DirectionName, Record->Direction),
+		(unsigned long long)Record->Addr,
+		(unsigned long long)Record->Length,
+		Record->Time[LOG_TIME_SETUP], Record->Time[LOG_TIME_QUEUE],
+		Record->Time[LOG_TIME_DMA], Record->Time[LOG_TIME_VERIFY],
+		Record->Status, Record->Count, (unsigned long long)Record->Value);
+}
+
+static int AddBatch(DumpPhase *Phase, const LogRecord *Record)
+{
+	if (Phase->Batches == Phase->Capacity) {
+		Phase->Capacity = Phase->Capacity ? 2 * Phase->Capacity : 1024;
+		Phase->DmaNs = realloc(Phase->DmaNs,
+			Phase->Capacity * sizeof(u32));
+		Phase->VerifyNs = realloc(Phase->VerifyNs,
+			Phase->Capacity * sizeof(u32));
+		if (Phase->DmaNs == NULL || Phase->VerifyNs == NULL) {
+			return -1;
+		}
+	}
+
+	Phase->DmaNs[Phase->Batches] = Record->Time[LOG_TIME_DMA];
+	Phase->VerifyNs[Phase->Batches] = Record->Time[LOG_TIME_VERIFY];
+	Phase->Batches++;
+	Phase->FailedBatches += Record->Status != 0;
+
+	return 0;
+}
+
+static void PrintSummary(DumpPhase *Phases, u32 NumPhases,
+		const LogRecord *Failures, u32 NumFailures, u32 TotalFailures,
+		u32 NumRecords, u32 Gaps)
+{
+	DumpPhase *Phase;
+	u32 Index;
+	u64 WallUs;
+
+	printf("%u records, %u phases, %u failed checks, %u records lost\n\n",
+		NumRecords, NumPhases, TotalFailures, Gaps);
+	printf("phase  test             mode  direction  batches  failed"
+		"      MB    MB/s  dma avg/p99/max us  verify avg/p99/max us\n");
+
+	for (Index = 0; Index < NumPhases; Index++) {
+		Phase = &Phases[Index];
+		qsort(Phase->DmaNs, Phase->Batches, sizeof(u32), CompareU32);
+		qsort(Phase->VerifyNs, Phase->Batches, sizeof(u32), CompareU32);
+		WallUs = Phase->End.Type == LOG_REC_END ? Phase->End.Value : 0;
+
+		printf("%5u  %-15s  %4u  %-9s  %7u  %6u  %6llu  %6llu"
+			"  %6llu/%5u/%5u  %9llu/%5u/%5u%s\n",
+			Phase->Begin.Phase, DUMP_NAME(TestName, Phase->Begin.Test),
+			Phase->Begin.Mode,
+			DUMP_NAME(DirectionName, Phase->Begin.Direction),
+			Phase->Batches, Phase->FailedBatches,
+			(unsigned long long)(Phase->End.Length >> 20),
+			(unsigned long long)(WallUs ? Phase->End.Length / WallUs : 0),
+			(unsigned long long)(Average(Phase->DmaNs,
+				Phase->Batches) / 1000),
+			Percentile(Phase->DmaNs, Phase->Batches, 99) / 1000,
+			Percentile(Phase->DmaNs, Phase->Batches, 100) / 1000,
+			(unsigned long long)(Average(Phase->VerifyNs,
+				Phase->Batches) / 1000),
+			Percentile(Phase->VerifyNs, Phase->Batches, 99) / 1000,
+			Percentile(Phase->VerifyNs, Phase->Batches, 100) / 1000,
+			Phase->End.Type != LOG_REC_END ? "  (no end)" :
+			Phase->End.Status ? "  FAILED" : "");
+	}
+
+	if (NumFailures) {
+		printf("\nfirst failed checks:\n");
+	}
+	for (Index = 0; Index < NumFailures; Index++) {
+		printf("  phase %u %s mode %u: 0x%llx, %u bad words, bits "
+			"0x%016llx\n", Failures[Index].Phase,
+			DUMP_NAME(TestName, Failures[Index].Test),
+			Failures[Index].Mode,
+			(unsigned long long)Failures[Index].Addr,
+			Failures[Index].Count,
+			(unsigned long long)Failures[Index].Value);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *Path = DUMP_DEFAULT_FILE;
+	int Summary = 0;
+	FILE *File;
+	LogRecord Header;
+	LogRecord Record;
+	LogRecord Failures[DUMP_MAX_FAILURES];
+	DumpPhase *Phases = NULL;
+	u32 NumPhases = 0;
+	u32 NumFailures = 0;
+	u32 TotalFailures = 0;
+	u32 NextSeq = 1;
+	u32 Gaps = 0;
+	u32 Index;
+	int Arg;
+
+	for (Arg = 1; Arg < argc; Arg++) {
+		if (strcmp(argv[Arg], "-s") == 0) {
+			Summary = 1;
+		} else if (argv[Arg][0] == '-') {
+			fprintf(stderr, "usage: %s [-s] [file]\n", argv[0]);
+			return 2;
+		} else {
+			Path = argv[Arg];
+		}
+	}
+
+	File = fopen(Path, "rb");
+	if (File == NULL) {
+		perror(Path);
+		return 1;
+	}
+
+	if (fread(&Header, sizeof(Header), 1, File) != 1 ||
+	    Header.Magic != LOG_MAGIC || Header.Type != LOG_REC_HEADER ||
+	    Header.Status != LOG_VERSION || Header.Length != sizeof(LogRecord)) {
+		fprintf(stderr, "%s: not a version %u result stream\n", Path,
+			LOG_VERSION);
+		fclose(File);
+		return 1;
+	}
+
+	if (!Summary) {
+		printf("seq,type,phase,test,mode,direction,addr,length,setup_ns,"
+			"queue_ns,dma_ns,verify_ns,status,count,value\n");
+	}
+
+	for (Index = 0; Index < Header.Count; Index++) {
+		if (fread(&Record, sizeof(Record), 1, File) != 1 ||
+		    Record.Magic != LOG_MAGIC) {
+			fprintf(stderr, "%s: record %u of %u is missing or bad\n",
+				Path, Index + 1, Header.Count);
+			break;
+		}
+
+		/* A gap is records the stream could not take */
+		if (Record.Seq != NextSeq) {
+			Gaps += Record.Seq - NextSeq;
+		}
+		NextSeq = Record.Seq + 1;
+
+		if (!Summary) {
+			PrintCsv(&Record);
+			continue;
+		}
+
+		switch (Record.Type) {
+		case LOG_REC_PHASE:
+			Phases = realloc(Phases, (NumPhases + 1) * sizeof(*Phases));
+			if (Phases == NULL) {
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+			memset(&Phases[NumPhases], 0, sizeof(*Phases));
+			Phases[NumPhases].Begin = Record;
+			NumPhases++;
+			break;
+		case LOG_REC_BATCH:
+			if (NumPhases && AddBatch(&Phases[NumPhases - 1], &Record)) {
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+			break;
+		case LOG_REC_FAIL:
+			if (NumFailures < DUMP_MAX_FAILURES) {
+				Failures[NumFailures++] = Record;
+			}
+			TotalFailures++;
+			break;
+		case LOG_REC_END:
+			if (NumPhases) {
+				Phases[NumPhases - 1].End = Record;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	fclose(File);
+
+	if (Summary) {
+		PrintSummary(Phases, NumPhases, Failures, NumFailures,
+			TotalFailures, Index, Gaps);
+	}
+
+	for (Index = 0; Index < NumPhases; Index++) {
+		free(Phases[Index].DmaNs);
+		free(Phases[Index].VerifyNs);
+	}
+	free(Phases);
+
+	return 0;
+}
@@ -71,11 +71,21 @@
  * </pre>
  *
  ****************************************************************************/
-#include "xaxicdma.h"
-#include "xdebug.h"
+#include "sodimm_checkpoint.h"
+#include "sodimm_fault.h"
+#include "sodimm_hal.h"
+#include "sodimm_log.h"
+#include "sodimm_march.h"
+#include "sodimm_pattern.h"
+#include "sodimm_screen.h"
+#include "sodimm_stats.h"
+#include "sodimm_stripe.h"
+#include "sodimm_traffic.h"
+#include "sodimm_verify.h"
+
+#ifndef SODIMM_HOST_SIM
 #include "xenv.h"	/* memset */
-#include "xil_cache.h"
-#include "xparameters.h"
+#endif
 
 #if defined(XPAR_UARTNS550_0_BASEADDR)
 #include "xuartns550_l.h"       /* to use uartns550 */
@@ -109,25 +119,166 @@ extern void xil_printf(const char *format, ...);
 #define MEMORY_BASE		0x01000000
 #endif
 
-#define BD_SPACE_BASE (XPAR_PSU_OCM_RAM_0_S_AXI_BASEADDR)
-#define BD_SPACE_HIGH (XPAR_PSU_OCM_RAM_0_S_AXI_HIGHADDR)
 #define PS_DDR_BASE (0x01000000)
 #define PL_DDR4_BASE (XPAR_DDR4_0_BASEADDR)
 
 #define PL_DDR4_SIZE (XPAR_DDR4_0_HIGHADDR - XPAR_DDR4_0_BASEADDR + 1)
 
 #define MAX_PKT_LEN		4096L  //needs to be < 256K
-#define MARK_UNCACHEABLE	0x701
 
 /* Number of BDs in the transfer example
  * We show how to submit multiple BDs for one transmit.
  */
 #define NUMBER_OF_BDS_TO_TRANSFER	64L
 
+/* Bytes moved by one call to DoTransfer */
+#define BATCH_LEN	(MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER)
+
+/* Number of batches the pipelined access range test keeps in flight. Each
+ * batch has its own BATCH_LEN buffer in PS DDR, starting at PS_DDR_BASE.
+ */
+#define PIPELINE_DEPTH	3
+
+/* Staging buffers the DMA read-back verification copies each written batch
+ * into, one per batch in flight, right after the batch buffers.
+ */
+#define READBACK_BASE	(PS_DDR_BASE + PIPELINE_DEPTH * BATCH_LEN)
+
+/* BD chains of the ring session: one per batch in flight, and one more per
+ * batch for its read-back.
+ */
+#define RING_SESSION_CHAINS	(2 * PIPELINE_DEPTH)
+
+/* Resident source blocks of the address independent pattern modes 1-10, one
+ * BATCH_LEN block per mode, clear of every batch buffer from PS_DDR_BASE.
+ */
+#define PATTERN_CACHE_BASE	(PS_DDR_BASE + 0x01000000)
+
+/* Range covered by every mode of the full pattern sweep */
+#define PATTERN_SWEEP_BASE	PL_DDR4_BASE
+#define PATTERN_SWEEP_SIZE	PL_DDR4_SIZE
+
 #define RESET_LOOP_COUNT	10 /* Number of times to check reset is done */
 
+#define FILL_BENCH_BATCHES	64 /* BATCH_LEN fills timed per mode and path */
+
+#define FAIL_PRINT_BATCHES	4 /* failing batches printed in full, the rest
+				   * only go to the fault log */
+
+/* Interrupt coalescing: one interrupt per COALESCE_THRESHOLD finished BDs,
+ * or COALESCE_DELAY x 125 AXI clocks after the last completion when fewer
+ * are done. The default raises one interrupt per batch.
+ */
+#define COALESCE_THRESHOLD	NUMBER_OF_BDS_TO_TRANSFER
+#define COALESCE_DELAY		100
+
+#define COMPLETION_BENCH_BATCHES 256 /* batches timed per completion mode */
+
+/* Buffer lengths of the kernel benchmark, x4 per step, and its two PS DDR
+ * buffers, clear of the batch buffers and the pattern cache
+ */
+#define KBENCH_MIN_LEN		0x1000U		/* 4KB */
+#define KBENCH_MAX_LEN		0x4000000U	/* 64MB */
+#define KBENCH_SRC		(PS_DDR_BASE + 0x04000000)
+#define KBENCH_DST		(KBENCH_SRC + KBENCH_MAX_LEN)
+
+#define KBENCH_MIN_US		10000U	/* calls per run double up to this */
+#define KBENCH_RUNS		5	/* runs per result, the median counts */
+
+/* Kernels of the kernel benchmark */
+#define KBENCH_PREPARE		0	/* PrepareBatch byte fill */
+#define KBENCH_SETUP		1	/* SetupTransfer_MOD pattern fill */
+#define KBENCH_GETREF		2	/* XMt_GetRefVal per word */
+#define KBENCH_CHECK		3	/* CheckData */
+#define KBENCH_CHECKBATCH	4	/* XMt_CheckBatch, BATCH_LEN at a time */
+#define KBENCH_SUBMIT		5	/* DoTransfer BD setup, BATCH_LEN at a time */
+#define KBENCH_NUM_KERNELS	6
+
 #define NUM_REPEAT_TEST (PL_DDR4_SIZE / MAX_PKT_LEN / NUMBER_OF_BDS_TO_TRANSFER)
 
+/* Transfer directions of the pipelined tests, picked at run time through
+ * TestDirection. A PL->PL copy moves every batch from the other half of the
+ * range, duplex alternates write and read batches so both are queued on the
+ * CDMA at once.
+ */
+#define DIR_WRITE		0	/* PS DDR -> PL DDR4 */
+#define DIR_READ		1	/* PL DDR4 -> PS DDR */
+#define DIR_COPY		2	/* PL DDR4 -> PL DDR4 */
+#define DIR_DUPLEX		3	/* write and read batches interleaved */
+#define NUM_DIRECTIONS		4
+
+/* Range covered by each direction of the direction sweep */
+#define DIRECTION_SWEEP_BASE	PL_DDR4_BASE
+#define DIRECTION_SWEEP_SIZE	PL_DDR4_SIZE
+
+/* Range the geometry-aware traffic profile stays inside. The DRAM
+ * coordinates of its layouts are only exact if it starts at PL_DDR4_BASE.
+ */
+#define TRAFFIC_BASE		PL_DDR4_BASE
+#define TRAFFIC_SIZE		PL_DDR4_SIZE
+
+#define TRAFFIC_BDS		16384 /* BDs timed per layout and direction */
+#define TRAFFIC_SUBMIT		256 /* BDs per Hal_BdRingSubmit */
+#define TRAFFIC_IN_FLIGHT	512 /* BDs queued at most, half the ring of
+				       one of HAL_MAX_CDMAS engines */
+
+/* Range of the multi-CDMA stripe scaling benchmark */
+#define STRIPE_BASE		PL_DDR4_BASE
+#define STRIPE_SIZE		0x10000000UL /* 256MB, at most PL_DDR4_SIZE */
+
+#define STRIPE_LEN		(BATCH_LEN / 4) /* bytes per stripe of one engine,
+					     stripes differ inside the window */
+#define STRIPE_PS_LEN		BATCH_LEN /* PS DDR window of each direction */
+
+/* Range of the CDMA datapath sweep. Write and read use its lower half,
+ * the copy moves the lower half to the upper one.
+ */
+#define DATAPATH_BASE		PL_DDR4_BASE
+#define DATAPATH_SIZE		0x2000000UL /* 32MB, at most PL_DDR4_SIZE */
+
+#define DATAPATH_MIN_BD		256U	/* BD lengths swept, x4 per step */
+#define DATAPATH_MAX_BD		65536U
+#define DATAPATH_DIMM_MBPS	17066U	/* 2133 MT/s x 8 bytes, as build.tcl */
+#define DATAPATH_LIMIT_PCT	80U	/* share of a ceiling that names the limit */
+
+/* Range and pattern mode of the PL->PL replication fill */
+#define REPLICATE_BASE		PL_DDR4_BASE
+#define REPLICATE_SIZE		PL_DDR4_SIZE
+#define REPLICATE_MODE		1U	/* address independent, 1-10 */
+
+#define REPLICATE_BD_LEN	0x10000U /* 64KB, the longest BD of the
+					    datapath sweep */
+
+/* Range and pattern mode of the refresh hold test. The range is written and
+ * checked in regions of Ckpt_RegionLen bytes, and every region is checked
+ * once it has held its data for the hold time.
+ */
+#define HOLD_BASE		PL_DDR4_BASE
+#define HOLD_SIZE		PL_DDR4_SIZE
+#define HOLD_MODE		11U	/* random, about half the cells of
+					   every row hold a charge */
+
+/* Hold time of the refresh hold test, in us. 0 derives it from the refresh
+ * timing of the DIMM: HOLD_WINDOWS refresh windows plus one tRFC, so
+ * every row has been refreshed at least HOLD_WINDOWS times with the
+ * data in it.
+ */
+#define HOLD_TIME_US		0U
+#define HOLD_WINDOWS		2U
+
+/* Checkpoint steps: the access range test, then every pattern mode */
+#define STEP_ACCESS_RANGE	0U
+#define STEP_PATTERN(Mode)	(1U + (Mode))
+#define NUM_STEPS		(1U + XMT_MAX_MODE_NUM)
+
+/* Range of the address and data line screen */
+#define SCREEN_BASE		PL_DDR4_BASE
+#define SCREEN_SIZE		PL_DDR4_SIZE
+
+/* Range of the CPU-direct March tests */
+#define MARCH_TEST_BASE		PL_DDR4_BASE
+#define MARCH_TEST_SIZE		PL_DDR4_SIZE
+
 #define U64_MASK				0xFFFFFFFFFFFFFFFFU
 #define XMT_MAX_MODE_NUM		15U
 
@@ -136,6 +287,164 @@ extern void xil_printf(const char *format, ...);
 //comment out to test read functionality of PL DDR4
 #define WRITE_TEST
 
+//comment out to go straight to the bulk tests without screening the data
+//and address lines first
+#define QUICK_SCREEN
+
+//uncomment to keep sweeping past data check failures, so the fault summary
+//covers the whole range instead of the first bad batch
+//#define CONTINUE_ON_FAIL
+
+//comment out to start every run from scratch instead of resuming the
+//pipelined access range test and the pattern sweep from the checkpoint the
+//last run left in PS DDR
+#define CHECKPOINT_RESUME
+
+//uncomment to re-test only the regions the checkpoint has not seen pass,
+//i.e. those that failed or were never covered, instead of resuming at the
+//recorded position
+//#define RETEST_ONLY
+
+//comment out to run the access range test one batch at a time
+#define PIPELINED_TEST
+
+//comment out to run the pattern modes on the first batch only
+#define FULL_PATTERN_SWEEP
+
+//uncomment to split the full pattern sweep across all CPUs (Hal_CpuCount)
+//#define MULTICORE_TEST
+
+//comment out to check the PL DDR4 side of pipelined writes and copies with
+//CPU loads over the HPM port instead of reading each batch back by DMA into
+//a PS DDR staging buffer
+#define READBACK_VERIFY
+
+//comment out to regenerate and flush the source of every write batch of the
+//address independent modes instead of sending it from the pattern cache
+#define PATTERN_CACHE
+
+//uncomment to time the pattern fill kernels against the generic fill
+//#define FILL_BENCHMARK
+
+//comment out to poll the BD ring for completions instead of sleeping until
+//the CDMA interrupt
+#define INTERRUPT_COMPLETION
+
+//uncomment to run the polling vs interrupt completion benchmark
+//#define COMPLETION_BENCHMARK
+
+//uncomment to build the kernel benchmark instead of the tests: main only
+//times the CPU kernels and prints the results for host_sim/sodimm_benchcmp
+//#define KERNEL_BENCH
+
+//uncomment to run the bandwidth profile over every transfer direction
+//#define DIRECTION_SWEEP
+
+//uncomment to run the bandwidth profile of the geometry-aware BD layouts
+//#define TRAFFIC_PROFILE
+
+//uncomment to run the bandwidth scaling over 1 to Hal_CdmaCount() CDMA
+//engines
+//#define STRIPE_SCALING
+
+//uncomment to run the bandwidth sweep of the CDMA datapath over BD lengths,
+//the numbers to compare between build.tcl --cdma_* variants
+//#define DATAPATH_SWEEP
+
+//uncomment to initialise the DIMM by PL->PL replication of one seed
+//block, timed against writing the same range from PS DDR
+//#define REPLICATE_FILL
+
+//uncomment to run the refresh hold test, which checks every region of the
+//DIMM once it has held its data over refresh windows of the MIG
+//#define HOLD_TEST
+
+//uncomment to run the CPU-direct March tests
+//#define MARCH_TEST
+
+//uncomment to map the DIMM write-back cacheable for MATS+ and March C-.
+//March SS always runs non-cacheable, so the reads that follow a write inside
+//one of its elements reach the DIMM instead of the cache
+//#define MARCH_CACHED
+
+/* Per-stage time spent by the pipelined access range test, in timer ticks */
+typedef struct {
+	u64 FillTicks;		/* CPU writing the source pattern */
+	u64 SubmitTicks;	/* CPU building and queueing BDs */
+	u64 VerifyTicks;	/* CPU comparing source and destination */
+	u64 WaitTicks;		/* CPU idle, waiting for the DMA */
+	u64 DmaTicks;		/* DMA busy, as observed by the CPU */
+	u32 CachedFills;	/* batches sent from the pattern cache */
+	u32 ReadBacks;		/* batches verified from a DMA read-back */
+	StatsRun *Run;		/* per-batch timing, NULL to skip */
+} PipelineStats;
+
+/* Cost of BD ring setup with the persistent session, in timer ticks */
+typedef struct {
+	u64 RebuildTicks;	/* one init_cdma + full ring create, as every
+				 * batch used to do */
+	u64 OpenTicks;		/* building the session chains, once */
+	u64 SubmitTicks;	/* patching and queueing chains, all batches */
+	u32 Batches;
+} RingSessionStats;
+
+/* Writes the source buffer of one pipelined batch. Returns the bus address
+ * to send the batch from, SrcAddr or a resident block with the same data.
+ */
+typedef UINTPTR (*PipelineFillFn)(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg);
+
+/* Checks the destination buffer of one pipelined batch */
+typedef int (*PipelineVerifyFn)(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg);
+
+/* Pattern selection handed to XMt_FillBatch */
+typedef struct {
+	s32 ModeVal;
+	u64 *Pattern;
+} XMtFillArg;
+
+/* Pipeline argument of the direction sweep */
+typedef struct {
+	XMtFillArg Fill;
+	UINTPTR Base;		/* PL DDR4 address of the first batch */
+	u32 NumBatches;
+} DirSweepArg;
+
+/* One CPU's slice of the multi-core sweep and what that CPU did. Next is
+ * shared with the other CPUs, which take chunks from it once their own
+ * slice is empty. Aligned so the CPUs do not share cache lines.
+ */
+typedef struct {
+	volatile u32 Next;	/* next chunk of the slice to hand out */
+	u32 End;		/* one past the last chunk of the slice */
+	u32 Chunks;		/* chunks this CPU tested */
+	u32 Stolen;		/* of which taken from another slice */
+	u64 CpuTicks;		/* pattern generation and verification */
+	u64 DmaTicks;		/* waiting for the DMA, lock included */
+	u64 WallTicks;
+} __attribute__((aligned(64))) McSlice;
+
+/* Shared state of one mode of the multi-core sweep */
+typedef struct {
+	UINTPTR Base;		/* PL DDR4 address of chunk 0 */
+	XMtFillArg Fill;
+	int NumCpus;
+	volatile u32 DmaLock;	/* one CPU submits or reaps at a time */
+	u32 Submitted;		/* BDs given to the CDMA, under DmaLock */
+	volatile u32 Failed;
+	volatile u32 BadChunks;	/* chunks that failed the data check */
+	volatile u32 XferFails;	/* chunks whose transfer failed */
+	int FailCpu;		/* CPU and chunk of the first of those, */
+	UINTPTR FailAddr;	/* printed by CPU 0 after the sweep */
+	StatsRun *Run;		/* per-batch timing, shared by the CPUs */
+	volatile u32 StatsLock;
+	McSlice Slice[HAL_MAX_CPUS];
+#ifdef CHECKPOINT_RESUME
+	u32 Step;		/* checkpoint step of the mode */
+	volatile u32 RegionChunks[CKPT_MAX_REGIONS];	/* chunks tested */
+	volatile u32 RegionBad[CKPT_MAX_REGIONS];	/* chunks that failed */
+#endif
+} McSweep;
+
 /***************** Macros (Inline Functions) Definitions *********************/
 #define XMT_RANDOM_VALUE(x) (0x12345678+19*(x)+0x017c1e2313567c9b)
 #define XMT_YLFSR(a) ((a << 1) + (((a >> 60) & 1) ^ ((a >> 54) & 1) ^ 1))
@@ -145,26 +454,82 @@ extern void xil_printf(const char *format, ...);
 static void Uart550_Setup(void);
 #endif
 
-static int CheckCompletion(XAxiCdma *InstancePtr);
-static int SetupTransfer(XAxiCdma * InstancePtr);
-static int DoTransfer(XAxiCdma * InstancePtr);
-static int CheckData(u8 *SrcPtr, u8 *DestPtr, int Length);
+static int CheckCompletion(HalCdma *InstancePtr);
+static void WaitCompletion(int Seen);
+static void PrepareBatch(UINTPTR SrcAddr, UINTPTR DstAddr, u32 Length);
+static int DoTransfer(HalCdma * InstancePtr, UINTPTR SrcAddr, UINTPTR DstAddr);
+static int TransferBatch(UINTPTR SrcAddr, UINTPTR DstAddr);
+static int CheckData(UINTPTR SrcAddr, UINTPTR DestAddr, int Length);
+static int CheckDataAt(UINTPTR SrcAddr, UINTPTR DestAddr, int Length,
+		UINTPTR PlAddr);
 int XAxiCdma_SgPollExample(u16 DeviceId);
+int init_cdma(u16 DeviceId);
+int open_ring_session(u16 DeviceId);
+void close_ring_session(void);
 static int XMt_Memtest(u16 DeviceId, s32 ModeVal, u64 *Pattern);
+static UINTPTR XMt_FillBatch(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg);
+#ifdef PATTERN_CACHE
+static UINTPTR XMt_PatternCache(s32 ModeVal, u64 *Pattern);
+#endif
+static int XMt_CheckBatch(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg);
+static int XMt_CheckPattern(UINTPTR DstAddr, UINTPTR PatternAddr,
+		UINTPTR PlAddr, const XMtFillArg *FillArg);
+static u64 XMt_GetRefVal(u64 Addr, u64 Index, s32 ModeVal, u64 *Pattern);
+static UINTPTR XMt_PlAddr(UINTPTR SrcAddr, UINTPTR DstAddr);
+static int SetupTransfer_MOD(UINTPTR SrcAddr, UINTPTR DstAddr, s32 ModeVal,
+		u64 *Pattern, u32 Length);
+static void XMt_FillGeneric(u64 *Dst, UINTPTR Addr, s32 ModeVal, u64 *Pattern,
+		u32 Length);
+static void XMt_FillPattern(u64 *Dst, UINTPTR Addr, s32 ModeVal, u64 *Pattern,
+		u32 Length);
+void PrintRingSessionStats(void);
+void PrintBatchStats(void);
 
 /************************** Variable Definitions *****************************/
 
 
-static XAxiCdma AxiCdmaInstance;	/* Instance of the XAxiCdma */
+static HalCdma *AxiCdmaInstancePtr;	/* Instance of the XAxiCdma */
+
+/* The CDMA is initialized and the BD chains are built once, by the first
+ * batch. Later batches only patch the addresses.
+ */
+static int RingSessionOpen = 0;
+static RingSessionStats RingStats;
+
+/* Direction of the pipelined tests. WRITE_TEST picks the default. */
+#ifdef WRITE_TEST
+static int TestDirection = DIR_WRITE;
+#else
+static int TestDirection = DIR_READ;
+#endif
+
+static const char *DirectionName[NUM_DIRECTIONS] = {
+	"PS->PL write", "PL->PS read", "PL->PL copy", "duplex"
+};
+
+static const char *KBenchName[KBENCH_NUM_KERNELS] = {
+	"prepare", "setup", "getref", "check", "checkbatch", "submit"
+};
+
+#ifdef PATTERN_CACHE
+/* Bit n: the block of mode n in the pattern cache is generated and flushed */
+static u32 PatternCached = 0;
+#endif
+
+/* Per-batch timing of the range tests, printed by PrintBatchStats */
+static StatsRun AccessRun;
+static StatsRun SweepRun;
+static StatsRun DirectionRun[NUM_DIRECTIONS];
 
-/* Transmit buffer for DMA transfer.
+/* Transmit buffer for DMA transfer. These are bus addresses, use Hal_Ptr()
+ * to access them from the CPU.
  */
 #ifdef WRITE_TEST
-static u8 *TransmitBufferPtr = (u8 *) PS_DDR_BASE;
-static u8 *ReceiveBufferPtr = (u8 *) PL_DDR4_BASE;
+static UINTPTR TransmitBufferAddr = PS_DDR_BASE;
+static UINTPTR ReceiveBufferAddr = PL_DDR4_BASE;
 #else
-static u8 *TransmitBufferPtr = (u8 *) PL_DDR4_BASE;
-static u8 *ReceiveBufferPtr = (u8 *) PS_DDR_BASE;
+static UINTPTR TransmitBufferAddr = PL_DDR4_BASE;
+static UINTPTR ReceiveBufferAddr = PS_DDR_BASE;
 #endif
 
 /* Shared variables used to test the callbacks.
@@ -172,8 +537,108 @@ static u8 *ReceiveBufferPtr = (u8 *) PS_DDR_BASE;
 volatile static int Done = 0;	/* Dma transfer is done */
 volatile static int Error = 0;	/* Dma Bus Error occurs */
 
-/* Pattern for a 64Bit Memory */
-static u64 Pattern64Bit[16] = {
+/* Completion mode of the ring session. With interrupts the handler updates
+ * Done and Error, and bumps CdmaEvents every time it runs.
+ */
+#ifdef INTERRUPT_COMPLETION
+static int IntrCompletion = 1;
+#else
+static int IntrCompletion = 0;
+#endif
+static u32 CoalesceThreshold = COALESCE_THRESHOLD;
+
+/* Verification of the pipelined tests. With DMA read-back every batch
+ * written to the PL DDR4 is copied back into a staging buffer in PS DDR and
+ * compared there. READBACK_VERIFY picks the default.
+ */
+#ifdef READBACK_VERIFY
+static int ReadBackVerify = 1;
+#else
+static int ReadBackVerify = 0;
+#endif
+volatile static int CdmaEvents = 0;	/* completion interrupts taken */
+static u64 IntrWaitTicks;		/* CPU asleep in WaitCompletion */
+
+#ifdef CHECKPOINT_RESUME
+/* Progress of the access range test and the pattern sweep over the PL DDR4 */
+static Ckpt Checkpoint;
+#ifdef RETEST_ONLY
+static int RetestOnly = 1;
+#else
+static int RetestOnly = 0;
+#endif
+#endif
+
+/* Every bad word found by a data check or March test, by DRAM coordinates */
+static FaultLog DimmFaults;
+static volatile u32 FailedBatches;	/* batches that failed a data check */
+static volatile u32 PrintLock;		/* CPUs of the multi-core sweep print
+					   one failure at a time */
+
+/* Pattern for a 64Bit Memory, for modes 9 and 10. Row 0 repeats the 16
+ * word base pattern, row 1 inverts byte bit ((Index >> 4) & 7) of it:
+ *
+ *	MaskPattern64Bit[0][i] = Pattern64Bit[i & 15]
+ *	MaskPattern64Bit[1][i] = Pattern64Bit[i & 15] ^ (0x0101010101010101 << ((i >> 4) & 7))
+ */
+static u64 MaskPattern64Bit[2][128] = {
+	{
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0x0000000000000000, 0x0000000000000000,
+	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF,
+	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
+	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
 	0x0000000000000000, 0x0000000000000000,
 	0xFFFFFFFFFFFFFFFF, 0x0000000000000000,
 	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
@@ -182,14 +647,73 @@ static u64 Pattern64Bit[16] = {
 	0x0000000000000000, 0xFFFFFFFFFFFFFFFF,
 	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF,
 	0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF
-};
-
-/* Invert Mask for inverting the Pattern for 64Bit Memory */
-static u64 InvertMask64Bit[8] = {
-	0x0101010101010101, 0x0202020202020202,
-	0x0404040404040404, 0x0808080808080808,
-	0x1010101010101010, 0x2020202020202020,
-	0x4040404040404040, 0x8080808080808080
+	},
+	{
+	0x0101010101010101, 0x0101010101010101,
+	0xFEFEFEFEFEFEFEFE, 0x0101010101010101,
+	0x0101010101010101, 0xFEFEFEFEFEFEFEFE,
+	0x0101010101010101, 0xFEFEFEFEFEFEFEFE,
+	0xFEFEFEFEFEFEFEFE, 0xFEFEFEFEFEFEFEFE,
+	0x0101010101010101, 0xFEFEFEFEFEFEFEFE,
+	0xFEFEFEFEFEFEFEFE, 0x01010101FEFEFEFE,
+	0xFEFEFEFEFEFEFEFE, 0x01010101FEFEFEFE,
+	0x0202020202020202, 0x0202020202020202,
+	0xFDFDFDFDFDFDFDFD, 0x0202020202020202,
+	0x0202020202020202, 0xFDFDFDFDFDFDFDFD,
+	0x0202020202020202, 0xFDFDFDFDFDFDFDFD,
+	0xFDFDFDFDFDFDFDFD, 0xFDFDFDFDFDFDFDFD,
+	0x0202020202020202, 0xFDFDFDFDFDFDFDFD,
+	0xFDFDFDFDFDFDFDFD, 0x02020202FDFDFDFD,
+	0xFDFDFDFDFDFDFDFD, 0x02020202FDFDFDFD,
+	0x0404040404040404, 0x0404040404040404,
+	0xFBFBFBFBFBFBFBFB, 0x0404040404040404,
+	0x0404040404040404, 0xFBFBFBFBFBFBFBFB,
+	0x0404040404040404, 0xFBFBFBFBFBFBFBFB,
+	0xFBFBFBFBFBFBFBFB, 0xFBFBFBFBFBFBFBFB,
+	0x0404040404040404, 0xFBFBFBFBFBFBFBFB,
+	0xFBFBFBFBFBFBFBFB, 0x04040404FBFBFBFB,
+	0xFBFBFBFBFBFBFBFB, 0x04040404FBFBFBFB,
+	0x0808080808080808, 0x0808080808080808,
+	0xF7F7F7F7F7F7F7F7, 0x0808080808080808,
+	0x0808080808080808, 0xF7F7F7F7F7F7F7F7,
+	0x0808080808080808, 0xF7F7F7F7F7F7F7F7,
+	0xF7F7F7F7F7F7F7F7, 0xF7F7F7F7F7F7F7F7,
+	0x0808080808080808, 0xF7F7F7F7F7F7F7F7,
+	0xF7F7F7F7F7F7F7F7, 0x08080808F7F7F7F7,
+	0xF7F7F7F7F7F7F7F7, 0x08080808F7F7F7F7,
+	0x1010101010101010, 0x1010101010101010,
+	0xEFEFEFEFEFEFEFEF, 0x1010101010101010,
+	0x1010101010101010, 0xEFEFEFEFEFEFEFEF,
+	0x1010101010101010, 0xEFEFEFEFEFEFEFEF,
+	0xEFEFEFEFEFEFEFEF, 0xEFEFEFEFEFEFEFEF,
+	0x1010101010101010, 0xEFEFEFEFEFEFEFEF,
+	0xEFEFEFEFEFEFEFEF, 0x10101010EFEFEFEF,
+	0xEFEFEFEFEFEFEFEF, 0x10101010EFEFEFEF,
+	0x2020202020202020, 0x2020202020202020,
+	0xDFDFDFDFDFDFDFDF, 0x2020202020202020,
+	0x2020202020202020, 0xDFDFDFDFDFDFDFDF,
+	0x2020202020202020, 0xDFDFDFDFDFDFDFDF,
+	0xDFDFDFDFDFDFDFDF, 0xDFDFDFDFDFDFDFDF,
+	0x2020202020202020, 0xDFDFDFDFDFDFDFDF,
+	0xDFDFDFDFDFDFDFDF, 0x20202020DFDFDFDF,
+	0xDFDFDFDFDFDFDFDF, 0x20202020DFDFDFDF,
+	0x4040404040404040, 0x4040404040404040,
+	0xBFBFBFBFBFBFBFBF, 0x4040404040404040,
+	0x4040404040404040, 0xBFBFBFBFBFBFBFBF,
+	0x4040404040404040, 0xBFBFBFBFBFBFBFBF,
+	0xBFBFBFBFBFBFBFBF, 0xBFBFBFBFBFBFBFBF,
+	0x4040404040404040, 0xBFBFBFBFBFBFBFBF,
+	0xBFBFBFBFBFBFBFBF, 0x40404040BFBFBFBF,
+	0xBFBFBFBFBFBFBFBF, 0x40404040BFBFBFBF,
+	0x8080808080808080, 0x8080808080808080,
+	0x7F7F7F7F7F7F7F7F, 0x8080808080808080,
+	0x8080808080808080, 0x7F7F7F7F7F7F7F7F,
+	0x8080808080808080, 0x7F7F7F7F7F7F7F7F,
+	0x7F7F7F7F7F7F7F7F, 0x7F7F7F7F7F7F7F7F,
+	0x8080808080808080, 0x7F7F7F7F7F7F7F7F,
+	0x7F7F7F7F7F7F7F7F, 0x808080807F7F7F7F,
+	0x7F7F7F7F7F7F7F7F, 0x808080807F7F7F7F
+	}
 };
 
 /* Aggressor Pattern for 64Bit Eye Test */
@@ -297,9 +821,9 @@ int access_range_test(){
 	long offset = NUMBER_OF_BDS_TO_TRANSFER * MAX_PKT_LEN;
 	u32 itr = 0;
 	xil_printf("\r\n--- Access Range Test - BEGIN --- \r\n");
-	xil_printf("\r\nTransmitBufferPtr (TX) address: 0x%lx\r\n", TransmitBufferPtr);
-	xil_printf("ReceiveBufferPtr (RX) address: 0x%lx\r\n", ReceiveBufferPtr);
-	xil_printf("size of testing PL DDR4: %lGB\r\n", (PL_DDR4_SIZE >> 30));
+	xil_printf("\r\nTransmitBufferAddr (TX) address: 0x%lx\r\n", TransmitBufferAddr);
+	xil_printf("ReceiveBufferAddr (RX) address: 0x%lx\r\n", ReceiveBufferAddr);
+	xil_printf("size of testing PL DDR4: %luGB\r\n", (PL_DDR4_SIZE >> 30));
 	xil_printf("length of each packet: %lu\r\n", MAX_PKT_LEN);
 	xil_printf("number of BDs: %lu\r\n", NUMBER_OF_BDS_TO_TRANSFER);
 	xil_printf("address offset: %lu\r\n\r\n", offset);
@@ -316,11 +840,15 @@ int access_range_test(){
 
 		//increment PL DDR4 ADDR by offset
 #ifdef WRITE_TEST
-		xil_printf("[%d/%d base: 0x%lx] PASSED\r\n", itr+1, NUM_REPEAT_TEST, ReceiveBufferPtr);
-		ReceiveBufferPtr += offset;
+		if (Log_PrintDue() || itr + 1 == NUM_REPEAT_TEST) {
+			xil_printf("[%d/%d base: 0x%lx] PASSED\r\n", itr+1, NUM_REPEAT_TEST, ReceiveBufferAddr);
+		}
+		ReceiveBufferAddr += offset;
 #else
-		xil_printf("[%d/%d base: 0x%lx] PASSED\r\n", itr+1, NUM_REPEAT_TEST, TransmitBufferPtr);
-		TransmitBufferPtr += offset;
+		if (Log_PrintDue() || itr + 1 == NUM_REPEAT_TEST) {
+			xil_printf("[%d/%d base: 0x%lx] PASSED\r\n", itr+1, NUM_REPEAT_TEST, TransmitBufferAddr);
+		}
+		TransmitBufferAddr += offset;
 #endif
 	}
 
@@ -330,107 +858,2677 @@ int access_range_test(){
 	return XST_SUCCESS;
 }
 
+/* Source and destination of batch Batch at PL DDR4 address PlAddr when
+ * moving in direction Dir. PsAddr is the PS DDR buffer of the batch and
+ * PeerAddr the PL DDR4 address a copy reads from.
+ */
+static void DirectionAddr(int Dir, u32 Batch, UINTPTR PlAddr, UINTPTR PsAddr,
+		UINTPTR PeerAddr, UINTPTR *SrcAddr, UINTPTR *DstAddr)
+{
+	if (Dir == DIR_DUPLEX) {
+		Dir = (Batch & 1) ? DIR_READ : DIR_WRITE;
+	}
 
-/* Modified XMt_MemtestAll function in dram-test application so that it would be compatible with PL DDR testing  */
-int diff_access_pattern_test(){
-	u8 Mode;
-	u32 Index;
-	u32 InvMaskInd;
-	u64 Pattern[2][128];
-	int Status;
-
-	xil_printf("--- Different Access Pattern Test - BEGIN --- \r\n");
-	for (Index = 0U; Index < 128U; Index++) {
-		InvMaskInd = (Index >> 4) & 0x07;
-		Pattern[0][Index] = Pattern64Bit[Index & 15];
-		Pattern[1][Index] = Pattern64Bit[Index & 15] ^ InvertMask64Bit[InvMaskInd];
+	switch (Dir) {
+	case DIR_WRITE:
+		*SrcAddr = PsAddr;
+		*DstAddr = PlAddr;
+		break;
+	case DIR_READ:
+		*SrcAddr = PlAddr;
+		*DstAddr = PsAddr;
+		break;
+	default:
+		*SrcAddr = PeerAddr;
+		*DstAddr = PlAddr;
+		break;
 	}
+}
 
-	for (Mode = 0U; Mode < XMT_MAX_MODE_NUM; Mode++) {
-		if ((Mode == 0U) || (Mode > 10U)) {
-			Status = XMt_Memtest(DMA_CTRL_DEVICE_ID, Mode, NULL);
-		} else if (Mode <= 8U) {
-			Status = XMt_Memtest(DMA_CTRL_DEVICE_ID, Mode, TestPattern[Mode]);
-		} else { //Mode == 9U || 10U
-			Status= XMt_Memtest(DMA_CTRL_DEVICE_ID, Mode, &Pattern[Mode - 9][0]);
-		}
+/* Source and destination of batch Batch of a pipelined run in TestDirection.
+ * The PS DDR side rotates through PIPELINE_DEPTH buffers, the PL DDR4 side
+ * walks the range from PlBase. A copy reads from the batch half the range
+ * away, which is at least PIPELINE_DEPTH batches from anything in flight.
+ */
+static void PipelineBatchAddr(UINTPTR PlBase, u32 NumBatches, u32 Batch,
+		UINTPTR *SrcAddr, UINTPTR *DstAddr)
+{
+	UINTPTR PsAddr = PS_DDR_BASE + (Batch % PIPELINE_DEPTH) * BATCH_LEN;
+	UINTPTR PlAddr = PlBase + (UINTPTR)Batch * BATCH_LEN;
+	UINTPTR PeerAddr = PlBase +
+		(UINTPTR)((Batch + NumBatches / 2) % NumBatches) * BATCH_LEN;
 
-		if(Status != XST_SUCCESS){
-			xil_printf("Access Pattern Test failed at Mode: %d\r\n", Mode);
-			return XST_FAILURE;
-		}
+	DirectionAddr(TestDirection, Batch, PlAddr, PsAddr, PeerAddr, SrcAddr,
+		DstAddr);
+}
 
-		xil_printf("[%d/%d] PASSED\r\n", Mode, XMT_MAX_MODE_NUM);
+static void PrintPipelineStats(const PipelineStats *Stats, u64 WallTicks,
+		u64 Bytes)
+{
+	u64 Serial = Stats->FillTicks + Stats->SubmitTicks +
+		Stats->VerifyTicks + Stats->DmaTicks;
+	u64 WallUs = HAL_TICKS_TO_US(WallTicks);
+	u64 Overlap = 0;
+
+	if (Serial > WallTicks) {
+		Overlap = (Serial - WallTicks) * 100 / Serial;
 	}
-	xil_printf("\r\n--- Different Access Pattern Test - End --- \r\n\r\n");
 
-	return XST_SUCCESS;
+	xil_printf("\r\nPipeline depth: %d batches\r\n", PIPELINE_DEPTH);
+	xil_printf("  fill   : %lu us", (unsigned long)HAL_TICKS_TO_US(Stats->FillTicks));
+	if (Stats->CachedFills) {
+		xil_printf(", %lu batches sent from the pattern cache",
+			(unsigned long)Stats->CachedFills);
+	}
+	xil_printf("\r\n");
+	xil_printf("  submit : %lu us\r\n", (unsigned long)HAL_TICKS_TO_US(Stats->SubmitTicks));
+	xil_printf("  dma    : %lu us\r\n", (unsigned long)HAL_TICKS_TO_US(Stats->DmaTicks));
+	xil_printf("  verify : %lu us", (unsigned long)HAL_TICKS_TO_US(Stats->VerifyTicks));
+	if (Stats->ReadBacks) {
+		xil_printf(", %lu batches read back by DMA",
+			(unsigned long)Stats->ReadBacks);
+	}
+	xil_printf("\r\n");
+	xil_printf("  idle   : %lu us\r\n", (unsigned long)HAL_TICKS_TO_US(Stats->WaitTicks));
+	xil_printf("  stages : %lu us serial, %lu us wall, %lu%% overlapped\r\n",
+		(unsigned long)HAL_TICKS_TO_US(Serial), (unsigned long)WallUs,
+		(unsigned long)Overlap);
+	if (WallUs) {
+		xil_printf("  dma busy %lu%% of wall time, %lu MB/s\r\n",
+			(unsigned long)(Stats->DmaTicks * 100 / WallTicks),
+			(unsigned long)(Bytes / WallUs));
+	}
+}
+
+/* Drop the chains a pipelined run that stops early leaves on the CDMA */
+static void AbortPipeline(void)
+{
+	Hal_CdmaReset(AxiCdmaInstancePtr, RESET_LOOP_COUNT);
+	close_ring_session();
 }
 
 /*****************************************************************************/
 /**
-* The entry point for this example. It sets up uart16550 if one is available,
-* invokes the example function, and reports the execution status.
+* Run NumBatches batches from PlBase through the DMA with up to
+* PIPELINE_DEPTH batches in flight: while the DMA works on batch N, the CPU
+* verifies batch N-1 and generates and submits batch N+1.
 *
-* @param	None.
+* A batch buffer is only reused once it has been verified, so the PS DDR
+* side needs PIPELINE_DEPTH * BATCH_LEN bytes whatever the range size. Each
+* batch in flight uses one chain of the BD ring session.
+*
+* With ReadBackVerify, a batch whose destination is the PL DDR4 is followed
+* on the CDMA by a second chain that copies the destination back into its
+* staging buffer at READBACK_BASE. The CPU compares the staging buffer with
+* cached loads, batch N-1 while the DMA writes and reads back batch N.
+*
+* @param	PlBase is the PL DDR4 bus address of the first batch
+* @param	NumBatches is the number of BATCH_LEN batches to run
+* @param	Fill writes the source buffer of a batch before it is sent
+* @param	Verify checks the destination of a finished batch, NULL to
+*		compare it against the source buffer with CheckData. With a
+*		read-back it gets the PL DDR4 destination and the staging
+*		buffer as source and destination.
+* @param	FillArg is passed to Fill and Verify
+* @param	Stats accumulates the per-stage timings
+* @param	Verbose prints progress lines, as often as Log_PrintDue allows
 *
 * @return
-*		- XST_SUCCESS if example finishes successfully
-*		- XST_FAILURE if example fails.
+*		- XST_SUCCESS if every batch matches
+*		- XST_FAILURE if a transfer fails or the data does not match
 *
-* @note		None.
+* @note		A run that stops early resets the CDMA and closes the ring
+*		session, so chains it left in flight cannot complete into the
+*		next run.
 *
 ******************************************************************************/
-#ifndef TESTAPP_GEN
-int main()
+static int RunPipeline(UINTPTR PlBase, u32 NumBatches, PipelineFillFn Fill,
+		PipelineVerifyFn Verify, void *FillArg, PipelineStats *Stats,
+		int Verbose)
 {
 	int Status;
-
-#ifdef XPAR_UARTNS550_0_BASEADDR
-	Uart550_Setup();
-#endif
-
-	xil_printf("\r\n--- Entering main() --- \r\n");
-
-	//access range test
-	Status = access_range_test();
-	if(Status != XST_SUCCESS){
-		xil_printf("Access Range Test failed\r\n");
+	u32 Issued = 0;		/* batches submitted to the DMA */
+	u32 Completed = 0;	/* batches the DMA has finished */
+	u32 Verified = 0;	/* batches checked by the CPU */
+	u32 BadBatches = 0;	/* batches that failed the check */
+	StatsBatch Timing[PIPELINE_DEPTH];
+	StatsBatch *Batch;
+	u64 LastDoneTick = 0;
+	u64 Now;
+	int Events;
+	UINTPTR SrcAddr;
+	UINTPTR DstAddr;
+	UINTPTR SendAddr;
+	UINTPTR StagingAddr;
+	/* Write and copy batches all land in the PL DDR4 */
+	int ReadBack = ReadBackVerify && (TestDirection == DIR_WRITE ||
+		TestDirection == DIR_COPY);
+	u32 BatchBds = ReadBack ? 2 * NUMBER_OF_BDS_TO_TRANSFER :
+		NUMBER_OF_BDS_TO_TRANSFER;
+
+	if (TestDirection == DIR_COPY && NumBatches < 2 * PIPELINE_DEPTH) {
+		xil_printf("PL->PL copy needs at least %d batches\r\n",
+			2 * PIPELINE_DEPTH);
 		return XST_FAILURE;
 	}
 
-	//reset transmit/receive address to the base address
-#ifdef WRITE_TEST
-	TransmitBufferPtr = (u8 *) PS_DDR_BASE;
-	ReceiveBufferPtr = (u8 *) PL_DDR4_BASE;
-#else
-	TransmitBufferPtr = (u8 *) PL_DDR4_BASE;
-	ReceiveBufferPtr = (u8 *) PS_DDR_BASE;
-#endif
-
-	//different pattern testing (referred to DRAM Test provided by Vivado SDK, originally for PS DDR)
-	Status = diff_access_pattern_test();
-	if(Status != XST_SUCCESS){
-		xil_printf("Access Pattern Test failed\r\n");
+	Status = open_ring_session(DMA_CTRL_DEVICE_ID);
+	if (Status != XST_SUCCESS) {
+		xil_printf("CDMA Initialization failed\r\n");
 		return XST_FAILURE;
 	}
 
-	xil_printf("Successfully ran all tests\r\n");
-	xil_printf("--- Exiting main() --- \r\n");
+	Done = 0;
+	Error = 0;
 
-	return XST_SUCCESS;
-}
-#endif
+	while (Verified < NumBatches) {
+		/* Keep the DMA fed first: generate and submit the next batch
+		 * as soon as its buffer has been verified.
+		 */
+		if (Issued < NumBatches && Issued - Verified < PIPELINE_DEPTH) {
+			PipelineBatchAddr(PlBase, NumBatches, Issued, &SrcAddr,
+				&DstAddr);
+			Batch = &Timing[Issued % PIPELINE_DEPTH];
+			Batch->PlAddr = XMt_PlAddr(SrcAddr, DstAddr);
+			Batch->Length = BATCH_LEN;
+
+			Batch->SetupStart = Hal_TimeNow();
+			SendAddr = Fill(SrcAddr, DstAddr, FillArg);
+			Now = Hal_TimeNow();
+			Stats->FillTicks += Now - Batch->SetupStart;
+			if (SendAddr != SrcAddr) {
+				Stats->CachedFills++;
+			}
 
+			Status = DoTransfer(AxiCdmaInstancePtr, SendAddr, DstAddr);
+			if (Status == XST_SUCCESS && ReadBack) {
+				/* The CDMA runs the chains in order, so the
+				 * read-back starts once the batch is written.
+				 */
+				Status = DoTransfer(AxiCdmaInstancePtr, DstAddr,
+					READBACK_BASE + (Issued % PIPELINE_DEPTH) *
+					BATCH_LEN);
+			}
+			if (Status != XST_SUCCESS) {
+				xil_printf("Submit failed for batch %d\r\n", Issued);
+				AbortPipeline();
+				return XST_FAILURE;
+			}
+			Batch->Submit = Hal_TimeNow();
+			Stats->SubmitTicks += Batch->Submit - Now;
+			Issued++;
+			continue;
+		}
 
-#if defined(XPAR_UARTNS550_0_BASEADDR)
-/*****************************************************************************/
-/*
-* This function setup the baudrate to 9600 and data bits to 8 in Uart16550
-*
-* @param	None
-*
-* @return	None
+		/* Collect finished batches. BDs complete in order, so the
+		 * number of finished batches follows from the BD count.
+		 */
+		Now = Hal_TimeNow();
+		Events = CdmaEvents;
+		CheckCompletion(AxiCdmaInstancePtr);
+		if (Error) {
+			xil_printf("Transfer failed in batch %d\r\n", Completed);
+			AbortPipeline();
+			return XST_FAILURE;
+		}
+
+		while (Completed < Done / BatchBds) {
+			Batch = &Timing[Completed % PIPELINE_DEPTH];
+			Batch->DmaStart = Batch->Submit;
+			Batch->DmaDone = Hal_TimeNow();
+
+			/* The DMA only starts on a batch once the one queued
+			 * before it is done.
+			 */
+			if (Batch->DmaStart < LastDoneTick) {
+				Batch->DmaStart = LastDoneTick;
+			}
+			Stats->DmaTicks += Batch->DmaDone - Batch->DmaStart;
+			LastDoneTick = Batch->DmaDone;
+			Completed++;
+		}
+
+		if (Verified == Completed) {
+			/* Nothing to check yet, store the result records */
+			Log_Drain();
+			WaitCompletion(Events);
+			Stats->WaitTicks += Hal_TimeNow() - Now;
+			continue;
+		}
+
+		PipelineBatchAddr(PlBase, NumBatches, Verified, &SrcAddr,
+			&DstAddr);
+		Batch = &Timing[Verified % PIPELINE_DEPTH];
+
+		Batch->VerifyStart = Hal_TimeNow();
+		if (ReadBack) {
+			/* The CPU never writes the staging buffer, so dropping
+			 * its lines after the DMA is enough.
+			 */
+			StagingAddr = READBACK_BASE +
+				(Verified % PIPELINE_DEPTH) * BATCH_LEN;
+			Hal_DCacheInvalidateRange(StagingAddr, BATCH_LEN);
+			if (Verify) {
+				Status = Verify(DstAddr, StagingAddr, FillArg);
+			} else {
+				Status = CheckDataAt(SrcAddr, StagingAddr,
+					BATCH_LEN, DstAddr);
+			}
+			Stats->ReadBacks++;
+		} else if (Verify) {
+			Status = Verify(SrcAddr, DstAddr, FillArg);
+		} else {
+			Status = CheckData(SrcAddr, DstAddr, BATCH_LEN);
+		}
+		Batch->VerifyDone = Hal_TimeNow();
+		Stats->VerifyTicks += Batch->VerifyDone - Batch->VerifyStart;
+		if (Stats->Run) {
+			Stats_RecordBatch(Stats->Run, Batch);
+		}
+		Log_Batch(Batch, Status);
+		if (Status != XST_SUCCESS) {
+			if (FailedBatches <= FAIL_PRINT_BATCHES) {
+				xil_printf("[%d/%d base: 0x%lx] FAILED\r\n",
+					Verified+1, NumBatches,
+					PlBase + (UINTPTR)Verified * BATCH_LEN);
+			}
+#ifdef CONTINUE_ON_FAIL
+			BadBatches++;
+			Verified++;
+			continue;
+#else
+			AbortPipeline();
+			return XST_FAILURE;
+#endif
+		}
+
+		if (Verbose && Log_PrintDue()) {
+			xil_printf("[%d/%d base: 0x%lx] PASSED\r\n", Verified+1,
+				NumBatches, PlBase + (UINTPTR)Verified * BATCH_LEN);
+		}
+		Verified++;
+	}
+
+	if (BadBatches) {
+		xil_printf("%d of %d batches FAILED\r\n", BadBatches, NumBatches);
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* RunPipeline over a range, one checkpoint region at a time.
+*
+* Regions the checkpoint says are done for Step are skipped. After every
+* other region the outcome goes into the checkpoint and the checkpoint is
+* stored, so a reset loses at most one region of work. Without
+* CHECKPOINT_RESUME this is one RunPipeline over the whole range.
+*
+* @param	Step is the checkpoint step of the test
+* @param	Base is the PL DDR4 bus address of the range, BATCH_LEN aligned
+* @param	Size is the number of bytes, a multiple of BATCH_LEN
+* @param	Fill, Verify, FillArg, Stats and Verbose are as for
+*		RunPipeline
+* @param	TestedPtr receives the number of bytes actually run
+*
+* @return
+*		- XST_SUCCESS if every region run passes
+*		- XST_FAILURE otherwise. With CONTINUE_ON_FAIL the remaining
+*		  regions are still run.
+*
+******************************************************************************/
+static int RunCheckpointed(u32 Step, UINTPTR Base, u64 Size,
+		PipelineFillFn Fill, PipelineVerifyFn Verify, void *FillArg,
+		PipelineStats *Stats, int Verbose, u64 *TestedPtr)
+{
+#ifdef CHECKPOINT_RESUME
+	u64 Offset = Base - (UINTPTR)Checkpoint.Base;
+	u64 End = Offset + Size;
+	u64 ChunkEnd;
+	u32 Region;
+	int Status;
+	int Result = XST_SUCCESS;
+
+	*TestedPtr = 0;
+	for (; Offset < End; Offset = ChunkEnd) {
+		Region = (u32)(Offset / Checkpoint.RegionLen);
+		ChunkEnd = (u64)(Region + 1) * Checkpoint.RegionLen;
+		if (ChunkEnd > End) {
+			ChunkEnd = End;
+		}
+		if (!Ckpt_Pending(&Checkpoint, Step, Region, RetestOnly)) {
+			continue;
+		}
+
+		Status = RunPipeline((UINTPTR)(Checkpoint.Base + Offset),
+			(u32)((ChunkEnd - Offset) / BATCH_LEN), Fill, Verify,
+			FillArg, Stats, Verbose);
+		*TestedPtr += ChunkEnd - Offset;
+
+		Ckpt_Mark(&Checkpoint, Step, Region, Status == XST_SUCCESS);
+		if (Ckpt_Save(&Checkpoint) != XST_SUCCESS) {
+			xil_printf("Storing the checkpoint failed\r\n");
+		}
+
+		if (Status != XST_SUCCESS) {
+			Result = XST_FAILURE;
+#ifndef CONTINUE_ON_FAIL
+			break;
+#endif
+		}
+	}
+
+	return Result;
+#else
+	*TestedPtr = Size;
+
+	return RunPipeline(Base, (u32)(Size / BATCH_LEN), Fill, Verify, FillArg,
+		Stats, Verbose);
+#endif
+}
+
+static UINTPTR PrepareBatchFill(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	(void)Arg;
+	PrepareBatch(SrcAddr, DstAddr, BATCH_LEN);
+
+	return SrcAddr;
+}
+
+/*****************************************************************************/
+/**
+* Pipelined version of access_range_test, see RunPipeline.
+*
+* @return
+*		- XST_SUCCESS if every batch matches
+*		- XST_FAILURE if a transfer fails or the data does not match
+*
+* @note		Per-stage timings and the achieved overlap are printed at
+*		the end.
+*
+******************************************************************************/
+int access_range_test_pipelined(){
+	int Status;
+	u64 Start;
+	u64 Tested;
+	PipelineStats Stats;
+
+	xil_printf("\r\n--- Pipelined Access Range Test - BEGIN --- \r\n");
+	xil_printf("direction: %s\r\n", DirectionName[TestDirection]);
+	xil_printf("size of testing PL DDR4: %luMB\r\n", (unsigned long)(PL_DDR4_SIZE >> 20));
+	xil_printf("batches: %lu of %lu bytes, %d in flight\r\n\r\n",
+		(unsigned long)NUM_REPEAT_TEST, (unsigned long)BATCH_LEN, PIPELINE_DEPTH);
+
+	memset(&Stats, 0, sizeof(Stats));
+	Stats_RunInit(&AccessRun, "access range", DirectionName[TestDirection],
+		PL_DDR4_BASE,
+		PL_DDR4_SIZE);
+	Stats.Run = &AccessRun;
+	Log_PhaseBegin(LOG_TEST_ACCESS, 0, TestDirection, PL_DDR4_BASE,
+		PL_DDR4_SIZE);
+	Start = Hal_TimeNow();
+
+	Status = RunCheckpointed(STEP_ACCESS_RANGE, PL_DDR4_BASE, PL_DDR4_SIZE,
+		PrepareBatchFill, NULL, NULL, &Stats, 1, &Tested);
+	Log_PhaseEnd(Status, Tested, (u32)(Tested / BATCH_LEN),
+		Hal_TimeNow() - Start);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	if (Tested < PL_DDR4_SIZE) {
+		xil_printf("%luMB already passed, skipped\r\n",
+			(unsigned long)((PL_DDR4_SIZE - Tested) >> 20));
+	}
+	if (Tested) {
+		PrintPipelineStats(&Stats, Hal_TimeNow() - Start, Tested);
+	}
+
+	xil_printf("--- Pipelined Access Range Test - END --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+
+/* Pattern table XMt_GetRefVal uses for Mode */
+static u64 *XMt_ModePattern(u8 Mode)
+{
+	if ((Mode == 0U) || (Mode > 10U)) {
+		return NULL;
+	} else if (Mode <= 8U) {
+		return TestPattern[Mode];
+	} else { //Mode == 9U || 10U
+		return &MaskPattern64Bit[Mode - 9][0];
+	}
+}
+
+/* Modified XMt_MemtestAll function in dram-test application so that it would be compatible with PL DDR testing  */
+int diff_access_pattern_test(){
+	u8 Mode;
+	int Status;
+
+	xil_printf("--- Different Access Pattern Test - BEGIN --- \r\n");
+
+	for (Mode = 0U; Mode < XMT_MAX_MODE_NUM; Mode++) {
+		Status = XMt_Memtest(DMA_CTRL_DEVICE_ID, Mode, XMt_ModePattern(Mode));
+
+		if(Status != XST_SUCCESS){
+			xil_printf("Access Pattern Test failed at Mode: %d\r\n", Mode);
+			return XST_FAILURE;
+		}
+
+		xil_printf("[%d/%d] PASSED\r\n", Mode, XMT_MAX_MODE_NUM);
+	}
+	xil_printf("\r\n--- Different Access Pattern Test - End --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Run every XMt_Memtest mode across a whole range of the PL DDR4 instead of
+* only the first batch.
+*
+* Each mode streams through the range with RunPipeline, generating the
+* pattern one BATCH_LEN batch at a time, so PS DDR use stays at
+* PIPELINE_DEPTH * BATCH_LEN bytes for any range size. Batches are verified
+* against the regenerated pattern, so only the destination is read back.
+*
+* @param	Base is the PL DDR4 bus address to start at, BATCH_LEN aligned
+* @param	Size is the number of bytes to test, a multiple of BATCH_LEN
+*
+* @return
+*		- XST_SUCCESS if every mode passes over the whole range
+*		- XST_FAILURE otherwise
+*
+* @note		Prints the time and throughput of every mode and of the
+*		whole sweep.
+*
+******************************************************************************/
+int diff_access_pattern_sweep(UINTPTR Base, u64 Size){
+	u8 Mode;
+	XMtFillArg Arg;
+	PipelineStats Stats;
+	u64 SweepStart;
+	u64 Start;
+	u64 Us;
+	u64 Tested;
+	u64 SweepTested = 0;
+	int Status;
+
+	if ((Base - PL_DDR4_BASE) % BATCH_LEN || Size % BATCH_LEN || Size == 0 ||
+	    Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid sweep range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Full Range Access Pattern Test - BEGIN --- \r\n");
+	xil_printf("range: 0x%lx - 0x%lx (%luMB), %d modes, %s\r\n\r\n", Base,
+		Base + Size - 1, (unsigned long)(Size >> 20), XMT_MAX_MODE_NUM,
+		DirectionName[TestDirection]);
+	Stats_RunInit(&SweepRun, "pattern sweep", DirectionName[TestDirection],
+		Base, Size);
+	SweepStart = Hal_TimeNow();
+	for (Mode = 0U; Mode < XMT_MAX_MODE_NUM; Mode++) {
+		Arg.ModeVal = Mode;
+		Arg.Pattern = XMt_ModePattern(Mode);
+		memset(&Stats, 0, sizeof(Stats));
+		Stats.Run = &SweepRun;
+
+		Log_PhaseBegin(LOG_TEST_PATTERN, Mode, TestDirection, Base, Size);
+		Start = Hal_TimeNow();
+		Status = RunCheckpointed(STEP_PATTERN(Mode), Base, Size,
+			XMt_FillBatch, XMt_CheckBatch, &Arg, &Stats, 0, &Tested);
+		Log_PhaseEnd(Status, Tested, (u32)(Tested / BATCH_LEN),
+			Hal_TimeNow() - Start);
+		if (Status != XST_SUCCESS) {
+			xil_printf("Access Pattern Test failed at Mode: %d\r\n", Mode);
+			return XST_FAILURE;
+		}
+		SweepTested += Tested;
+
+		Us = HAL_TICKS_TO_US(Hal_TimeNow() - Start);
+		if (Tested == 0) {
+			xil_printf("[%d/%d] already passed, skipped\r\n", Mode,
+				XMT_MAX_MODE_NUM);
+			continue;
+		}
+		xil_printf("[%d/%d] PASSED in %lu ms (%lu MB/s), fill %lu us%s\r\n",
+			Mode, XMT_MAX_MODE_NUM, (unsigned long)(Us / 1000),
+			(unsigned long)(Us ? Tested / Us : 0),
+			(unsigned long)HAL_TICKS_TO_US(Stats.FillTicks),
+			Stats.CachedFills ? " (pattern cache)" : "");
+	}
+
+	Us = HAL_TICKS_TO_US(Hal_TimeNow() - SweepStart);
+	xil_printf("\r\n%d modes, %luMB tested in %lu s (%lu MB/s)\r\n",
+		XMT_MAX_MODE_NUM, (unsigned long)(SweepTested >> 20),
+		(unsigned long)(Us / 1000000),
+		(unsigned long)(Us ? SweepTested / Us : 0));
+	xil_printf("--- Full Range Access Pattern Test - END --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+/* Every CPU of the multi-core sweep has one chain on the CDMA at most */
+#if HAL_MAX_CPUS > RING_SESSION_CHAINS
+#error The multi-core sweep needs a ring session chain per CPU
+#endif
+
+/* Hand out the next chunk for Cpu: from its own slice first, then from the
+ * other slices in turn. Returns 0 once every slice is empty.
+ */
+static int McTakeChunk(McSweep *Sweep, int Cpu, u32 *Chunk)
+{
+	McSlice *Victim;
+	u32 Index;
+	int Offset;
+
+	for (Offset = 0; Offset < Sweep->NumCpus; Offset++) {
+		Victim = &Sweep->Slice[(Cpu + Offset) % Sweep->NumCpus];
+		if (Hal_AtomicLoad(&Victim->Next) >= Victim->End) {
+			continue;
+		}
+
+		Index = Hal_AtomicFetchAdd(&Victim->Next, 1);
+		if (Index < Victim->End) {
+			*Chunk = Index;
+			if (Offset) {
+				Sweep->Slice[Cpu].Stolen++;
+			}
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Wait until the CDMA has finished every BD up to Ticket. The chains run in
+ * the order they were submitted, so that includes the chunk of the caller.
+ * Polling reaps under DmaLock, whichever CPU gets there reaps for all.
+ */
+static int McWaitChunk(McSweep *Sweep, u32 Ticket)
+{
+	int Completed;
+	int Events;
+
+	while (!Error) {
+		Events = CdmaEvents;
+		Hal_SpinLock(&Sweep->DmaLock);
+		Completed = CheckCompletion(AxiCdmaInstancePtr);
+		Hal_SpinUnlock(&Sweep->DmaLock);
+		if ((u32)Completed >= Ticket) {
+			return XST_SUCCESS;
+		}
+
+		if (IntrCompletion) {
+			Hal_CdmaWaitIntr(AxiCdmaInstancePtr, &CdmaEvents, Events);
+		}
+	}
+
+	return XST_FAILURE;
+}
+
+/*****************************************************************************/
+/**
+* HalCpuFn of the multi-core sweep. Each CPU generates the pattern of a
+* chunk in its own BATCH_LEN buffer in PS DDR, sends it through the CDMA and
+* verifies the destination against the regenerated pattern. Only the submit
+* and the reap are under DmaLock: the chains of the CPUs queue up on the
+* CDMA while each CPU waits for its own, so the engine always has the next
+* chunk and generation and verification run on all CPUs at once.
+*
+* @param	Cpu is the index of this CPU
+* @param	Arg is the McSweep of the mode under test
+*
+* @return	None, failures set McSweep.Failed
+*
+* @note		The destination is always checked by the CPU, over the HPM
+*		port for the PL DDR4. DMA read-back, ReadBackVerify, is not
+*		supported. Nothing is printed here but data check failures,
+*		CPU 0 reports transfer failures once the sweep is over.
+*
+******************************************************************************/
+static void McWorker(int Cpu, void *Arg)
+{
+	McSweep *Sweep = Arg;
+	McSlice *Slice = &Sweep->Slice[Cpu];
+	UINTPTR PsAddr = PS_DDR_BASE + (UINTPTR)Cpu * BATCH_LEN;
+	UINTPTR PlAddr;
+	UINTPTR SrcAddr;
+	UINTPTR DstAddr;
+	UINTPTR SendAddr;
+	StatsBatch Batch;
+	u64 Start = Hal_TimeNow();
+	u64 Now;
+	u32 Chunk;
+	u32 Ticket;
+#ifdef CHECKPOINT_RESUME
+	u32 Region;
+#endif
+	int Status;
+
+	while (!Hal_AtomicLoad(&Sweep->Failed) &&
+	       McTakeChunk(Sweep, Cpu, &Chunk)) {
+		PlAddr = Sweep->Base + (UINTPTR)Chunk * BATCH_LEN;
+#ifdef CHECKPOINT_RESUME
+		Region = (u32)((PlAddr - (UINTPTR)Checkpoint.Base) /
+			Checkpoint.RegionLen);
+		if (!Ckpt_Pending(&Checkpoint, Sweep->Step, Region, RetestOnly)) {
+			continue;
+		}
+#endif
+		Batch.PlAddr = PlAddr;
+		Batch.Length = BATCH_LEN;
+		DirectionAddr(TestDirection, Chunk, PlAddr, PsAddr, PlAddr,
+			&SrcAddr, &DstAddr);
+
+		Batch.SetupStart = Hal_TimeNow();
+		SendAddr = XMt_FillBatch(SrcAddr, DstAddr, &Sweep->Fill);
+		Now = Hal_TimeNow();
+		Slice->CpuTicks += Now - Batch.SetupStart;
+
+		Hal_SpinLock(&Sweep->DmaLock);
+		Batch.Submit = Hal_TimeNow();
+		Batch.DmaStart = Batch.Submit;
+		Status = DoTransfer(AxiCdmaInstancePtr, SendAddr, DstAddr);
+		Sweep->Submitted += NUMBER_OF_BDS_TO_TRANSFER;
+		Ticket = Sweep->Submitted;
+		Hal_SpinUnlock(&Sweep->DmaLock);
+		if (Status == XST_SUCCESS) {
+			Status = McWaitChunk(Sweep, Ticket);
+		}
+		Batch.DmaDone = Hal_TimeNow();
+		Slice->DmaTicks += Batch.DmaDone - Now;
+		if (Status != XST_SUCCESS) {
+			if (Hal_AtomicFetchAdd(&Sweep->XferFails, 1) == 0) {
+				Sweep->FailCpu = Cpu;
+				Sweep->FailAddr = PlAddr;
+			}
+			Hal_AtomicStore(&Sweep->Failed, 1);
+			break;
+		}
+
+		Batch.VerifyStart = Hal_TimeNow();
+		Status = XMt_CheckBatch(SrcAddr, DstAddr, &Sweep->Fill);
+		Batch.VerifyDone = Hal_TimeNow();
+		Slice->CpuTicks += Batch.VerifyDone - Batch.VerifyStart;
+		Log_Batch(&Batch, Status);
+#ifdef CHECKPOINT_RESUME
+		if (Status != XST_SUCCESS) {
+			Hal_AtomicFetchAdd(&Sweep->RegionBad[Region], 1);
+		}
+		Hal_AtomicFetchAdd(&Sweep->RegionChunks[Region], 1);
+#endif
+		if (Status != XST_SUCCESS) {
+			Hal_AtomicFetchAdd(&Sweep->BadChunks, 1);
+#ifndef CONTINUE_ON_FAIL
+			Hal_AtomicStore(&Sweep->Failed, 1);
+			break;
+#endif
+		}
+
+		Hal_SpinLock(&Sweep->StatsLock);
+		Stats_RecordBatch(Sweep->Run, &Batch);
+		Hal_SpinUnlock(&Sweep->StatsLock);
+
+		Slice->Chunks++;
+	}
+
+	Slice->WallTicks = Hal_TimeNow() - Start;
+}
+
+/* PipelineFillFn of the direction sweep. A PL DDR4 source already holds
+ * the mode 0 pattern a DMA write pass put there, so the CPU only writes the
+ * PS DDR sources.
+ */
+static UINTPTR DirFillBatch(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	DirSweepArg *DirArg = Arg;
+
+	if (SrcAddr - PL_DDR4_BASE < PL_DDR4_SIZE) {
+#ifdef __aarch64__
+		Hal_DCacheFlushRange(DstAddr, BATCH_LEN);
+#endif
+		return SrcAddr;
+	}
+
+	return XMt_FillBatch(SrcAddr, DstAddr, &DirArg->Fill);
+}
+
+static int DirCheckBatch(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	DirSweepArg *DirArg = Arg;
+
+	return XMt_CheckBatch(SrcAddr, DstAddr, &DirArg->Fill);
+}
+
+/* PipelineVerifyFn of the PL->PL copy. Batch n copies the batch half the
+ * range away, see PipelineBatchAddr. Once the copy has passed a batch, the
+ * batch holds what it was copied from, so the data a batch gets was first
+ * written for the address found by following the copies back.
+ */
+static int DirCheckCopy(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	DirSweepArg *DirArg = Arg;
+	u32 Half = DirArg->NumBatches / 2;
+	u32 Batch = (DstAddr - DirArg->Base) / BATCH_LEN;
+	u32 Origin = (Batch + Half) % DirArg->NumBatches;
+
+	(void)SrcAddr;
+
+	while (Origin < Batch) {
+		Batch = Origin;
+		Origin = (Batch + Half) % DirArg->NumBatches;
+	}
+
+	return XMt_CheckPattern(DstAddr,
+		DirArg->Base + (UINTPTR)Origin * BATCH_LEN, DstAddr, &DirArg->Fill);
+}
+
+/*****************************************************************************/
+/**
+* Bandwidth profile of the PL DDR4: run the range through the pipeline once
+* in every direction and report what each achieves.
+*
+* Every direction moves and checks the mode 0 address pattern, so a batch
+* that lands on the wrong address fails in any direction. The read, copy
+* and duplex runs find their PL DDR4 sources already written by a DMA write
+* pass, the write direction itself or an untimed one after the copy, so
+* the CPU writes nothing over the HPM port inside a timed run. The DIMM
+* column counts the bytes the PL DDR4 moves, twice the batch size for a
+* copy, which reads and writes it. The batches are checked with CPU loads,
+* a DMA read-back would add its traffic to the write and copy figures.
+*
+* @param	Base is the PL DDR4 bus address to start at, BATCH_LEN aligned
+* @param	Size is the number of bytes to test, a multiple of BATCH_LEN
+*
+* @return
+*		- XST_SUCCESS if every direction passes
+*		- XST_FAILURE otherwise
+*
+* @note		TestDirection and ReadBackVerify are restored before
+*		returning.
+*
+******************************************************************************/
+int direction_sweep(UINTPTR Base, u64 Size){
+	DirSweepArg Arg;
+	PipelineStats Stats;
+	int SavedDirection = TestDirection;
+	int SavedReadBack = ReadBackVerify;
+	int Prefilled = 0;	/* every batch holds its own mode 0 pattern */
+	int Dir;
+	u64 Start;
+	u64 Us;
+	u64 DmaUs;
+	int Status = XST_SUCCESS;
+
+	if ((Base - PL_DDR4_BASE) % BATCH_LEN || Size % BATCH_LEN || Size == 0 ||
+	    Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid sweep range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Direction Sweep - BEGIN --- \r\n");
+	xil_printf("range: 0x%lx - 0x%lx (%luMB)\r\n\r\n", Base, Base + Size - 1,
+		(unsigned long)(Size >> 20));
+	xil_printf("direction      wall MB/s  dma MB/s  dimm MB/s\r\n");
+
+	Arg.Fill.ModeVal = 0;
+	Arg.Fill.Pattern = XMt_ModePattern(0);
+	Arg.Base = Base;
+	Arg.NumBatches = Size / BATCH_LEN;
+	ReadBackVerify = 0;
+	for (Dir = 0; Dir < NUM_DIRECTIONS; Dir++) {
+		memset(&Stats, 0, sizeof(Stats));
+		if (Dir != DIR_WRITE && !Prefilled) {
+			TestDirection = DIR_WRITE;
+			Log_PhaseBegin(LOG_TEST_DIRECTION, 0, DIR_WRITE, Base, Size);
+			Start = Hal_TimeNow();
+			Status = RunPipeline(Base, Arg.NumBatches, DirFillBatch,
+				DirCheckBatch, &Arg, &Stats, 0);
+			Log_PhaseEnd(Status, Size, Arg.NumBatches,
+				Hal_TimeNow() - Start);
+			if (Status != XST_SUCCESS) {
+				xil_printf("Prefill for %s failed\r\n",
+					DirectionName[Dir]);
+				break;
+			}
+			memset(&Stats, 0, sizeof(Stats));
+		}
+
+		TestDirection = Dir;
+		Stats_RunInit(&DirectionRun[Dir], "direction sweep",
+			DirectionName[Dir], Base, Size);
+		Stats.Run = &DirectionRun[Dir];
+
+		Log_PhaseBegin(LOG_TEST_DIRECTION, 0, Dir, Base, Size);
+		Start = Hal_TimeNow();
+		Status = RunPipeline(Base, Arg.NumBatches, DirFillBatch,
+			Dir == DIR_COPY ? DirCheckCopy : DirCheckBatch, &Arg,
+			&Stats, 0);
+		Log_PhaseEnd(Status, Size, Arg.NumBatches, Hal_TimeNow() - Start);
+		if (Status != XST_SUCCESS) {
+			xil_printf("Direction %s failed\r\n", DirectionName[Dir]);
+			break;
+		}
+		Prefilled = Dir != DIR_COPY;
+
+		Us = HAL_TICKS_TO_US(Hal_TimeNow() - Start);
+		DmaUs = HAL_TICKS_TO_US(Stats.DmaTicks);
+		xil_printf("%-13s  %9lu  %8lu  %9lu\r\n", DirectionName[Dir],
+			(unsigned long)(Us ? Size / Us : 0),
+			(unsigned long)(DmaUs ? Size / DmaUs : 0),
+			(unsigned long)(Us ? Size * (Dir == DIR_COPY ? 2 : 1) / Us : 0));
+	}
+
+	TestDirection = SavedDirection;
+	ReadBackVerify = SavedReadBack;
+	xil_printf("--- Direction Sweep - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/*****************************************************************************/
+/*
+* Move NumBds BDs of a layout between the PL DDR4 and PS_DDR_BASE on the
+* free-form ring, keeping up to TRAFFIC_IN_FLIGHT of them queued.
+*
+* @param	GenPtr is the layout of the PL DDR4 side
+* @param	Dir is DIR_WRITE, DIR_READ or DIR_COPY. The copy goes from
+*		the layout to the same layout GenPtr->Size bytes up.
+* @param	NumBds is the number of BDs, a multiple of TRAFFIC_SUBMIT
+* @param	TicksPtr receives the time from the first submit to the last
+*		completion
+*
+* @return	XST_SUCCESS, or XST_FAILURE on a submit or transfer error
+*
+******************************************************************************/
+static int RunTraffic(const TrafficGen *GenPtr, int Dir, u32 NumBds,
+		u64 *TicksPtr)
+{
+	static HalXfer Xfer[TRAFFIC_SUBMIT];
+	UINTPTR PsAddr;
+	UINTPTR PlAddr;
+	u32 Submitted = 0;
+	u32 Reaped = 0;
+	u32 Index;
+	int BdCount;
+	u64 Start;
+
+	Start = Hal_TimeNow();
+	while (Reaped < NumBds) {
+		if (Submitted < NumBds &&
+		    Submitted - Reaped + TRAFFIC_SUBMIT <= TRAFFIC_IN_FLIGHT) {
+			for (Index = 0; Index < TRAFFIC_SUBMIT; Index++) {
+				PlAddr = Traffic_Addr(GenPtr, Submitted + Index);
+				PsAddr = PS_DDR_BASE + (UINTPTR)((u64)(Submitted + Index) *
+					GenPtr->Length % BATCH_LEN);
+				if (Dir == DIR_COPY) {
+					PsAddr = PlAddr + (UINTPTR)GenPtr->Size;
+				}
+				Xfer[Index].SrcAddr = Dir == DIR_WRITE ? PsAddr : PlAddr;
+				Xfer[Index].DstAddr = Dir == DIR_WRITE ? PlAddr : PsAddr;
+				Xfer[Index].Length = GenPtr->Length;
+			}
+			if (Hal_BdRingSubmit(AxiCdmaInstancePtr, Xfer,
+					TRAFFIC_SUBMIT) != XST_SUCCESS) {
+				return XST_FAILURE;
+			}
+			Submitted += TRAFFIC_SUBMIT;
+			continue;
+		}
+
+		BdCount = Hal_BdRingReap(AxiCdmaInstancePtr);
+		if (BdCount < 0) {
+			xdbg_printf(XDBG_DEBUG_ERROR, "Transfer error\r\n");
+			return XST_FAILURE;
+		}
+		Reaped += BdCount;
+	}
+	*TicksPtr = Hal_TimeNow() - Start;
+
+	return XST_SUCCESS;
+}
+
+/* StripeLayoutFn of the traffic profile, Ref is the TrafficGen */
+static u64 TrafficLayout(void *Ref, u64 Bd)
+{
+	const TrafficGen *GenPtr = Ref;
+
+	return Traffic_Addr(GenPtr, (u32)Bd) - GenPtr->Base;
+}
+
+/*****************************************************************************/
+/**
+* Measure what access order costs on this SODIMM.
+*
+* Runs every layout of sodimm_traffic.h for TRAFFIC_BDS BDs in each of the
+* write and read directions and prints bandwidth and time per BD. The BDs
+* are dealt out one at a time over every CDMA engine, so BDs that follow
+* each other in the layout are at the DIMM together. The short layouts are
+* read against linear run, which has their BD length: row hit, bank group
+* interleave, row conflict and the activate storm then give the price of a
+* bank group switch, a row miss in the same bank and an activate rate held
+* back by tRRD and tFAW.
+*
+* @param	Base is the bus address of the PL DDR4
+* @param	Size is the number of bytes from Base the layouts may touch
+*
+* @return
+*		- XST_SUCCESS if every layout ran
+*		- XST_FAILURE otherwise
+*
+* @note		Overwrites the range and PS_DDR_BASE, and takes the BD rings
+*		of every engine over. The next batch rebuilds the ring
+*		session. With a single engine only one BD is at the DIMM at
+*		a time.
+*
+******************************************************************************/
+int traffic_profile(UINTPTR Base, u64 Size){
+	static const int Dirs[] = { DIR_WRITE, DIR_READ };
+	static StripeSched Sched;
+	TrafficGen Gen;
+	u64 Ticks[2];
+	u64 Start;
+	unsigned long MBps[2];
+	unsigned long NsPerBd[2];
+	u64 Us;
+	int NumEngines = Hal_CdmaCount();
+	int Pattern;
+	int Run;
+	int Status = XST_SUCCESS;
+
+	if (Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid traffic range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Traffic Profile - BEGIN --- \r\n");
+	xil_printf("%d engines, %d BDs per layout and direction, %d queued "
+		"per engine\r\n\r\n", NumEngines, TRAFFIC_BDS, STRIPE_MAX_QUEUED);
+	xil_printf("layout         BD bytes  write MB/s  read MB/s  "
+		"write ns/BD  read ns/BD\r\n");
+
+	/* The stripe engines build their own free-form rings */
+	close_ring_session();
+
+	for (Pattern = 0; Pattern < TRAFFIC_NUM_PATTERNS; Pattern++) {
+		Status = Traffic_Init(&Gen, Pattern, Base, Size);
+		if (Status != XST_SUCCESS) {
+			xil_printf("Range too small for %s\r\n", Traffic_Name(Pattern));
+			break;
+		}
+
+		/* One BD per stripe: BD n of the layout goes to engine n */
+		Status = Stripe_Init(&Sched, DMA_CTRL_DEVICE_ID, NumEngines,
+			Gen.Length, Gen.Length);
+		if (Status != XST_SUCCESS) {
+			xil_printf("CDMA Initialization failed\r\n");
+			break;
+		}
+		Stripe_SetLayout(&Sched, TrafficLayout, &Gen);
+
+		for (Run = 0; Run < 2; Run++) {
+			Start = Hal_TimeNow();
+			Status = Stripe_Run(&Sched, Gen.Base,
+				(u64)TRAFFIC_BDS * Gen.Length, PS_DDR_BASE, BATCH_LEN,
+				Dirs[Run] == DIR_WRITE);
+			Ticks[Run] = Hal_TimeNow() - Start;
+			if (Status != XST_SUCCESS) {
+				xil_printf("%s %s failed\r\n", Traffic_Name(Pattern),
+					DirectionName[Dirs[Run]]);
+				break;
+			}
+		}
+		if (Status != XST_SUCCESS) {
+			break;
+		}
+
+		for (Run = 0; Run < 2; Run++) {
+			Us = HAL_TICKS_TO_US(Ticks[Run]);
+			MBps[Run] = (unsigned long)(Us ?
+				(u64)TRAFFIC_BDS * Gen.Length / Us : 0);
+			NsPerBd[Run] = (unsigned long)(HAL_TICKS_TO_US(Ticks[Run] *
+				1000) / TRAFFIC_BDS);
+		}
+		xil_printf("%-13s  %8lu  %10lu  %9lu  %11lu  %10lu\r\n",
+			Traffic_Name(Pattern), (unsigned long)Gen.Length, MBps[0],
+			MBps[1], NsPerBd[0], NsPerBd[1]);
+	}
+
+	close_ring_session();
+	xil_printf("--- Traffic Profile - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/*****************************************************************************/
+/**
+* Measure how the bandwidth scales with the number of CDMA engines.
+*
+* For 1 to Hal_CdmaCount() engines the range is written from one PS DDR
+* window and read back into another with the stripe scheduler, and the
+* total and per-engine bandwidth of the write are printed. The first two
+* stripes of every engine are then checked against the source window, so a
+* scheduler that sends a stripe to the wrong place fails here.
+*
+* @param	Base is the PL DDR4 bus address of the range
+* @param	Size is the number of bytes, a multiple of STRIPE_LEN
+*
+* @return
+*		- XST_SUCCESS if every run completes and the data checks out
+*		- XST_FAILURE otherwise
+*
+* @note		Takes over the BD ring of engine 0. The next batch rebuilds
+*		the ring session.
+*
+******************************************************************************/
+int stripe_scaling(UINTPTR Base, u64 Size){
+	static StripeSched Sched;
+	VerifyResult Result;
+	u64 *Src = Hal_Ptr(PS_DDR_BASE);
+	unsigned long MBps[2];
+	unsigned long EngineMBps[HAL_MAX_CDMAS];
+	u64 Ticks;
+	u64 Start;
+	u64 NumStripes = Size / STRIPE_LEN;
+	u64 Stripe;
+	u64 Offset;
+	u32 Index;
+	int NumEngines;
+	int Engine;
+	int Write;
+	int Status = XST_SUCCESS;
+
+	if (Size % STRIPE_LEN || Size == 0 || Base < PL_DDR4_BASE ||
+	    Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid stripe range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Stripe Scaling - BEGIN --- \r\n");
+	xil_printf("%d CDMA engines, %lu byte stripes over 0x%lx - 0x%lx\r\n\r\n",
+		Hal_CdmaCount(), (unsigned long)STRIPE_LEN, Base, Base + Size - 1);
+	xil_printf("engines  write MB/s  read MB/s  write MB/s per engine\r\n");
+
+	for (Index = 0; Index < STRIPE_PS_LEN / sizeof(u64); Index++) {
+		Src[Index] = XMT_RANDOM_VALUE(Index);
+	}
+	Hal_DCacheFlushRange(PS_DDR_BASE, STRIPE_PS_LEN);
+
+	close_ring_session();
+	for (NumEngines = 1; NumEngines <= Hal_CdmaCount(); NumEngines++) {
+		Status = Stripe_Init(&Sched, DMA_CTRL_DEVICE_ID, NumEngines,
+			STRIPE_LEN, MAX_PKT_LEN);
+		if (Status != XST_SUCCESS) {
+			xil_printf("CDMA Initialization failed\r\n");
+			break;
+		}
+
+		for (Write = 1; Write >= 0; Write--) {
+			Start = Hal_TimeNow();
+			Status = Stripe_Run(&Sched, Base, Size, Write ? PS_DDR_BASE :
+				PS_DDR_BASE + STRIPE_PS_LEN, STRIPE_PS_LEN, Write);
+			Ticks = Hal_TimeNow() - Start;
+			if (Status != XST_SUCCESS) {
+				xil_printf("%d engine %s failed\r\n", NumEngines,
+					Write ? "write" : "read");
+				break;
+			}
+			MBps[Write] = (unsigned long)(Size /
+				(HAL_TICKS_TO_US(Ticks) + 1));
+
+			for (Engine = 0; Write && Engine < NumEngines; Engine++) {
+				EngineMBps[Engine] = (unsigned long)(
+					Sched.Engine[Engine].Bds * MAX_PKT_LEN /
+					(HAL_TICKS_TO_US(Sched.Engine[Engine].Ticks) + 1));
+			}
+		}
+		if (Status != XST_SUCCESS) {
+			break;
+		}
+
+		xil_printf("%7d  %10lu  %9lu ", NumEngines, MBps[1], MBps[0]);
+		for (Engine = 0; Engine < NumEngines; Engine++) {
+			xil_printf(" %lu", EngineMBps[Engine]);
+		}
+		xil_printf("\r\n");
+	}
+
+	/* The range still holds the write of the last engine count */
+	for (Stripe = 0; Status == XST_SUCCESS && Stripe < NumStripes &&
+	     Stripe < 2U * Hal_CdmaCount(); Stripe++) {
+		Offset = Stripe * STRIPE_LEN;
+		Hal_DCacheInvalidateRange(Base + (UINTPTR)Offset, STRIPE_LEN);
+
+		Verify_Reset(&Result);
+		Result.Log = &DimmFaults;
+		Result.LogAddr = Base + (UINTPTR)Offset;
+		if (Verify_Compare((u8 *)Src + Offset % STRIPE_PS_LEN,
+				Hal_Ptr(Base + (UINTPTR)Offset), STRIPE_LEN,
+				&Result)) {
+			xil_printf("Stripe %lu does not match its source\r\n",
+				(unsigned long)Stripe);
+			Verify_PrintResult(&Result, Base + (UINTPTR)Offset);
+			Status = XST_FAILURE;
+		}
+	}
+
+	close_ring_session();
+	xil_printf("--- Stripe Scaling - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/*****************************************************************************/
+/**
+* Measure the CDMA datapath against the DIMM, so the build.tcl --cdma_*
+* variants can be compared.
+*
+* Every BD length from DATAPATH_MIN_BD to DATAPATH_MAX_BD moves half the
+* range in the write, read and copy directions, linearly, with up to
+* TRAFFIC_IN_FLIGHT BDs queued. One CSV line is printed per point:
+*
+*   DATAPATH,<bits>,<beats>,<MHz>,<direction>,<BD bytes>,<MB/s>,<% of the
+*   datapath ceiling>,<limit>
+*
+* The datapath ceiling is data width x clock. limit is "datapath" once a
+* point reaches DATAPATH_LIMIT_PCT of it, "dimm" once the DIMM traffic
+* (twice the copy rate for a copy) reaches DATAPATH_LIMIT_PCT of
+* DATAPATH_DIMM_MBPS, and "-" when neither
+* holds, e.g. the per-BD cost or the 128 bit S_AXI_HP0 port dominates.
+* Lines of two builds line up field for field.
+*
+* @param	Base is the PL DDR4 bus address of the range
+* @param	Size is the number of bytes, a multiple of 2 x DATAPATH_MAX_BD x
+*		TRAFFIC_SUBMIT
+*
+* @return
+*		- XST_SUCCESS if every point ran
+*		- XST_FAILURE otherwise
+*
+* @note		Overwrites the range and PS_DDR_BASE, and takes the BD ring
+*		over. The next batch rebuilds the ring session.
+*
+******************************************************************************/
+int datapath_sweep(UINTPTR Base, u64 Size){
+	static const int Dirs[] = { DIR_WRITE, DIR_READ, DIR_COPY };
+	HalDatapath Path;
+	TrafficGen Gen;
+	u64 Ticks;
+	u64 Us;
+	u32 BdLen;
+	u32 NumBds;
+	u32 Ceiling;
+	unsigned long MBps;
+	unsigned long DimmMBps;
+	const char *Limit;
+	int Run;
+	int Status;
+
+	if (Size % (2ULL * DATAPATH_MAX_BD * TRAFFIC_SUBMIT) || Size == 0 ||
+	    Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid datapath range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Datapath Sweep - BEGIN --- \r\n");
+
+	close_ring_session();
+	Status = init_cdma(DMA_CTRL_DEVICE_ID);
+	if (Status == XST_SUCCESS) {
+		Status = Hal_BdRingCreate(AxiCdmaInstancePtr);
+	}
+	if (Status != XST_SUCCESS) {
+		xil_printf("CDMA Initialization failed\r\n");
+		return XST_FAILURE;
+	}
+
+	Hal_CdmaDatapath(AxiCdmaInstancePtr, &Path);
+	Ceiling = Path.DataWidth / 8 * Path.ClockMHz;
+	xil_printf("CDMA datapath %lu bits x %lu beats at %lu MHz, ceiling %lu "
+		"MB/s, DIMM %lu MB/s\r\n", (unsigned long)Path.DataWidth,
+		(unsigned long)Path.BurstLen, (unsigned long)Path.ClockMHz,
+		(unsigned long)Ceiling, (unsigned long)DATAPATH_DIMM_MBPS);
+	xil_printf("%luMB per point\r\n\r\n", (unsigned long)(Size / 2 >> 20));
+	xil_printf("DATAPATH,bits,beats,mhz,direction,bd_bytes,mbps,"
+		"ceiling_pct,limit\r\n");
+
+	for (BdLen = DATAPATH_MIN_BD; BdLen <= DATAPATH_MAX_BD; BdLen *= 4) {
+		Status = Traffic_Init(&Gen, TRAFFIC_LINEAR, Base, Size / 2);
+		if (Status != XST_SUCCESS) {
+			xil_printf("Range too small for the datapath sweep\r\n");
+			break;
+		}
+		Gen.Length = BdLen;
+		NumBds = (u32)(Size / 2 / BdLen);
+
+		for (Run = 0; Run < 3; Run++) {
+			Status = RunTraffic(&Gen, Dirs[Run], NumBds, &Ticks);
+			if (Status != XST_SUCCESS) {
+				xil_printf("%s with %lu byte BDs failed\r\n",
+					DirectionName[Dirs[Run]],
+					(unsigned long)BdLen);
+				break;
+			}
+
+			Us = HAL_TICKS_TO_US(Ticks);
+			MBps = (unsigned long)(Us ? Size / 2 / Us : 0);
+			DimmMBps = MBps * (Dirs[Run] == DIR_COPY ? 2 : 1);
+			if (Ceiling && MBps * 100 >=
+			    (unsigned long)Ceiling * DATAPATH_LIMIT_PCT) {
+				Limit = "datapath";
+			} else if (DimmMBps * 100 >= (unsigned long)DATAPATH_DIMM_MBPS *
+				   DATAPATH_LIMIT_PCT) {
+				Limit = "dimm";
+			} else {
+				Limit = "-";
+			}
+			xil_printf("DATAPATH,%lu,%lu,%lu,%s,%lu,%lu,%lu,%s\r\n",
+				(unsigned long)Path.DataWidth,
+				(unsigned long)Path.BurstLen,
+				(unsigned long)Path.ClockMHz,
+				DirectionName[Dirs[Run]], (unsigned long)BdLen, MBps,
+				Ceiling ? MBps * 100 / Ceiling : 0UL, Limit);
+		}
+		if (Status != XST_SUCCESS) {
+			break;
+		}
+	}
+
+	close_ring_session();
+	xil_printf("--- Datapath Sweep - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/*****************************************************************************/
+/**
+* Fill a PL DDR4 range with an address independent pattern mode, moving
+* only one block through PS DDR.
+*
+* A BATCH_LEN seed block is generated in PS DDR and written to Base. From
+* then on the CDMA engines copy the filled part of the range onto the part
+* right after it, PL->PL, so the filled part doubles every step: 1x, 2x,
+* 4x ... BATCH_LEN, the last step copying only what is left. A step is
+* finished before the next one reads what it wrote.
+*
+* @param	Base is the PL DDR4 bus address of the range, BATCH_LEN aligned
+* @param	Size is the number of bytes, a multiple of BATCH_LEN
+* @param	ModeVal is the pattern mode, 1-10
+* @param	StepsPtr receives the number of copy steps
+*
+* @return
+*		- XST_SUCCESS if the range is filled
+*		- XST_FAILURE on a bad argument or a transfer error
+*
+* @note		Overwrites PS_DDR_BASE and takes the BD rings of all engines.
+*		The next batch rebuilds the ring session.
+*
+******************************************************************************/
+int replicate_fill(UINTPTR Base, u64 Size, s32 ModeVal, u32 *StepsPtr)
+{
+	static StripeSched Sched;
+	u64 Filled;
+	u64 Length;
+	int Status;
+
+	*StepsPtr = 0;
+	if ((ModeVal == 0U) || (ModeVal > 10U) || Size % BATCH_LEN ||
+	    Size == 0 || (Base - PL_DDR4_BASE) % BATCH_LEN ||
+	    Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid replication fill of mode %d over 0x%lx + 0x%lx\r\n",
+			ModeVal, Base, Size);
+		return XST_FAILURE;
+	}
+
+	XMt_FillPattern((u64 *)Hal_Ptr(PS_DDR_BASE), 0, ModeVal,
+		XMt_ModePattern(ModeVal), BATCH_LEN);
+	Hal_DCacheFlushRange(PS_DDR_BASE, BATCH_LEN);
+
+	close_ring_session();
+	Status = Stripe_Init(&Sched, DMA_CTRL_DEVICE_ID, Hal_CdmaCount(),
+		REPLICATE_BD_LEN, REPLICATE_BD_LEN);
+	if (Status != XST_SUCCESS) {
+		xil_printf("CDMA Initialization failed\r\n");
+		return XST_FAILURE;
+	}
+
+	Status = Stripe_Run(&Sched, Base, BATCH_LEN, PS_DDR_BASE, BATCH_LEN, 1);
+	for (Filled = BATCH_LEN; Status == XST_SUCCESS && Filled < Size;
+	     Filled += Length) {
+		Length = Size - Filled < Filled ? Size - Filled : Filled;
+		Status = Stripe_Run(&Sched, Base + (UINTPTR)Filled, Length, Base,
+			Filled, 1);
+		(*StepsPtr)++;
+	}
+
+	close_ring_session();
+	if (Status != XST_SUCCESS) {
+		xil_printf("Replication failed with 0x%lx of 0x%lx filled\r\n",
+			(UINTPTR)Filled, (UINTPTR)Size);
+	}
+
+	return Status;
+}
+
+/*****************************************************************************/
+/**
+* Time replicate_fill, check every batch of the range against the pattern,
+* then time writing the same range from the seed block in PS DDR. Both
+* fills are striped over every CDMA engine.
+*
+* @param	Base is the PL DDR4 bus address of the range, BATCH_LEN aligned
+* @param	Size is the number of bytes, a multiple of BATCH_LEN
+*
+* @return
+*		- XST_SUCCESS if both fills complete and the range checks out
+*		- XST_FAILURE otherwise
+*
+* @note		Overwrites the range and PS_DDR_BASE, see replicate_fill.
+*
+******************************************************************************/
+int replicate_fill_test(UINTPTR Base, u64 Size)
+{
+	static StripeSched Sched;
+	XMtFillArg Arg;
+	UINTPTR Addr;
+	u64 Start;
+	u64 Us;
+	u32 Steps;
+	u32 BadBatches = 0;
+	int Status;
+
+	xil_printf("--- Replication Fill - BEGIN --- \r\n");
+	xil_printf("range: 0x%lx - 0x%lx (%luMB), mode %d, %d CDMA engines\r\n\r\n",
+		Base, Base + Size - 1, (unsigned long)(Size >> 20),
+		REPLICATE_MODE, Hal_CdmaCount());
+
+	Arg.ModeVal = REPLICATE_MODE;
+	Arg.Pattern = XMt_ModePattern(REPLICATE_MODE);
+
+	Start = Hal_TimeNow();
+	Status = replicate_fill(Base, Size, Arg.ModeVal, &Steps);
+	Us = HAL_TICKS_TO_US(Hal_TimeNow() - Start);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	xil_printf("replicated  : %lu ms (%lu MB/s, %lu MB/s on the DIMM), seed "
+		"of %lu bytes, %d PL->PL steps\r\n", (unsigned long)(Us / 1000),
+		(unsigned long)(Us ? Size / Us : 0),
+		(unsigned long)(Us ? (2 * Size - BATCH_LEN) / Us : 0),
+		(unsigned long)BATCH_LEN, Steps);
+
+	/* Checked before the PS DDR fill writes the same pattern again */
+	for (Addr = Base; Addr < Base + Size; Addr += BATCH_LEN) {
+		Hal_DCacheInvalidateRange(Addr, BATCH_LEN);
+		if (XMt_CheckBatch(Addr, Addr, &Arg) != XST_SUCCESS) {
+			if (BadBatches++ < FAIL_PRINT_BATCHES) {
+				xil_printf("[base: 0x%lx] FAILED\r\n", Addr);
+			}
+#ifndef CONTINUE_ON_FAIL
+			break;
+#endif
+		}
+	}
+	if (BadBatches) {
+		xil_printf("%d batches do not hold the pattern\r\n", BadBatches);
+		return XST_FAILURE;
+	}
+
+	/* What the same fill costs with every byte crossing PS DDR */
+	close_ring_session();
+	Status = Stripe_Init(&Sched, DMA_CTRL_DEVICE_ID, Hal_CdmaCount(),
+		REPLICATE_BD_LEN, REPLICATE_BD_LEN);
+	if (Status == XST_SUCCESS) {
+		Start = Hal_TimeNow();
+		Status = Stripe_Run(&Sched, Base, Size, PS_DDR_BASE, BATCH_LEN, 1);
+		Us = HAL_TICKS_TO_US(Hal_TimeNow() - Start);
+	}
+	close_ring_session();
+	if (Status != XST_SUCCESS) {
+		xil_printf("Fill from PS DDR failed\r\n");
+		return XST_FAILURE;
+	}
+	xil_printf("from PS DDR : %lu ms (%lu MB/s)\r\n",
+		(unsigned long)(Us / 1000), (unsigned long)(Us ? Size / Us : 0));
+	xil_printf("--- Replication Fill - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/* PipelineVerifyFn of the hold write pass, the check of a region waits
+ * until it has held its data for the hold time
+ */
+static int HoldNoCheck(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	(void)SrcAddr;
+	(void)DstAddr;
+	(void)Arg;
+
+	return XST_SUCCESS;
+}
+
+/* PipelineFillFn of the hold check pass. The data is already in the
+ * PL DDR4, only the PS DDR buffer it is read into must hold no stale lines.
+ */
+static UINTPTR HoldReadFill(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	(void)Arg;
+#ifdef __aarch64__
+	Hal_DCacheFlushRange(DstAddr, BATCH_LEN);
+#else
+	(void)DstAddr;
+#endif
+
+	return SrcAddr;
+}
+
+/*****************************************************************************/
+/**
+* Check that the DIMM holds its data over refresh windows of the MIG, at
+* the cost of about one extra read pass instead of one wait per region.
+*
+* The range is cut into regions. Region after region is written without a
+* check, and each one is read back by DMA and checked as soon as it has
+* held its data for the hold time, between the writes of later regions.
+* Only the last regions, those written less than the hold time before the
+* end of the write pass, are waited for.
+*
+* The MIG keeps refreshing the DIMM at its tREFI all along, build.tcl does
+* not bring out its user refresh. So this finds rows that lose data under
+* the normal refresh and the traffic of the other regions, not the
+* retention margin of the cells, which takes a paused or stretched refresh.
+*
+* @param	Base is the PL DDR4 bus address of the range, BATCH_LEN aligned
+* @param	Size is the number of bytes, a multiple of BATCH_LEN
+* @param	HoldUs is the time every region holds its data before its
+*		check, 0 to derive it from the refresh timing of the DIMM
+*
+* @return
+*		- XST_SUCCESS if every region still holds its data
+*		- XST_FAILURE if a transfer fails or a region lost data. With
+*		  CONTINUE_ON_FAIL the remaining regions are still checked.
+*
+* @note		Bad words go to the fault log, at their PL DDR4 address.
+*
+******************************************************************************/
+int hold_test(UINTPTR Base, u64 Size, u64 HoldUs){
+	static u64 WrittenAt[CKPT_MAX_REGIONS];	/* end of each write */
+	XMtFillArg Arg;
+	PipelineStats Stats;
+	int SavedDirection = TestDirection;
+	int SavedReadBack = ReadBackVerify;
+	u64 RegionLen = Ckpt_RegionLen(Size);
+	u64 HoldTicks;
+	u64 Start;
+	u64 Now;
+	u64 Age;
+	u64 MinAge = ~0ULL;
+	u64 MaxAge = 0;
+	u64 WriteTicks = 0;
+	u64 CheckTicks = 0;
+	u64 IdleTicks = 0;
+	u64 Len;
+	u64 Tested;
+	u64 Us;
+	UINTPTR RegionBase;
+	u32 NumRegions;
+	u32 Written = 0;
+	u32 Checked = 0;
+	u32 BadRegions = 0;
+	u32 BadBefore;
+	int Status = XST_SUCCESS;
+
+	if ((Base - PL_DDR4_BASE) % BATCH_LEN || Size % BATCH_LEN || Size == 0 ||
+	    Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid hold range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	NumRegions = (u32)((Size + RegionLen - 1) / RegionLen);
+
+	xil_printf("--- Refresh Hold Test - BEGIN --- \r\n");
+	xil_printf("range: 0x%lx - 0x%lx (%luMB), mode %d, %d regions of %luMB\r\n",
+		Base, Base + Size - 1, (unsigned long)(Size >> 20),
+		HOLD_MODE, NumRegions, (unsigned long)(RegionLen >> 20));
+	if (HoldUs == 0) {
+		HoldUs = (HOLD_WINDOWS * GEOM_TREFW_PS + GEOM_TRFC_PS) /
+			1000000ULL;
+		xil_printf("hold: %lu us, %d refresh windows of %d x tREFI %lu ns "
+			"+ tRFC %lu ns\r\n\r\n", (unsigned long)HoldUs,
+			HOLD_WINDOWS, GEOM_REFRESH_CMDS,
+			(unsigned long)(GEOM_TREFI_PS / 1000),
+			(unsigned long)(GEOM_TRFC_PS / 1000));
+	} else {
+		xil_printf("hold: %lu us\r\n\r\n", (unsigned long)HoldUs);
+	}
+	HoldTicks = HoldUs * HAL_TICKS_PER_SEC / 1000000ULL;
+
+	Arg.ModeVal = HOLD_MODE;
+	Arg.Pattern = XMt_ModePattern(HOLD_MODE);
+	memset(&Stats, 0, sizeof(Stats));
+
+	/* The write pass must not read anything back */
+	ReadBackVerify = 0;
+	Log_PhaseBegin(LOG_TEST_HOLD, HOLD_MODE, DIR_READ, Base, Size);
+	Start = Hal_TimeNow();
+
+	while (Checked < NumRegions) {
+		Now = Hal_TimeNow();
+
+		if (Checked < Written && Now - WrittenAt[Checked] >= HoldTicks) {
+			/* The oldest region has aged, read it back */
+			RegionBase = Base + (UINTPTR)Checked * RegionLen;
+			Len = Size - (u64)Checked * RegionLen;
+			if (Len > RegionLen) {
+				Len = RegionLen;
+			}
+			Age = Now - WrittenAt[Checked];
+			MinAge = Age < MinAge ? Age : MinAge;
+			MaxAge = Age > MaxAge ? Age : MaxAge;
+
+			TestDirection = DIR_READ;
+			BadBefore = FailedBatches;
+			Status = RunPipeline(RegionBase, (u32)(Len / BATCH_LEN),
+				HoldReadFill, XMt_CheckBatch, &Arg, &Stats, 0);
+			CheckTicks += Hal_TimeNow() - Now;
+			if (Status != XST_SUCCESS && FailedBatches == BadBefore) {
+				/* Nothing miscompared, the read itself failed */
+				xil_printf("Reading region 0x%lx failed\r\n", RegionBase);
+				break;
+			}
+			Checked++;
+			if (Status != XST_SUCCESS) {
+				BadRegions++;
+				xil_printf("[region 0x%lx] lost data after %lu us\r\n",
+					RegionBase, (unsigned long)HAL_TICKS_TO_US(Age));
+#ifndef CONTINUE_ON_FAIL
+				break;
+#endif
+			}
+		} else if (Written < NumRegions) {
+			RegionBase = Base + (UINTPTR)Written * RegionLen;
+			Len = Size - (u64)Written * RegionLen;
+			if (Len > RegionLen) {
+				Len = RegionLen;
+			}
+
+			TestDirection = DIR_WRITE;
+			Status = RunPipeline(RegionBase, (u32)(Len / BATCH_LEN),
+				XMt_FillBatch, HoldNoCheck, &Arg, &Stats, 0);
+			WrittenAt[Written] = Hal_TimeNow();
+			WriteTicks += WrittenAt[Written] - Now;
+			if (Status != XST_SUCCESS) {
+				xil_printf("Writing region 0x%lx failed\r\n", RegionBase);
+				break;
+			}
+			Written++;
+		} else {
+			/* Everything is written, sleep until the oldest region
+			 * has aged, keeping the result stream drained */
+			Age = Now - WrittenAt[Checked];
+			while (Age < HoldTicks) {
+				Log_Drain();
+				Hal_SleepUs(HAL_TICKS_TO_US(HoldTicks - Age) + 1);
+				Age = Hal_TimeNow() - WrittenAt[Checked];
+			}
+			IdleTicks += Hal_TimeNow() - Now;
+		}
+	}
+
+	Tested = Checked == NumRegions ? Size : (u64)Checked * RegionLen;
+	Log_PhaseEnd(BadRegions ? XST_FAILURE : Status, Tested,
+		(u32)(Tested / BATCH_LEN), Hal_TimeNow() - Start);
+	TestDirection = SavedDirection;
+	ReadBackVerify = SavedReadBack;
+
+	if (Checked) {
+		Us = HAL_TICKS_TO_US(WriteTicks);
+		xil_printf("write : %lu ms (%lu MB/s)\r\n", (unsigned long)(Us / 1000),
+			(unsigned long)(Us ? (u64)Written * RegionLen / Us : 0));
+		Us = HAL_TICKS_TO_US(CheckTicks);
+		xil_printf("check : %lu ms (%lu MB/s), data held %lu - %lu ms\r\n",
+			(unsigned long)(Us / 1000),
+			(unsigned long)(Us ? (u64)Checked * RegionLen / Us : 0),
+			(unsigned long)(HAL_TICKS_TO_US(MinAge) / 1000),
+			(unsigned long)(HAL_TICKS_TO_US(MaxAge) / 1000));
+		xil_printf("idle  : %lu ms waiting for the last regions\r\n",
+			(unsigned long)(HAL_TICKS_TO_US(IdleTicks) / 1000));
+		Us = HAL_TICKS_TO_US(Hal_TimeNow() - Start);
+		xil_printf("total : %lu ms, a write, wait and check per region "
+			"would take %lu ms\r\n", (unsigned long)(Us / 1000),
+			(unsigned long)((HAL_TICKS_TO_US(WriteTicks + CheckTicks) +
+			(u64)NumRegions * HoldUs) / 1000));
+	}
+
+	if (BadRegions) {
+		xil_printf("%d of %d regions lost data\r\n", BadRegions, NumRegions);
+		return XST_FAILURE;
+	}
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Refresh Hold Test - END --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+/* Bytes per microsecond of a run, from its first batch to its last */
+static unsigned long RunWallMBps(const StatsRun *RunPtr)
+{
+	u64 Us = HAL_TICKS_TO_US(RunPtr->LastTick - RunPtr->FirstTick);
+
+	return (unsigned long)(Us ? RunPtr->Bytes / Us : 0);
+}
+
+/*****************************************************************************/
+/**
+* Run the CPU-direct March algorithms over a range of the PL DDR4 and
+* compare the CPU write and read bandwidth with the CDMA.
+*
+* The range is mapped for the CPU in the largest blocks the MMU allows, and
+* MATS+, March C- and March SS run one after the other with their own data
+* background. With MARCH_CACHED MATS+ and March C- run write-back
+* cacheable; March SS reads every cell right after writing it, so it always
+* runs non-cacheable. The CDMA figures come from the direction sweep, when
+* it ran.
+*
+* @param	Base is the PL DDR4 bus address to start at
+* @param	Size is the number of bytes to test
+*
+* @return
+*		- XST_SUCCESS if every algorithm passes
+*		- XST_FAILURE otherwise
+*
+* @note		The range is mapped non-cacheable again on return, the DMA
+*		tests rely on their own cache maintenance only.
+*
+******************************************************************************/
+int march_test(UINTPTR Base, u64 Size){
+	static const struct {
+		const MarchAlgorithm *Alg;
+		u64 Background;
+		int Map;
+	} Runs[] = {
+#ifdef MARCH_CACHED
+		{ &March_MatsPlus, 0, HAL_MAP_CACHED },
+		{ &March_CMinus, 0, HAL_MAP_CACHED },
+#else
+		{ &March_MatsPlus, 0, HAL_MAP_NONCACHED },
+		{ &March_CMinus, 0, HAL_MAP_NONCACHED },
+#endif
+		{ &March_SS, 0x5555555555555555ULL, HAL_MAP_NONCACHED },
+	};
+	static MarchResult Result;
+	u64 CpuWriteUs = 0;
+	u64 CpuReadUs = 0;
+	u64 Block = 0;
+	u32 Index;
+	u32 Last;
+	int Map = -1;
+	int Status = XST_SUCCESS;
+
+	if (Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid March range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- March Test - BEGIN --- \r\n");
+	xil_printf("range: 0x%lx - 0x%lx (%luMB)\r\n\r\n",
+		Base, Base + Size - 1, (unsigned long)(Size >> 20));
+
+	for (Index = 0; Index < sizeof(Runs) / sizeof(Runs[0]); Index++) {
+		if (Runs[Index].Map != Map) {
+			Map = Runs[Index].Map;
+			Block = Hal_CpuMapRange(Base, Size, Map);
+		}
+		xil_printf("%s, background 0x%016lx, %s, %luKB blocks\r\n",
+			Runs[Index].Alg->Name, Runs[Index].Background,
+			Map == HAL_MAP_CACHED ? "cacheable" : "non-cacheable",
+			(unsigned long)(Block >> 10));
+		if (March_Run(Runs[Index].Alg, Base, Size, Runs[Index].Background,
+				&DimmFaults, &Result) != XST_SUCCESS) {
+			Status = XST_FAILURE;
+		}
+		March_PrintResult(Runs[Index].Alg, &Result, Size);
+		xil_printf("\r\n");
+
+		/* March C- opens with a pure write and ends with a pure read */
+		if (Runs[Index].Alg == &March_CMinus) {
+			Last = March_CMinus.NumElements - 1;
+			CpuWriteUs = HAL_TICKS_TO_US(Result.ElementTicks[0]);
+			CpuReadUs = HAL_TICKS_TO_US(Result.ElementTicks[Last]);
+		}
+	}
+
+	Hal_CpuMapRange(Base, Size, HAL_MAP_NONCACHED);
+
+	xil_printf("path   write MB/s  read MB/s\r\n");
+	xil_printf("cpu    %10lu  %9lu\r\n",
+		(unsigned long)(CpuWriteUs ? Size / CpuWriteUs : 0),
+		(unsigned long)(CpuReadUs ? Size / CpuReadUs : 0));
+	if (DirectionRun[DIR_WRITE].Batches && DirectionRun[DIR_READ].Batches) {
+		xil_printf("cdma   %10lu  %9lu\r\n",
+			RunWallMBps(&DirectionRun[DIR_WRITE]),
+			RunWallMBps(&DirectionRun[DIR_READ]));
+	} else {
+		xil_printf("cdma   run the direction sweep to compare\r\n");
+	}
+
+	xil_printf("--- March Test - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/*****************************************************************************/
+/**
+* Screen the data and address lines of the PL DDR4 before any bulk test.
+*
+* Walks every DQ bit in every beat of the first burst, then checks that no
+* two power of two offsets of the range alias, with a few hundred
+* non-cacheable CPU accesses. A part with a dead line fails here in
+* milliseconds instead of at the end of a full sweep.
+*
+* @param	Base is the PL DDR4 bus address of the range
+* @param	Size is the number of bytes in the range
+*
+* @return
+*		- XST_SUCCESS if every data and address line works
+*		- XST_FAILURE otherwise
+*
+* @note		Leaves the range mapped non-cacheable.
+*
+******************************************************************************/
+int quick_screen(UINTPTR Base, u64 Size){
+	ScreenResult Result;
+	int Status;
+
+	if (Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid screen range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Quick Screen - BEGIN --- \r\n");
+	Hal_CpuMapRange(Base, Size, HAL_MAP_NONCACHED);
+
+	Screen_Reset(&Result);
+	Status = Screen_DataLines(Base, &Result);
+	if (Screen_AddressLines(Base, Size, &Result) != XST_SUCCESS) {
+		Status = XST_FAILURE;
+	}
+
+	Screen_PrintResult(&Result);
+	xil_printf("  data lines %s, address lines %s\r\n",
+		(Result.DataStuckHigh | Result.DataStuckLow) ? "FAIL" : "ok",
+		(Result.AddrBad || Result.AddrCorrupt) ? "FAIL" : "ok");
+	xil_printf("--- Quick Screen - END --- \r\n\r\n");
+
+	return Status;
+}
+
+#ifdef CHECKPOINT_RESUME
+/* Bytes of checkpoint region Region that lie inside Base..Base+Size */
+static u64 McRegionBytes(u32 Region, UINTPTR Base, u64 Size)
+{
+	u64 Offset = Base - (UINTPTR)Checkpoint.Base;
+	u64 Start = (u64)Region * Checkpoint.RegionLen;
+	u64 End = Start + Checkpoint.RegionLen;
+
+	Start = Start > Offset ? Start : Offset;
+	End = End < Offset + Size ? End : Offset + Size;
+
+	return End > Start ? End - Start : 0;
+}
+
+/* Bytes of the range the checkpoint still has to run for Step */
+static u64 McPendingBytes(u32 Step, UINTPTR Base, u64 Size)
+{
+	u64 Offset = Base - (UINTPTR)Checkpoint.Base;
+	u32 Region;
+	u64 Bytes = 0;
+
+	for (Region = (u32)(Offset / Checkpoint.RegionLen);
+	     Region <= (u32)((Offset + Size - 1) / Checkpoint.RegionLen);
+	     Region++) {
+		if (Ckpt_Pending(&Checkpoint, Step, Region, RetestOnly)) {
+			Bytes += McRegionBytes(Region, Base, Size);
+		}
+	}
+
+	return Bytes;
+}
+
+/* Record the outcome of one mode of the multi-core sweep. A region passes
+ * once every chunk of it passed and fails with its first bad chunk. A region
+ * a failure left unfinished stays pending, and the position goes back to
+ * the first such region so a resumed run covers it.
+ */
+static void McCheckpoint(const McSweep *Sweep, UINTPTR Base, u64 Size)
+{
+	u64 Offset = Base - (UINTPTR)Checkpoint.Base;
+	u32 Resume = Checkpoint.NumRegions;
+	u32 Region;
+
+	for (Region = (u32)(Offset / Checkpoint.RegionLen);
+	     Region <= (u32)((Offset + Size - 1) / Checkpoint.RegionLen);
+	     Region++) {
+		if (!Ckpt_Pending(&Checkpoint, Sweep->Step, Region, RetestOnly)) {
+			continue;
+		}
+
+		if (Sweep->RegionBad[Region]) {
+			Ckpt_Mark(&Checkpoint, Sweep->Step, Region, 0);
+		} else if (Sweep->RegionChunks[Region] ==
+			   McRegionBytes(Region, Base, Size) / BATCH_LEN) {
+			Ckpt_Mark(&Checkpoint, Sweep->Step, Region, 1);
+		} else if (Resume == Checkpoint.NumRegions) {
+			Resume = Region;
+		}
+	}
+	if (Resume != Checkpoint.NumRegions) {
+		Checkpoint.Step = Sweep->Step;
+		Checkpoint.Region = Resume;
+	}
+
+	if (Ckpt_Save(&Checkpoint) != XST_SUCCESS) {
+		xil_printf("Storing the checkpoint failed\r\n");
+	}
+}
+#endif
+
+/*****************************************************************************/
+/**
+* Multi-core version of diff_access_pattern_sweep.
+*
+* For every mode the range is cut into one slice per CPU, in BATCH_LEN
+* chunks. Each CPU tests its own slice with McWorker, and CPUs that finish
+* early steal the remaining chunks of the others, so a slow CPU does not
+* hold up the mode. A per-CPU report follows the sweep.
+*
+* With CHECKPOINT_RESUME the CPUs skip the chunks of regions the checkpoint
+* says are done, and the checkpoint is marked and stored after every mode,
+* so a reset loses at most one mode of work.
+*
+* @param	Base is the PL DDR4 bus address to start at, BATCH_LEN aligned
+* @param	Size is the number of bytes to test, a multiple of BATCH_LEN
+*
+* @return
+*		- XST_SUCCESS if every mode passes over the whole range
+*		- XST_FAILURE otherwise
+*
+* @note		Uses Hal_CpuCount() CPUs and one BATCH_LEN buffer per CPU
+*		from PS_DDR_BASE. The CPUs check the PL DDR4 over the HPM
+*		port, DMA read-back is not supported, see McWorker.
+*
+******************************************************************************/
+int multicore_pattern_sweep(UINTPTR Base, u64 Size){
+	static McSweep Sweep;
+	McSlice Total[HAL_MAX_CPUS];
+	u32 NumChunks = Size / BATCH_LEN;
+	u32 Chunks;
+	u64 SweepStart;
+	u64 SweepTested = 0;
+	u64 Start;
+	u64 Us;
+	u8 Mode;
+	int NumCpus = Hal_CpuCount();
+	int Cpu;
+	int Status;
+
+	if ((Base - PL_DDR4_BASE) % BATCH_LEN || Size % BATCH_LEN || Size == 0 ||
+	    Base < PL_DDR4_BASE || Base - PL_DDR4_BASE + Size > PL_DDR4_SIZE) {
+		xil_printf("Invalid sweep range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	/* CPUs work on far apart chunks at the same time, a copy between
+	 * them could read a chunk another CPU is filling.
+	 */
+	if (TestDirection == DIR_COPY) {
+		xil_printf("PL->PL copy is not supported by the multi-core sweep\r\n");
+		return XST_FAILURE;
+	}
+
+	Status = open_ring_session(DMA_CTRL_DEVICE_ID);
+	if (Status != XST_SUCCESS) {
+		xil_printf("CDMA Initialization failed\r\n");
+		return XST_FAILURE;
+	}
+
+	xil_printf("--- Multi-core Access Pattern Test - BEGIN --- \r\n");
+	xil_printf("range: 0x%lx - 0x%lx (%luMB), %d modes, %d CPUs\r\n\r\n",
+		Base, Base + Size - 1, (unsigned long)(Size >> 20),
+		XMT_MAX_MODE_NUM, NumCpus);
+	if (ReadBackVerify) {
+		xil_printf("DMA read-back is not supported, the CPUs check over "
+			"the HPM port\r\n\r\n");
+	}
+
+	memset(Total, 0, sizeof(Total));
+	Stats_RunInit(&SweepRun, "multi-core sweep",
+		DirectionName[TestDirection], Base, Size);
+	SweepStart = Hal_TimeNow();
+	for (Mode = 0U; Mode < XMT_MAX_MODE_NUM; Mode++) {
+		memset(&Sweep, 0, sizeof(Sweep));
+		Sweep.Base = Base;
+		Sweep.Run = &SweepRun;
+		Sweep.Fill.ModeVal = Mode;
+		Sweep.Fill.Pattern = XMt_ModePattern(Mode);
+		Sweep.NumCpus = NumCpus;
+		for (Cpu = 0; Cpu < NumCpus; Cpu++) {
+			Sweep.Slice[Cpu].Next = (u64)NumChunks * Cpu / NumCpus;
+			Sweep.Slice[Cpu].End = (u64)NumChunks * (Cpu + 1) / NumCpus;
+		}
+#ifdef CHECKPOINT_RESUME
+		Sweep.Step = STEP_PATTERN(Mode);
+		if (McPendingBytes(Sweep.Step, Base, Size) == 0) {
+			xil_printf("[%d/%d] already passed, skipped\r\n", Mode,
+				XMT_MAX_MODE_NUM);
+			continue;
+		}
+#endif
+
+#ifdef PATTERN_CACHE
+		/* Fill the cache before the CPUs race for it */
+		XMt_PatternCache(Mode, Sweep.Fill.Pattern);
+#endif
+
+		Log_PhaseBegin(LOG_TEST_MULTICORE, Mode, TestDirection, Base, Size);
+		Done = 0;
+		Error = 0;
+		Start = Hal_TimeNow();
+		Hal_CpuRun(NumCpus, McWorker, &Sweep);
+		Chunks = 0;
+		for (Cpu = 0; Cpu < NumCpus; Cpu++) {
+			Chunks += Sweep.Slice[Cpu].Chunks;
+		}
+		Log_PhaseEnd(Sweep.Failed || Sweep.BadChunks ? XST_FAILURE :
+			XST_SUCCESS, (u64)Chunks * BATCH_LEN, Chunks,
+			Hal_TimeNow() - Start);
+#ifdef CHECKPOINT_RESUME
+		McCheckpoint(&Sweep, Base, Size);
+#endif
+		if (Sweep.Failed || Sweep.BadChunks) {
+			if (Error) {
+				AbortPipeline();
+			}
+			if (Sweep.XferFails) {
+				xil_printf("CPU %d: transfer failed at 0x%lx, %d "
+					"failed transfers\r\n", Sweep.FailCpu,
+					Sweep.FailAddr, Sweep.XferFails);
+			}
+			xil_printf("Access Pattern Test failed at Mode: %d\r\n", Mode);
+			return XST_FAILURE;
+		}
+
+		SweepTested += (u64)Chunks * BATCH_LEN;
+		Us = HAL_TICKS_TO_US(Hal_TimeNow() - Start);
+		xil_printf("[%d/%d] PASSED in %lu ms (%lu MB/s)\r\n", Mode,
+			XMT_MAX_MODE_NUM, (unsigned long)(Us / 1000),
+			(unsigned long)(Us ? (u64)Chunks * BATCH_LEN / Us : 0));
+
+		for (Cpu = 0; Cpu < NumCpus; Cpu++) {
+			Total[Cpu].Chunks += Sweep.Slice[Cpu].Chunks;
+			Total[Cpu].Stolen += Sweep.Slice[Cpu].Stolen;
+			Total[Cpu].CpuTicks += Sweep.Slice[Cpu].CpuTicks;
+			Total[Cpu].DmaTicks += Sweep.Slice[Cpu].DmaTicks;
+			Total[Cpu].WallTicks += Sweep.Slice[Cpu].WallTicks;
+		}
+	}
+
+	Us = HAL_TICKS_TO_US(Hal_TimeNow() - SweepStart);
+	xil_printf("\r\n%d modes over %luMB, %luMB tested in %lu s (%lu MB/s)\r\n",
+		XMT_MAX_MODE_NUM, (unsigned long)(Size >> 20),
+		(unsigned long)(SweepTested >> 20), (unsigned long)(Us / 1000000),
+		(unsigned long)(Us ? SweepTested / Us : 0));
+
+	xil_printf("\r\ncpu  chunks  stolen  MB/s  gen+verify MB/s  dma wait\r\n");
+	for (Cpu = 0; Cpu < NumCpus; Cpu++) {
+		u64 Bytes = (u64)Total[Cpu].Chunks * BATCH_LEN;
+		u64 WallUs = HAL_TICKS_TO_US(Total[Cpu].WallTicks);
+		u64 CpuUs = HAL_TICKS_TO_US(Total[Cpu].CpuTicks);
+
+		xil_printf("%3d  %6d  %6d  %4lu  %15lu  %7lu%%\r\n", Cpu,
+			Total[Cpu].Chunks, Total[Cpu].Stolen,
+			(unsigned long)(WallUs ? Bytes / WallUs : 0),
+			(unsigned long)(CpuUs ? Bytes / CpuUs : 0),
+			(unsigned long)(Total[Cpu].WallTicks ?
+				Total[Cpu].DmaTicks * 100 / Total[Cpu].WallTicks : 0));
+	}
+	xil_printf("--- Multi-core Access Pattern Test - END --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Time the specialized fill kernel of every mode against the generic
+* per-word XMt_GetRefVal loop, and check that both write the same data.
+*
+* Each path fills FILL_BENCH_BATCHES batches into a PS DDR buffer.
+*
+* @return
+*		- XST_SUCCESS if every kernel matches the generic path
+*		- XST_FAILURE otherwise
+*
+* @note		None
+*
+******************************************************************************/
+int fill_kernel_benchmark(){
+	static VerifyResult Result;
+	UINTPTR GenericAddr = PS_DDR_BASE;
+	UINTPTR KernelAddr = PS_DDR_BASE + BATCH_LEN;
+	u64 *GenericPtr = (u64 *)Hal_Ptr(GenericAddr);
+	u64 *KernelPtr = (u64 *)Hal_Ptr(KernelAddr);
+	u64 Bytes = (u64)FILL_BENCH_BATCHES * BATCH_LEN;
+	u64 GenericTicks;
+	u64 KernelTicks;
+	u64 Start;
+	u32 Batch;
+	u8 Mode;
+
+	xil_printf("--- Fill Kernel Benchmark - BEGIN --- \r\n");
+	xil_printf("%d x %lu bytes per mode\r\n\r\n", FILL_BENCH_BATCHES,
+		(unsigned long)BATCH_LEN);
+	xil_printf("mode  generic MB/s  kernel MB/s  speedup\r\n");
+
+	for (Mode = 0U; Mode < XMT_MAX_MODE_NUM; Mode++) {
+		Start = Hal_TimeNow();
+		for (Batch = 0; Batch < FILL_BENCH_BATCHES; Batch++) {
+			XMt_FillGeneric(GenericPtr, PL_DDR4_BASE, Mode,
+				XMt_ModePattern(Mode), BATCH_LEN);
+		}
+		GenericTicks = Hal_TimeNow() - Start;
+
+		Start = Hal_TimeNow();
+		for (Batch = 0; Batch < FILL_BENCH_BATCHES; Batch++) {
+			XMt_FillPattern(KernelPtr, PL_DDR4_BASE, Mode,
+				XMt_ModePattern(Mode), BATCH_LEN);
+		}
+		KernelTicks = Hal_TimeNow() - Start;
+
+		if (Verify_Compare(GenericPtr, KernelPtr, BATCH_LEN, &Result)) {
+			xil_printf("Fill kernel of mode %d does not match:\r\n", Mode);
+			Verify_PrintResult(&Result, KernelAddr);
+			return XST_FAILURE;
+		}
+
+		if (GenericTicks == 0 || KernelTicks == 0) {
+			continue;
+		}
+		xil_printf("%4d  %12lu  %11lu  %4lu.%lux\r\n", Mode,
+			(unsigned long)(Bytes / HAL_TICKS_TO_US(GenericTicks)),
+			(unsigned long)(Bytes / HAL_TICKS_TO_US(KernelTicks)),
+			(unsigned long)(GenericTicks / KernelTicks),
+			(unsigned long)(GenericTicks * 10 / KernelTicks % 10));
+	}
+
+	xil_printf("--- Fill Kernel Benchmark - END --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Compare the CPU cost of polling for DMA completion with sleeping until the
+* coalesced CDMA interrupt, for a few coalescing thresholds.
+*
+* COMPLETION_BENCH_BATCHES batches are copied between PS DDR and PL DDR4 one
+* at a time with TransferBatch. Per GB moved it reports the wall time, the
+* CPU time spent waiting actively (all of it when polling) and the CPU time
+* freed, i.e. asleep in WaitCompletion, along with the interrupt rate.
+*
+* @param	None
+*
+* @return
+*		- XST_SUCCESS if every transfer completes
+*		- XST_FAILURE otherwise
+*
+* @note		Leaves the ring session closed, the next test reopens it in
+*		the default completion mode.
+*
+******************************************************************************/
+int completion_benchmark(){
+	static const u32 Thresholds[] = { 0, 1, 16, NUMBER_OF_BDS_TO_TRANSFER };
+	u64 Bytes = (u64)COMPLETION_BENCH_BATCHES * BATCH_LEN;
+	u64 WallTicks;
+	u64 Start;
+	UINTPTR PlAddr;
+	u32 Run;
+	u32 Batch;
+	int Status = XST_SUCCESS;
+
+	xil_printf("--- Completion Benchmark - BEGIN --- \r\n");
+	xil_printf("%d batches of %lu bytes, coalescing delay %d\r\n\r\n",
+		COMPLETION_BENCH_BATCHES, (unsigned long)BATCH_LEN,
+		COALESCE_DELAY);
+	xil_printf("completion  MB/s   wall ms/GB  busy ms/GB  freed ms/GB  irq/GB\r\n");
+
+	for (Run = 0; Run < sizeof(Thresholds) / sizeof(Thresholds[0]); Run++) {
+		/* Threshold 0 is the polled baseline */
+		IntrCompletion = Thresholds[Run] != 0;
+		if (IntrCompletion) {
+			CoalesceThreshold = Thresholds[Run];
+		}
+
+		close_ring_session();
+		Status = open_ring_session(DMA_CTRL_DEVICE_ID);
+		if (Status != XST_SUCCESS) {
+			xil_printf("CDMA Initialization failed\r\n");
+			break;
+		}
+
+		CdmaEvents = 0;
+		IntrWaitTicks = 0;
+		Start = Hal_TimeNow();
+		for (Batch = 0; Batch < COMPLETION_BENCH_BATCHES; Batch++) {
+			PlAddr = PL_DDR4_BASE + (UINTPTR)Batch * BATCH_LEN;
+#ifdef WRITE_TEST
+			Status = TransferBatch(PS_DDR_BASE, PlAddr);
+#else
+			Status = TransferBatch(PlAddr, PS_DDR_BASE);
+#endif
+			if (Status != XST_SUCCESS) {
+				xil_printf("Transfer failed at 0x%lx\r\n", PlAddr);
+				break;
+			}
+		}
+		WallTicks = Hal_TimeNow() - Start;
+		if (Status != XST_SUCCESS) {
+			break;
+		}
+
+		if (IntrCompletion) {
+			xil_printf("irq/%-6d", Thresholds[Run]);
+		} else {
+			xil_printf("polling   ");
+		}
+		xil_printf("  %5lu  %10lu  %10lu  %11lu  %6lu\r\n",
+			(unsigned long)(Bytes / HAL_TICKS_TO_US(WallTicks + 1)),
+			(unsigned long)(HAL_TICKS_TO_US(WallTicks) *
+				(1ULL << 30) / Bytes / 1000),
+			(unsigned long)(HAL_TICKS_TO_US(WallTicks - IntrWaitTicks) *
+				(1ULL << 30) / Bytes / 1000),
+			(unsigned long)(HAL_TICKS_TO_US(IntrWaitTicks) *
+				(1ULL << 30) / Bytes / 1000),
+			(unsigned long)((u64)CdmaEvents * (1ULL << 30) / Bytes));
+	}
+
+#ifdef INTERRUPT_COMPLETION
+	IntrCompletion = 1;
+#else
+	IntrCompletion = 0;
+#endif
+	CoalesceThreshold = COALESCE_THRESHOLD;
+	close_ring_session();
+
+	xil_printf("--- Completion Benchmark - END --- \r\n\r\n");
+
+	return Status;
+}
+
+/*****************************************************************************/
+/*
+* Set up the buffers one kernel of the kernel benchmark reads, so that the
+* checks pass.
+*
+******************************************************************************/
+static void KBenchSetup(int Kernel, s32 ModeVal, u32 Length)
+{
+	switch (Kernel) {
+	case KBENCH_CHECK:
+		PrepareBatch(KBENCH_SRC, KBENCH_DST, Length);
+		PrepareBatch(KBENCH_DST, KBENCH_SRC, Length);
+		break;
+	case KBENCH_CHECKBATCH:
+		XMt_FillPattern((u64 *)Hal_Ptr(KBENCH_DST), PL_DDR4_BASE, ModeVal,
+			XMt_ModePattern((u8)ModeVal), Length);
+		Hal_DCacheFlushRange(KBENCH_DST, Length);
+		break;
+	default:
+		break;
+	}
+}
+
+/*****************************************************************************/
+/*
+* Run one kernel of the kernel benchmark Reps times over Length bytes.
+*
+* @return
+*		- XST_SUCCESS, with the ticks the kernel took in *TicksPtr
+*		- XST_FAILURE if a check or a transfer failed
+*
+* @note		KBENCH_SUBMIT only counts the time DoTransfer takes, not the
+*		transfers.
+*
+******************************************************************************/
+static int KBenchRun(int Kernel, s32 ModeVal, u32 Length, u32 Reps,
+		u64 *TicksPtr)
+{
+	XMtFillArg Arg;
+	u64 Start;
+	u64 Submit;
+	u32 Rep;
+	u32 Offset;
+	int Status = XST_SUCCESS;
+
+	Arg.ModeVal = ModeVal;
+	Arg.Pattern = ModeVal < 0 ? NULL : XMt_ModePattern((u8)ModeVal);
+
+	Submit = RingStats.SubmitTicks;
+	Start = Hal_TimeNow();
+	for (Rep = 0; Rep < Reps && Status == XST_SUCCESS; Rep++) {
+		switch (Kernel) {
+		case KBENCH_PREPARE:
+			PrepareBatch(KBENCH_SRC, KBENCH_DST, Length);
+			break;
+		case KBENCH_SETUP:
+			SetupTransfer_MOD(KBENCH_SRC, KBENCH_DST, ModeVal,
+				Arg.Pattern, Length);
+			break;
+		case KBENCH_GETREF:
+			XMt_FillGeneric((u64 *)Hal_Ptr(KBENCH_SRC), PL_DDR4_BASE,
+				ModeVal, Arg.Pattern, Length);
+			break;
+		case KBENCH_CHECK:
+			Status = CheckData(KBENCH_SRC, KBENCH_DST, (int)Length);
+			break;
+		case KBENCH_CHECKBATCH:
+			for (Offset = 0; Offset < Length && Status == XST_SUCCESS;
+			     Offset += BATCH_LEN) {
+				Status = XMt_CheckBatch(PL_DDR4_BASE + Offset,
+					KBENCH_DST + Offset, &Arg);
+			}
+			break;
+		default:
+			for (Offset = 0; Offset < Length && Status == XST_SUCCESS;
+			     Offset += BATCH_LEN) {
+				Status = TransferBatch(KBENCH_SRC + Offset,
+					PL_DDR4_BASE + Offset);
+			}
+			break;
+		}
+	}
+	*TicksPtr = Hal_TimeNow() - Start;
+
+	if (Kernel == KBENCH_SUBMIT) {
+		*TicksPtr = RingStats.SubmitTicks - Submit;
+	}
+
+	return Status;
+}
+
+/* Time one kernel over Length bytes and print its result line */
+static int KBenchRow(int Kernel, s32 ModeVal, u32 Length)
+{
+	u64 Ticks[KBENCH_RUNS];
+	u64 Key;
+	u64 Ns;
+	u32 Reps = 1;
+	int Run;
+	int Index;
+	int Status;
+
+	/* Untimed call first, so every page and line the kernel touches has
+	 * been touched once
+	 */
+	KBenchSetup(Kernel, ModeVal, Length);
+	Status = KBenchRun(Kernel, ModeVal, Length, 1, &Ticks[0]);
+
+	/* Double the calls per run until a run is long enough to time */
+	while (Status == XST_SUCCESS) {
+		Status = KBenchRun(Kernel, ModeVal, Length, Reps, &Ticks[0]);
+		if (HAL_TICKS_TO_US(Ticks[0]) >= KBENCH_MIN_US ||
+		    Reps >= 0x100000U) {
+			break;
+		}
+		Reps *= 2;
+	}
+
+	/* The median of the runs, one run disturbed either way does not
+	 * move it
+	 */
+	for (Run = 1; Run < KBENCH_RUNS && Status == XST_SUCCESS; Run++) {
+		Status = KBenchRun(Kernel, ModeVal, Length, Reps, &Key);
+		for (Index = Run; Index > 0 && Ticks[Index - 1] > Key; Index--) {
+			Ticks[Index] = Ticks[Index - 1];
+		}
+		Ticks[Index] = Key;
+	}
+	if (Status != XST_SUCCESS) {
+		xil_printf("Kernel %s failed over %lu bytes\r\n", KBenchName[Kernel],
+			(unsigned long)Length);
+		return XST_FAILURE;
+	}
+
+	Ns = Ticks[KBENCH_RUNS / 2] * 1000000000ULL / HAL_TICKS_PER_SEC / Reps;
+	if (ModeVal < 0) {
+		xil_printf("kbench,%s,-,", KBenchName[Kernel]);
+	} else {
+		xil_printf("kbench,%s,%d,", KBenchName[Kernel], ModeVal);
+	}
+	xil_printf("%lu,%lu,%lu,%lu\r\n", (unsigned long)Length,
+		(unsigned long)Reps, (unsigned long)Ns,
+		(unsigned long)(Ns ? (u64)Length * 1000 / Ns : 0));
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Time the CPU kernels of the tests over buffers of KBENCH_MIN_LEN to
+* KBENCH_MAX_LEN bytes: the byte fill of PrepareBatch, the pattern fill of
+* SetupTransfer_MOD, the per-word XMt_GetRefVal path, CheckData,
+* XMt_CheckBatch and the BD setup of DoTransfer. The pattern kernels run
+* every mode, the kernels that work one batch at a time start at
+* BATCH_LEN.
+*
+* Each result is the median of KBENCH_RUNS runs, with as many calls per
+* run as make it last KBENCH_MIN_US. It is printed as one line
+*
+*   kbench,<kernel>,<mode or ->,<bytes>,<calls per run>,<ns per call>,<MB/s>
+*
+* which host_sim/sodimm_benchcmp compares with a baseline of the same
+* lines, also out of a console log of the board.
+*
+* @param	None
+*
+* @return
+*		- XST_SUCCESS if every kernel ran and every check passed
+*		- XST_FAILURE otherwise
+*
+* @note		Opens the ring session for the BD setup timing.
+*
+******************************************************************************/
+int kernel_benchmark(){
+	int Kernel;
+	s32 Mode;
+	s32 LastMode;
+	u32 Length;
+	int Status;
+
+	xil_printf("--- Kernel Benchmark - BEGIN --- \r\n");
+
+	Status = open_ring_session(DMA_CTRL_DEVICE_ID);
+	if (Status != XST_SUCCESS) {
+		xil_printf("CDMA Initialization failed\r\n");
+		return XST_FAILURE;
+	}
+
+	xil_printf("kbench,kernel,mode,bytes,calls,ns,mbps\r\n");
+	for (Kernel = 0; Kernel < KBENCH_NUM_KERNELS; Kernel++) {
+		/* Mode -1 runs a kernel that has no modes once */
+		LastMode = (Kernel == KBENCH_SETUP || Kernel == KBENCH_GETREF ||
+			Kernel == KBENCH_CHECKBATCH) ? (s32)XMT_MAX_MODE_NUM - 1 : -1;
+
+		for (Mode = LastMode < 0 ? -1 : 0; Mode <= LastMode; Mode++) {
+			for (Length = KBENCH_MIN_LEN; Length <= KBENCH_MAX_LEN;
+			     Length *= 4) {
+				if ((Kernel == KBENCH_CHECKBATCH ||
+				     Kernel == KBENCH_SUBMIT) && Length < BATCH_LEN) {
+					continue;
+				}
+				if (Kernel == KBENCH_SUBMIT && Length > PL_DDR4_SIZE) {
+					continue;
+				}
+				Status = KBenchRow(Kernel, Mode, Length);
+				if (Status != XST_SUCCESS) {
+					return XST_FAILURE;
+				}
+			}
+		}
+	}
+
+	xil_printf("--- Kernel Benchmark - END --- \r\n\r\n");
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* The entry point for this example. It sets up uart16550 if one is available,
+* invokes the example function, and reports the execution status.
+*
+* @param	None.
+*
+* @return
+*		- XST_SUCCESS if example finishes successfully
+*		- XST_FAILURE if example fails.
+*
+* @note		None.
+*
+******************************************************************************/
+#ifndef TESTAPP_GEN
+#ifdef CHECKPOINT_RESUME
+/*****************************************************************************/
+/*
+* Pick up the checkpoint of the last run over the PL DDR4, or start a new
+* one. A finished run starts over unless only the regions that did not pass
+* are to be tested again.
+*
+******************************************************************************/
+static void checkpoint_open(void)
+{
+	if (Ckpt_Load(&Checkpoint, PL_DDR4_BASE, PL_DDR4_SIZE,
+			TestDirection) != XST_SUCCESS) {
+		xil_printf("No checkpoint of this range, starting from scratch\r\n");
+	} else if (Checkpoint.Step == CKPT_STEP_DONE && !RetestOnly) {
+		xil_printf("Last run finished, starting from scratch\r\n");
+		Ckpt_Init(&Checkpoint, PL_DDR4_BASE, PL_DDR4_SIZE, TestDirection);
+	} else {
+		xil_printf("%s the last run\r\n", RetestOnly ?
+			"Re-testing what did not pass in" : "Resuming");
+		Ckpt_PrintSummary(&Checkpoint, NUM_STEPS);
+	}
+	xil_printf("\r\n");
+}
+
+/* Store the checkpoint once more, marked finished if every test passed */
+static void checkpoint_close(int Finished)
+{
+	if (Finished) {
+		Checkpoint.Step = CKPT_STEP_DONE;
+		Checkpoint.Region = 0;
+	}
+	if (Ckpt_Save(&Checkpoint) != XST_SUCCESS) {
+		xil_printf("Storing the checkpoint failed\r\n");
+	}
+	Ckpt_PrintSummary(&Checkpoint, NUM_STEPS);
+}
+#endif
+
+/*****************************************************************************/
+/*
+* Give up on a failed test. The fault and log summaries are printed, which
+* also drains the records still in the ring of the result stream, and the
+* checkpoint is stored unfinished.
+*
+* @param	Msg is the line to print first
+*
+* @return	XST_FAILURE, for main to return
+*
+******************************************************************************/
+static int fail_exit(const char *Msg)
+{
+	xil_printf("%s\r\n", Msg);
+	Fault_PrintSummary(&DimmFaults);
+	Log_PrintSummary();
+#ifdef CHECKPOINT_RESUME
+	checkpoint_close(0);
+#endif
+
+	return XST_FAILURE;
+}
+
+int main()
+{
+	int Status;
+
+#ifdef XPAR_UARTNS550_0_BASEADDR
+	Uart550_Setup();
+#endif
+
+	xil_printf("\r\n--- Entering main() --- \r\n");
+
+	Fault_Init(&DimmFaults, PL_DDR4_BASE);
+
+#ifdef KERNEL_BENCH
+	Status = kernel_benchmark();
+	if(Status != XST_SUCCESS){
+		xil_printf("Kernel Benchmark failed\r\n");
+		return XST_FAILURE;
+	}
+	xil_printf("--- Exiting main() --- \r\n");
+
+	return XST_SUCCESS;
+#endif
+
+	Log_Init();
+
+#ifdef CHECKPOINT_RESUME
+	checkpoint_open();
+#endif
+
+#ifdef QUICK_SCREEN
+	Status = quick_screen(SCREEN_BASE, SCREEN_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Quick Screen failed, skipping the bulk tests");
+	}
+#endif
+
+	//access range test
+#ifdef PIPELINED_TEST
+	Status = access_range_test_pipelined();
+#else
+	Status = access_range_test();
+#endif
+	if(Status != XST_SUCCESS){
+		return fail_exit("Access Range Test failed");
+	}
+
+	//reset transmit/receive address to the base address
+#ifdef WRITE_TEST
+	TransmitBufferAddr = PS_DDR_BASE;
+	ReceiveBufferAddr = PL_DDR4_BASE;
+#else
+	TransmitBufferAddr = PL_DDR4_BASE;
+	ReceiveBufferAddr = PS_DDR_BASE;
+#endif
+
+	//different pattern testing (referred to DRAM Test provided by Vivado SDK, originally for PS DDR)
+#if defined(MULTICORE_TEST)
+	Status = multicore_pattern_sweep(PATTERN_SWEEP_BASE, PATTERN_SWEEP_SIZE);
+#elif defined(FULL_PATTERN_SWEEP)
+	Status = diff_access_pattern_sweep(PATTERN_SWEEP_BASE, PATTERN_SWEEP_SIZE);
+#else
+	Status = diff_access_pattern_test();
+#endif
+	if(Status != XST_SUCCESS){
+		return fail_exit("Access Pattern Test failed");
+	}
+
+#ifdef DIRECTION_SWEEP
+	Status = direction_sweep(DIRECTION_SWEEP_BASE, DIRECTION_SWEEP_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Direction Sweep failed");
+	}
+#endif
+
+#ifdef TRAFFIC_PROFILE
+	Status = traffic_profile(TRAFFIC_BASE, TRAFFIC_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Traffic Profile failed");
+	}
+#endif
+
+#ifdef STRIPE_SCALING
+	Status = stripe_scaling(STRIPE_BASE, STRIPE_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Stripe Scaling failed");
+	}
+#endif
+
+#ifdef DATAPATH_SWEEP
+	Status = datapath_sweep(DATAPATH_BASE, DATAPATH_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Datapath Sweep failed");
+	}
+#endif
+
+#ifdef REPLICATE_FILL
+	Status = replicate_fill_test(REPLICATE_BASE, REPLICATE_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Replication Fill failed");
+	}
+#endif
+
+#ifdef HOLD_TEST
+	Status = hold_test(HOLD_BASE, HOLD_SIZE, HOLD_TIME_US);
+	if(Status != XST_SUCCESS){
+		return fail_exit("Refresh Hold Test failed");
+	}
+#endif
+
+#ifdef MARCH_TEST
+	Status = march_test(MARCH_TEST_BASE, MARCH_TEST_SIZE);
+	if(Status != XST_SUCCESS){
+		return fail_exit("March Test failed");
+	}
+#endif
+
+#ifdef FILL_BENCHMARK
+	Status = fill_kernel_benchmark();
+	if(Status != XST_SUCCESS){
+		return fail_exit("Fill Kernel Benchmark failed");
+	}
+#endif
+
+#ifdef COMPLETION_BENCHMARK
+	Status = completion_benchmark();
+	if(Status != XST_SUCCESS){
+		return fail_exit("Completion Benchmark failed");
+	}
+#endif
+
+	PrintRingSessionStats();
+	PrintBatchStats();
+#ifdef CHECKPOINT_RESUME
+	/* A resumed run starts after the region that failed, so the failure
+	 * must not be lost by marking the run finished.
+	 */
+	if (Ckpt_FailedRegions(&Checkpoint)) {
+		xil_printf("%d regions failed in this run or the one it resumed\r\n",
+			Ckpt_FailedRegions(&Checkpoint));
+		return fail_exit("Build with RETEST_ONLY to test them again");
+	}
+#endif
+	Fault_PrintSummary(&DimmFaults);
+	Log_PrintSummary();
+#ifdef CHECKPOINT_RESUME
+	checkpoint_close(1);
+#endif
+
+	xil_printf("Successfully ran all tests\r\n");
+	xil_printf("--- Exiting main() --- \r\n");
+
+	return XST_SUCCESS;
+}
+#endif
+
+
+#if defined(XPAR_UARTNS550_0_BASEADDR)
+/*****************************************************************************/
+/*
+* This function setup the baudrate to 9600 and data bits to 8 in Uart16550
+*
+* @param	None
+*
+* @return	None
 *
 * @note		None
 *
@@ -454,143 +3552,129 @@ static void Uart550_Setup(void)
 * If the DMA engine has errors or any of the finished BDs has error bit set,
 * then the example should fail.
 *
-* @param	InstancePtr is pointer to the XAxiCdma instance.
+* @param	InstancePtr is pointer to the CDMA engine handle.
 *
 * @return	Number of Bds that have been completed by hardware.
 *
 * @note		None
 *
 ******************************************************************************/
-static int CheckCompletion(XAxiCdma *InstancePtr)
+static int CheckCompletion(HalCdma *InstancePtr)
 {
 	int BdCount;
-	XAxiCdma_Bd *BdPtr;
-	XAxiCdma_Bd *BdCurPtr;
-	int Status;
-	int Index;
 
-	/* Check whether the hardware has encountered any problems.
-	 * In some error cases, the DMA engine may not able to update the
-	 * BD that has caused the problem.
+	/* The interrupt handler has already reaped everything */
+	if (IntrCompletion) {
+		return Done;
+	}
+
+	/* Get all processed BDs from hardware, check them and release them.
+	 * The HAL reports both engine errors and BD errors as -1.
 	 */
-	if (XAxiCdma_GetError(InstancePtr) != 0x0) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Transfer error %x\r\n",
-		    (unsigned int)XAxiCdma_GetError(InstancePtr));
+	BdCount = Hal_BdRingReap(InstancePtr);
+	if (BdCount < 0) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Transfer error\r\n");
 
 		Error = 1;
 		return 0;
 	}
 
-	/* Get all processed BDs from hardware
-	 */
-	BdCount = XAxiCdma_BdRingFromHw(InstancePtr, XAXICDMA_ALL_BDS, &BdPtr);
-
-	/* Check finished BDs then release them
-	 */
-	if(BdCount > 0) {
-		BdCurPtr = BdPtr;
-
-		for (Index = 0; Index < BdCount; Index++) {
-
-			/* If the completed BD has error bit set,
-			 * then the example fails
-			 */
-			if (XAxiCdma_BdGetSts(BdCurPtr) &
-			    XAXICDMA_BD_STS_ALL_ERR_MASK)	{
-				Error = 1;
-				return 0;
-			}
+	Done += BdCount;
 
-			BdCurPtr = XAxiCdma_BdRingNext(InstancePtr, BdCurPtr);
-		}
+	return Done;
+}
 
-		/* Release the BDs so later submission can use them
-		 */
-		Status = XAxiCdma_BdRingFree(InstancePtr, BdCount, BdPtr);
+/*****************************************************************************/
+/*
+* Completion handler of the interrupt mode, called by the HAL in interrupt
+* context with the number of BDs it has just reaped.
+*
+* @param	Ref is not used.
+* @param	BdCount is the number of finished BDs, -1 on a transfer error.
+*
+* @return	None
+*
+* @note		None
+*
+******************************************************************************/
+static void CdmaDoneHandler(void *Ref, int BdCount)
+{
+	(void)Ref;
 
-		if(Status != XST_SUCCESS) {
-			xdbg_printf(XDBG_DEBUG_ERROR,
-			    "Error free BD %x\r\n", Status);
+	if (BdCount < 0) {
+		Error = 1;
+	} else {
+		Done += BdCount;
+	}
+	CdmaEvents++;
+}
 
-			Error = 1;
-			return 0;
-		}
+/*****************************************************************************/
+/*
+* Wait for the next completion event. Polling returns at once and lets the
+* caller spin on CheckCompletion. With interrupts the CPU sleeps until the
+* handler has run since CdmaEvents was Seen, and the time is added to
+* IntrWaitTicks.
+*
+* @param	Seen is CdmaEvents as read before the last CheckCompletion.
+*
+* @return	None
+*
+* @note		None
+*
+******************************************************************************/
+static void WaitCompletion(int Seen)
+{
+	u64 Start;
 
-		Done += BdCount;
+	if (!IntrCompletion) {
+		return;
 	}
 
-	return Done;
+	Start = Hal_TimeNow();
+	Hal_CdmaWaitIntr(AxiCdmaInstancePtr, &CdmaEvents, Seen);
+	IntrWaitTicks += Hal_TimeNow() - Start;
 }
 
 /*****************************************************************************/
 /**
 *
-* This function sets up the DMA engine to be ready for scatter gather transfer
+* This function fills one batch of the transmit buffer with the test pattern
+* and flushes both buffers so the DMA sees memory, not the cache.
 *
-* @param	InstancePtr is pointer to the XAxiCdma instance.
+* @param	SrcAddr is the bus address of the transmit buffer
+* @param	DstAddr is the bus address of the receive buffer
+* @param	Length is the number of bytes, BATCH_LEN but for the kernel
+*		benchmark
 *
-* @return
-*		- XST_SUCCESS if the setup is successful
-*		- XST_FAILURE if error occurs
+* @return	None
 *
 * @note		None
 *
 ******************************************************************************/
-static int SetupTransfer(XAxiCdma * InstancePtr)
+static void PrepareBatch(UINTPTR SrcAddr, UINTPTR DstAddr, u32 Length)
 {
-	int Status;
-	XAxiCdma_Bd BdTemplate;
-	int BdCount;
 	u8 *SrcBufferPtr;
 	long Index;
 
-	/* Disable all interrupts
-	 */
-	XAxiCdma_IntrDisable(InstancePtr, XAXICDMA_XR_IRQ_ALL_MASK);
-
-	/* Setup BD ring */
-	BdCount = XAxiCdma_BdRingCntCalc(XAXICDMA_BD_MINIMUM_ALIGNMENT,
-				    BD_SPACE_HIGH - BD_SPACE_BASE + 1,
-				    (UINTPTR)BD_SPACE_BASE);
-
-	Status = XAxiCdma_BdRingCreate(InstancePtr, BD_SPACE_BASE,
-		BD_SPACE_BASE, XAXICDMA_BD_MINIMUM_ALIGNMENT, BdCount);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD ring failed %d\r\n",
-							 	Status);
-		return XST_FAILURE;
-	}
-
-	/*
-	 * Setup a BD template to copy to every BD.
-	 */
-	XAxiCdma_BdClear(&BdTemplate);
-	Status = XAxiCdma_BdRingClone(InstancePtr, &BdTemplate);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Clone BD ring failed %d\r\n",
-				Status);
-
-		return XST_FAILURE;
-	}
-
 	/* Initialize receive buffer to 0's and transmit buffer with pattern
 	 */
-	//memset((void *)ReceiveBufferPtr, 0, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
+	//memset(Hal_Ptr(DstAddr), 0, BATCH_LEN);
 
-	SrcBufferPtr = (u8 *)TransmitBufferPtr;
-	for(Index = 0; Index < MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER; Index++) {
+	SrcBufferPtr = (u8 *)Hal_Ptr(SrcAddr);
+	for(Index = 0; Index < Length; Index++) {
 		SrcBufferPtr[Index] = Index & 0xFF;
 	}
 
 	/* Flush the SrcBuffer before the DMA transfer, in case the Data Cache
 	 * is enabled
 	 */
-	Xil_DCacheFlushRange((UINTPTR)TransmitBufferPtr, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
+	Hal_DCacheFlushRange(SrcAddr, Length);
 #ifdef __aarch64__
-	Xil_DCacheFlushRange((UINTPTR)ReceiveBufferPtr, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
+	Hal_DCacheFlushRange(DstAddr, Length);
+#else
+	(void)DstAddr;
 #endif
-
-	return XST_SUCCESS;
 }
 
 /*****************************************************************************/
@@ -599,79 +3683,33 @@ static int SetupTransfer(XAxiCdma * InstancePtr)
 * This function non-blockingly transmits all packets through the DMA engine.
 *
 * @param	InstancePtr points to the DMA engine instance
+* @param	SrcAddr is the bus address of the first packet to read
+* @param	DstAddr is the bus address of the first packet to write
 *
 * @return
 *		- XST_SUCCESS if the DMA accepts all the packets successfully,
 *		- XST_FAILURE if error occurs
 *
-* @note		None
+* @note		The BDs come from the ring session, see open_ring_session.
 *
 ******************************************************************************/
-static int DoTransfer(XAxiCdma * InstancePtr)
+static int DoTransfer(HalCdma * InstancePtr, UINTPTR SrcAddr, UINTPTR DstAddr)
 {
-	XAxiCdma_Bd *BdPtr;
-	XAxiCdma_Bd *BdCurPtr;
 	int Status;
-	int Index;
-	UINTPTR SrcBufferAddr;
-	UINTPTR DstBufferAddr;
-
-	Status = XAxiCdma_BdRingAlloc(InstancePtr,
-		    NUMBER_OF_BDS_TO_TRANSFER, &BdPtr);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Failed bd alloc\r\n");
-
-		return XST_FAILURE;
-	}
-
-	SrcBufferAddr = (UINTPTR)TransmitBufferPtr;
-	DstBufferAddr = (UINTPTR)ReceiveBufferPtr;
-	BdCurPtr = BdPtr;
-
-	/* Set up the BDs
-	 */
-	for(Index = 0; Index < NUMBER_OF_BDS_TO_TRANSFER; Index++) {
-		Status = XAxiCdma_BdSetSrcBufAddr(BdCurPtr, SrcBufferAddr);
-		if(Status != XST_SUCCESS) {
-			xdbg_printf(XDBG_DEBUG_ERROR,
-			    "Set src addr failed %d, %x/%x\r\n",
-			    Status, (unsigned int)BdCurPtr,
-			    (unsigned int)SrcBufferAddr);
-
-			return XST_FAILURE;
-		}
+	u64 Start;
 
-		Status = XAxiCdma_BdSetDstBufAddr(BdCurPtr, DstBufferAddr);
-		if(Status != XST_SUCCESS) {
-			xdbg_printf(XDBG_DEBUG_ERROR,
-			    "Set dst addr failed %d, %x/%x\r\n",
-			    Status, (unsigned int)BdCurPtr,
-			    (unsigned int)DstBufferAddr);
-
-			return XST_FAILURE;
-		}
-
-		Status = XAxiCdma_BdSetLength(BdCurPtr, MAX_PKT_LEN);
-		if(Status != XST_SUCCESS) {
-			xdbg_printf(XDBG_DEBUG_ERROR,
-			    "Set BD length failed %d\r\n", Status);
-
-			return XST_FAILURE;
-		}
-
-		SrcBufferAddr += MAX_PKT_LEN;
-		DstBufferAddr += MAX_PKT_LEN;
-
-		BdCurPtr = XAxiCdma_BdRingNext(InstancePtr, BdCurPtr);
-	}
-
-	/* Give the BDs to hardware */
-	Status = XAxiCdma_BdRingToHw(InstancePtr, NUMBER_OF_BDS_TO_TRANSFER, BdPtr, NULL, NULL);
+	/* Patch the next BD chain and give it to hardware */
+	Start = Hal_TimeNow();
+	Status = Hal_BdChainSubmit(InstancePtr, SrcAddr, DstAddr);
 	if (Status != XST_SUCCESS) {
 		xdbg_printf(XDBG_DEBUG_ERROR, "Failed to hw %d\r\n", Status);
 		return XST_FAILURE;
 	}
 
+	/* Only batches that went to hardware count for the ns per batch */
+	RingStats.SubmitTicks += Hal_TimeNow() - Start;
+	RingStats.Batches++;
+
 	return XST_SUCCESS;
 }
 
@@ -679,36 +3717,51 @@ static int DoTransfer(XAxiCdma * InstancePtr)
 /*
 * This function checks that two buffers have the same data
 *
-* @param	SrcPtr is the source buffer
-* @param	DestPtr is the destination buffer
-* @param	Length is the length of the buffer to check
+* @param	SrcAddr is the bus address of the source buffer
+* @param	DestAddr is the bus address of the destination buffer
+* @param	Length is the length of the buffer to check, a multiple of 8
 *
 * @return
 *		- XST_SUCCESS if the two buffer matches
 *		- XST_FAILURE otherwise
 *
-* @note		None
+* @note		On a mismatch the whole buffer is still compared, and the
+*		bad cache lines and first failing words are printed.
 *
 ******************************************************************************/
-static int CheckData(u8 *SrcPtr, u8 *DestPtr, int Length)
+static int CheckData(UINTPTR SrcAddr, UINTPTR DestAddr, int Length)
 {
-	int Index;
-
 	/* Invalidate the DestBuffer before receiving the data, in case the
 	 * Data Cache is enabled
 	 */
 #ifndef __aarch64__
-	Xil_DCacheInvalidateRange((UINTPTR)DestPtr, Length);
+	Hal_DCacheInvalidateRange(DestAddr, Length);
 #endif
 
-	for (Index = 0; Index < Length; Index++) {
-		if ( DestPtr[Index] != SrcPtr[Index]) {
-			xdbg_printf(XDBG_DEBUG_ERROR,
-			    "Data check failure %d: %x/%x\r\n",
-			    Index, DestPtr[Index], SrcPtr[Index]);
+	return CheckDataAt(SrcAddr, DestAddr, Length,
+		XMt_PlAddr(SrcAddr, DestAddr));
+}
 
-			return XST_FAILURE;
+/* CheckData of a buffer that holds a copy of the PL DDR4 at PlAddr, faults
+ * are logged at their PL DDR4 address
+ */
+static int CheckDataAt(UINTPTR SrcAddr, UINTPTR DestAddr, int Length,
+		UINTPTR PlAddr)
+{
+	static VerifyResult Result;
+
+	Verify_Reset(&Result);
+	Result.Log = &DimmFaults;
+	Result.LogAddr = PlAddr;
+	if (Verify_CompareChunk(Hal_Ptr(SrcAddr), Hal_Ptr(DestAddr), Length, 0,
+			&Result)) {
+		Log_Failure(PlAddr, (u32)Length, &Result);
+		if (Hal_AtomicFetchAdd(&FailedBatches, 1) < FAIL_PRINT_BATCHES) {
+			xil_printf("Data check failure at 0x%lx:\r\n", PlAddr);
+			Verify_PrintResult(&Result, PlAddr);
 		}
+
+		return XST_FAILURE;
 	}
 
 	return XST_SUCCESS;
@@ -716,50 +3769,167 @@ static int CheckData(u8 *SrcPtr, u8 *DestPtr, int Length)
 
 /* re-factoring the following process */
 int init_cdma(u16 DeviceId){
-	int Status;
-	XAxiCdma_Config *CfgPtr;
-
-#ifdef __aarch64__
-	Xil_SetTlbAttributes(BD_SPACE_BASE, MARK_UNCACHEABLE);
-#endif
-
 	/* Initialize the XAxiCdma device.
 	 */
-	CfgPtr = XAxiCdma_LookupConfig(DeviceId);
-	if (!CfgPtr) {
+	AxiCdmaInstancePtr = Hal_CdmaInitialize(DeviceId);
+	if (AxiCdmaInstancePtr == NULL) {
 		xdbg_printf(XDBG_DEBUG_ERROR,
-		    "Cannot find config structure for device %d\r\n",
-			XPAR_AXICDMA_0_DEVICE_ID);
+		    "Initialization failed for device %d\r\n", DeviceId);
+
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
 
+/*****************************************************************************/
+/**
+* Initialize the CDMA and build RING_SESSION_CHAINS BD chains of
+* NUMBER_OF_BDS_TO_TRANSFER BDs, unless that was already done. Every batch
+* after the first one only patches the src/dst addresses of a chain.
+*
+* @param	DeviceId is the Device Id of the XAxiCdma instance
+*
+* @return
+* 		- XST_SUCCESS if the session is open
+* 		- XST_FAILURE if error occurs
+*
+* @note		The first call also times one full init_cdma plus ring
+*		rebuild, which is what every batch used to pay.
+*
+******************************************************************************/
+int open_ring_session(u16 DeviceId){
+	int Status;
+	u64 Start;
+
+	if (RingSessionOpen) {
+		return XST_SUCCESS;
+	}
+
+	Start = Hal_TimeNow();
+	Status = init_cdma(DeviceId);
+	if (Status != XST_SUCCESS) {
 		return XST_FAILURE;
 	}
 
-	Status = XAxiCdma_CfgInitialize(&AxiCdmaInstance, CfgPtr,
-		CfgPtr->BaseAddress);
+	Status = Hal_BdRingCreate(AxiCdmaInstancePtr);
 	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR,
-		    "Initialization failed with %d\r\n", Status);
+		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD ring failed %d\r\n", Status);
+		return XST_FAILURE;
+	}
+	RingStats.RebuildTicks = Hal_TimeNow() - Start;
 
+	Start = Hal_TimeNow();
+	Status = Hal_BdChainCreate(AxiCdmaInstancePtr, RING_SESSION_CHAINS,
+		NUMBER_OF_BDS_TO_TRANSFER, MAX_PKT_LEN);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD chains failed %d\r\n", Status);
 		return XST_FAILURE;
 	}
+	RingStats.OpenTicks += Hal_TimeNow() - Start;
+
+	/* Building the chains leaves the engine in polled mode */
+	if (IntrCompletion) {
+		Status = Hal_CdmaIntrEnable(AxiCdmaInstancePtr, CoalesceThreshold,
+			COALESCE_DELAY, CdmaDoneHandler, NULL);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR, "Enable interrupts failed %d\r\n",
+				Status);
+			return XST_FAILURE;
+		}
+	}
+
+	RingSessionOpen = 1;
 
 	return XST_SUCCESS;
 }
 
+/* Force the next batch to rebuild the ring, e.g. after the CDMA was reset */
+void close_ring_session(void){
+	RingSessionOpen = 0;
+}
+
+void PrintRingSessionStats(void){
+	u64 Saved;
+
+	if (RingStats.Batches == 0) {
+		return;
+	}
+
+	Saved = RingStats.RebuildTicks * (RingStats.Batches - 1);
+
+	xil_printf("BD ring session: built in %lu us, %lu batches submitted in %lu us (%lu ns/batch)\r\n",
+		(unsigned long)HAL_TICKS_TO_US(RingStats.OpenTicks),
+		(unsigned long)RingStats.Batches,
+		(unsigned long)HAL_TICKS_TO_US(RingStats.SubmitTicks),
+		(unsigned long)(HAL_TICKS_TO_US(RingStats.SubmitTicks * 1000) / RingStats.Batches));
+	xil_printf("  a per-batch CDMA init + ring rebuild costs %lu us, %lu us of setup removed\r\n\r\n",
+		(unsigned long)HAL_TICKS_TO_US(RingStats.RebuildTicks),
+		(unsigned long)HAL_TICKS_TO_US(Saved));
+}
+
+/* Summary of the per-batch timing of every range test that ran */
+void PrintBatchStats(void){
+	int Dir;
+
+	xil_printf("\r\n--- Batch Timing Summary --- \r\n");
+	Stats_PrintRun(&AccessRun);
+	Stats_PrintRun(&SweepRun);
+	for (Dir = 0; Dir < NUM_DIRECTIONS; Dir++) {
+		Stats_PrintRun(&DirectionRun[Dir]);
+	}
+}
+
 int test_cdma_transfer(){
 	int Status;
-	u8 *SrcPtr;
-	u8 *DstPtr;
+	UINTPTR SrcAddr;
+	UINTPTR DstAddr;
+
+	SrcAddr = TransmitBufferAddr;
+	DstAddr = ReceiveBufferAddr;
+
+	Status = TransferBatch(SrcAddr, DstAddr);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	/* Transfer completed successfully, check data */
+	Status = CheckData(SrcAddr, DstAddr, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Check data failed for sg transfer\r\n");
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
 
-	SrcPtr = (u8 *)TransmitBufferPtr;
-	DstPtr = (u8 *)ReceiveBufferPtr;
+/*****************************************************************************/
+/*
+* Send one batch through the BD ring session and wait for it to finish.
+*
+* @param	SrcAddr is the bus address of the batch source
+* @param	DstAddr is the bus address of the batch destination
+*
+* @return
+*		- XST_SUCCESS if the transfer completes without error
+*		- XST_FAILURE otherwise, the CDMA is reset and the session
+*		  closed
+*
+* @note		The ring session must be open.
+*
+******************************************************************************/
+static int TransferBatch(UINTPTR SrcAddr, UINTPTR DstAddr)
+{
+	int Status;
+	int Events;
 
 	Done = 0;
 	Error = 0;
+	Events = CdmaEvents;
 
 	/* Start the DMA transfer
 	 */
-	Status = DoTransfer(&AxiCdmaInstance);
+	Status = DoTransfer(AxiCdmaInstancePtr, SrcAddr, DstAddr);
 	if (Status != XST_SUCCESS) {
 		xdbg_printf(XDBG_DEBUG_ERROR, "Do transfer failed with %d\r\n", Status);
 		return XST_FAILURE;
@@ -767,38 +3937,26 @@ int test_cdma_transfer(){
 
 	/* Wait until the DMA transfer is done or error occurs
 	 */
-	while ((CheckCompletion(&AxiCdmaInstance) < NUMBER_OF_BDS_TO_TRANSFER)
+	while ((CheckCompletion(AxiCdmaInstancePtr) < NUMBER_OF_BDS_TO_TRANSFER)
 		&& !Error) {
-		/* Wait */
+		WaitCompletion(Events);
+		Events = CdmaEvents;
 	}
 
 	if(Error) {
-		int TimeOut = RESET_LOOP_COUNT;
-
 		xdbg_printf(XDBG_DEBUG_ERROR, "Transfer has error %x\r\n", Error);
 
 		/* Need to reset the hardware to restore to the correct state */
-		XAxiCdma_Reset(&AxiCdmaInstance);
-
-		while (TimeOut) {
-			if (XAxiCdma_ResetIsDone(&AxiCdmaInstance)) {
-				break;
-			}
-			TimeOut -= 1;
-		}
+		Status = Hal_CdmaReset(AxiCdmaInstancePtr, RESET_LOOP_COUNT);
 
 		/* Reset has failed, print a message to notify the user
 		 */
-		if (!TimeOut) {
+		if (Status != XST_SUCCESS) {
 			xdbg_printf(XDBG_DEBUG_ERROR, "Reset hardware failed with %d\r\n", Status);
 		}
-		return XST_FAILURE;
-	}
 
-	/* Transfer completed successfully, check data */
-	Status = CheckData(SrcPtr, DstPtr, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Check data failed for sg transfer\r\n");
+		/* The reset dropped the BD ring, rebuild it for the next batch */
+		close_ring_session();
 		return XST_FAILURE;
 	}
 
@@ -822,19 +3980,14 @@ int XAxiCdma_SgPollExample(u16 DeviceId)
 {
 	int Status;
 
-	Status = init_cdma(DeviceId);
+	/* Initialize the CDMA and the BD ring on the first batch only */
+	Status = open_ring_session(DeviceId);
 	if (Status != XST_SUCCESS) {
 		xdbg_printf(XDBG_DEBUG_ERROR, "CDMA Initialization failed with %d\r\n", Status);
 		return XST_FAILURE;
 	}
 
-	/* Setup the BD ring
-	 */
-	Status = SetupTransfer(&AxiCdmaInstance);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Setup BD ring failed with %d\r\n", Status);
-		return XST_FAILURE;
-	}
+	PrepareBatch(TransmitBufferAddr, ReceiveBufferAddr, BATCH_LEN);
 
 	Status = test_cdma_transfer();
 	if(Status != XST_SUCCESS){
@@ -847,81 +4000,265 @@ int XAxiCdma_SgPollExample(u16 DeviceId)
 }
 
 
-static u64 XMt_GetRefVal(u64 Addr, u64 Index, s32 ModeVal, u64 *Pattern)
+/* Seed of the random stream of modes 11-14, a different stream per mode */
+static u64 XMt_RandomSeed(s32 ModeVal)
 {
-	u64 RefVal;
-	u64 Mod128;
 	s64 RandVal;
 
 	/* Create a Random Value */
 	RandVal = XMT_RANDOM_VALUE(ModeVal);
+	RandVal = XMT_YLFSR(RandVal);
+
+	return Pattern_Mix64((u64)RandVal);
+}
+
+static u64 XMt_GetRefVal(u64 Addr, u64 Index, s32 ModeVal, u64 *Pattern)
+{
+	u64 RefVal;
+	u64 Mod128;
 
 	if (ModeVal == 0U) {
-		RefVal = ((((Addr + 4) << 32) | Addr) & U64_MASK);
+		/* Each 32-bit half holds its own address. The upper address
+		 * bits are XORed in rather than ORed so that every word of a
+		 * >4GB window stays unique.
+		 */
+		RefVal = ((((Addr + 4) << 32) ^ Addr) & U64_MASK);
 	} else if (ModeVal <= 8U) {
 		RefVal = (u64)Pattern[(Index % 32) / 8];
 	} else if (ModeVal <= 10U) {
 		Mod128 = (Index >> 2) & 0x07f;
 		RefVal = (u64)Pattern[Mod128] & U64_MASK;
 	} else {
-		RandVal = XMT_YLFSR(RandVal);
-		RefVal = RandVal & U64_MASK;
+		/* Seekable random stream, see Pattern_FillRandom */
+		RefVal = Pattern_RandomWord(XMt_RandomSeed(ModeVal), Addr);
 	}
 
 	return RefVal;
 }
 
-static int SetupTransfer_MOD(XAxiCdma * InstancePtr, s32 ModeVal, u64 *Pattern)
+/* The PL DDR4 side of a transfer, which mode 0 encodes in the data. For a
+ * PL->PL copy it is the destination.
+ */
+static UINTPTR XMt_PlAddr(UINTPTR SrcAddr, UINTPTR DstAddr)
 {
-	int Status;
-	XAxiCdma_Bd BdTemplate;
-	int BdCount;
-	u64 *SrcBufferPtr;
-	u64 Index;
-	u64 RefVal;
+	if (DstAddr - PL_DDR4_BASE < PL_DDR4_SIZE) {
+		return DstAddr;
+	}
 
-	/* Disable all interrupts */
-	XAxiCdma_IntrDisable(InstancePtr, XAXICDMA_XR_IRQ_ALL_MASK);
+	return SrcAddr;
+}
 
-	/* Setup BD ring */
-	BdCount = XAxiCdma_BdRingCntCalc(XAXICDMA_BD_MINIMUM_ALIGNMENT,
-				    BD_SPACE_HIGH - BD_SPACE_BASE + 1,
-				    (UINTPTR)BD_SPACE_BASE);
+/* Reference fill: one XMt_GetRefVal call per word */
+static void XMt_FillGeneric(u64 *Dst, UINTPTR Addr, s32 ModeVal, u64 *Pattern,
+		u32 Length)
+{
+	u64 Index;
 
-	Status = XAxiCdma_BdRingCreate(InstancePtr, BD_SPACE_BASE,
-		BD_SPACE_BASE, XAXICDMA_BD_MINIMUM_ALIGNMENT, BdCount);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD ring failed %d\r\n",
-							 	Status);
-		return XST_FAILURE;
+	for(Index = 0; Index < Length; Index += 8) {
+		*Dst = XMt_GetRefVal((u64)(Addr + Index), Index, ModeVal, Pattern);
+		Dst++;
 	}
+}
 
-	/* Setup a BD template to copy to every BD. */
-	XAxiCdma_BdClear(&BdTemplate);
-	Status = XAxiCdma_BdRingClone(InstancePtr, &BdTemplate);
-	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Clone BD ring failed %d\r\n",
-				Status);
-
-		return XST_FAILURE;
+/*****************************************************************************/
+/**
+* Fill a buffer with the pattern of ModeVal using the kernel for its mode
+* family. The result is the same as calling XMt_GetRefVal for every word with
+* Index counting from 0 at Dst.
+*
+* @param	Dst is the CPU pointer to the buffer
+* @param	Addr is the address mode 0 encodes for the first word
+* @param	ModeVal is the pattern mode
+* @param	Pattern is the table of the mode, see XMt_ModePattern
+* @param	Length is the number of bytes, a multiple of PATTERN_FILL_ALIGN
+*
+* @return	None
+*
+******************************************************************************/
+static void XMt_FillPattern(u64 *Dst, UINTPTR Addr, s32 ModeVal, u64 *Pattern,
+		u32 Length)
+{
+	if (ModeVal == 0U) {
+		Pattern_FillAddr(Dst, Addr, Length);
+	} else if (ModeVal <= 8U) {
+		Pattern_FillRepeat4(Dst, Pattern, Length);
+	} else if (ModeVal <= 10U) {
+		Pattern_FillMask(Dst, Pattern, Length);
+	} else {
+		Pattern_FillRandom(Dst, XMt_RandomSeed(ModeVal), Addr, Length);
 	}
+}
 
+static int SetupTransfer_MOD(UINTPTR SrcAddr, UINTPTR DstAddr, s32 ModeVal,
+		u64 *Pattern, u32 Length)
+{
 	/* Initialize receive buffer to 0's and transmit buffer with pattern */
-	SrcBufferPtr = (u64 *)TransmitBufferPtr;
-	for(Index = 0; Index < MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER; Index += 8) {
-		*SrcBufferPtr = XMt_GetRefVal((u64)SrcBufferPtr, Index, ModeVal, Pattern);
-		//xil_printf("index: %lu, curr addr: %lx\r\n", Index, SrcBufferPtr);
-		SrcBufferPtr++;
-	}
+	XMt_FillPattern((u64 *)Hal_Ptr(SrcAddr), XMt_PlAddr(SrcAddr, DstAddr),
+		ModeVal, Pattern, Length);
 
 	/* Flush the SrcBuffer before the DMA transfer, in case the Data Cache
 	 * is enabled
 	 */
-	Xil_DCacheFlushRange((UINTPTR)TransmitBufferPtr, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
+	Hal_DCacheFlushRange(SrcAddr, Length);
+#ifdef __aarch64__
+	Hal_DCacheFlushRange(DstAddr, Length);
+#endif
+
+	return XST_SUCCESS;
+}
+
+#ifdef PATTERN_CACHE
+/*****************************************************************************/
+/**
+* Resident source block of an address independent mode. The first call for
+* a mode generates BATCH_LEN bytes of it into the pattern cache and flushes
+* them, later calls only return the block. Nothing writes the block again,
+* so every batch of the mode can be sent from it.
+*
+* @param	ModeVal is the pattern mode
+* @param	Pattern is the table of the mode, see XMt_ModePattern
+*
+* @return	Bus address of the block, or 0 for mode 0 and the random
+*		modes, whose data depends on the address
+*
+* @note		Not safe to race on a mode that is not cached yet, the
+*		multi-core sweep calls it before the CPUs start.
+*
+******************************************************************************/
+static UINTPTR XMt_PatternCache(s32 ModeVal, u64 *Pattern)
+{
+	UINTPTR Block;
+
+	if ((ModeVal == 0U) || (ModeVal > 10U)) {
+		return 0;
+	}
+
+	Block = PATTERN_CACHE_BASE + (UINTPTR)(ModeVal - 1) * BATCH_LEN;
+	if (!(PatternCached & (1U << ModeVal))) {
+		XMt_FillPattern((u64 *)Hal_Ptr(Block), 0, ModeVal, Pattern,
+			BATCH_LEN);
+		Hal_DCacheFlushRange(Block, BATCH_LEN);
+		PatternCached |= 1U << ModeVal;
+	}
+
+	return Block;
+}
+#endif
+
+/*****************************************************************************/
+/**
+* PipelineFillFn for the pattern sweep, Arg is an XMtFillArg.
+*
+* A batch with a PS DDR source of an address independent mode is sent from
+* the pattern cache, so the CPU neither writes nor flushes anything for it.
+* Mode 0 and the random modes change every word from batch to batch, so
+* their source is still generated per batch, with the fill kernels.
+*
+* @return	Bus address to send the batch from
+*
+******************************************************************************/
+static UINTPTR XMt_FillBatch(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	XMtFillArg *FillArg = Arg;
+#ifdef PATTERN_CACHE
+	UINTPTR CacheAddr;
+
+	if (SrcAddr - PL_DDR4_BASE >= PL_DDR4_SIZE) {
+		CacheAddr = XMt_PatternCache(FillArg->ModeVal, FillArg->Pattern);
+		if (CacheAddr) {
 #ifdef __aarch64__
-	Xil_DCacheFlushRange((UINTPTR)ReceiveBufferPtr, MAX_PKT_LEN * NUMBER_OF_BDS_TO_TRANSFER);
+			/* No stale lines over what the check reads back */
+			Hal_DCacheFlushRange(DstAddr, BATCH_LEN);
+#endif
+			return CacheAddr;
+		}
+	}
+#endif
+
+	SetupTransfer_MOD(SrcAddr, DstAddr, FillArg->ModeVal, FillArg->Pattern,
+		BATCH_LEN);
+
+	return SrcAddr;
+}
+
+/*****************************************************************************/
+/**
+* PipelineVerifyFn for the pattern sweep. The expected data is regenerated
+* with the fill kernels PATTERN_FILL_ALIGN bytes at a time into a buffer
+* that stays in L1, so only the destination is read back and the source
+* buffer is never touched.
+*
+* @param	SrcAddr is the bus address of the batch source, unused
+* @param	DstAddr is the bus address of the batch destination
+* @param	Arg is the XMtFillArg the batch was filled with
+*
+* @return
+*		- XST_SUCCESS if the destination holds the expected pattern
+*		- XST_FAILURE otherwise
+*
+* @note		On a mismatch the bad cache lines and first failing words
+*		are printed.
+*
+******************************************************************************/
+static int XMt_CheckBatch(UINTPTR SrcAddr, UINTPTR DstAddr, void *Arg)
+{
+	UINTPTR PlAddr = XMt_PlAddr(SrcAddr, DstAddr);
+
+	return XMt_CheckPattern(DstAddr, PlAddr, PlAddr, Arg);
+}
+
+/*****************************************************************************/
+/**
+* Check one batch against the pattern the fill kernels generate for
+* PatternAddr, which is where the data was first written. Only a PL->PL copy
+* checks data away from the address it was generated for.
+*
+* @param	DstAddr is the bus address of the batch destination
+* @param	PatternAddr is the address the expected pattern is made for
+* @param	PlAddr is the PL DDR4 address failures are logged at
+* @param	FillArg is the pattern the batch was filled with
+*
+* @return
+*		- XST_SUCCESS if the destination holds the expected pattern
+*		- XST_FAILURE otherwise
+*
+******************************************************************************/
+static int XMt_CheckPattern(UINTPTR DstAddr, UINTPTR PatternAddr,
+		UINTPTR PlAddr, const XMtFillArg *FillArg)
+{
+	VerifyResult Result;	/* per call, the multi-core sweep runs this on
+				 * every CPU */
+	const u8 *DestPtr = (const u8 *)Hal_Ptr(DstAddr);
+	u64 Expected[PATTERN_FILL_ALIGN / sizeof(u64)];
+	u32 Offset;
+
+#ifndef __aarch64__
+	Hal_DCacheInvalidateRange(DstAddr, BATCH_LEN);
 #endif
 
+	Verify_Reset(&Result);
+	Result.Log = &DimmFaults;
+	Result.LogAddr = PlAddr;
+	for (Offset = 0; Offset < BATCH_LEN; Offset += PATTERN_FILL_ALIGN) {
+		XMt_FillPattern(Expected, PatternAddr + Offset, FillArg->ModeVal,
+			FillArg->Pattern, PATTERN_FILL_ALIGN);
+		Verify_CompareChunk(Expected, DestPtr + Offset,
+			PATTERN_FILL_ALIGN, Offset, &Result);
+	}
+
+	if (Result.BadWords) {
+		Log_Failure(PlAddr, BATCH_LEN, &Result);
+		if (Hal_AtomicFetchAdd(&FailedBatches, 1) < FAIL_PRINT_BATCHES) {
+			Hal_SpinLock(&PrintLock);
+			xil_printf("Data check failure at 0x%lx (mode %d):\r\n",
+				PlAddr, FillArg->ModeVal);
+			Verify_PrintResult(&Result, PlAddr);
+			Hal_SpinUnlock(&PrintLock);
+		}
+
+		return XST_FAILURE;
+	}
+
 	return XST_SUCCESS;
 }
 
@@ -929,16 +4266,18 @@ static int XMt_Memtest(u16 DeviceId, s32 ModeVal, u64 *Pattern)
 {
 	int Status;
 
-	Status = init_cdma(DeviceId);
+	/* Initialize the CDMA and the BD ring on the first batch only */
+	Status = open_ring_session(DeviceId);
 	if (Status != XST_SUCCESS) {
 		xdbg_printf(XDBG_DEBUG_ERROR, "CDMA Initialization failed with %d\r\n", Status);
 		return XST_FAILURE;
 	}
 
-	/* Setup the BD ring */
-	Status = SetupTransfer_MOD(&AxiCdmaInstance, ModeVal, Pattern);
+	/* Fill the transmit buffer */
+	Status = SetupTransfer_MOD(TransmitBufferAddr, ReceiveBufferAddr, ModeVal,
+		Pattern, BATCH_LEN);
 	if (Status != XST_SUCCESS) {
-		xdbg_printf(XDBG_DEBUG_ERROR, "Setup BD ring failed with %d\r\n", Status);
+		xdbg_printf(XDBG_DEBUG_ERROR, "Setup transfer failed with %d\r\n", Status);
 		return XST_FAILURE;
 	}
 
@@ -0,0 +1,271 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_checkpoint.c
+ *
+ * Progress checkpoints, see sodimm_checkpoint.h.
+ *
+ ****************************************************************************/
+#include "sodimm_checkpoint.h"
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/******************** Constant Definitions **********************************/
+
+#define CKPT_FNV_OFFSET		0x811C9DC5U
+#define CKPT_FNV_PRIME		0x01000193U
+
+/* Failed regions listed per step by Ckpt_PrintSummary */
+#define CKPT_PRINT_REGIONS	8U
+
+/*****************************************************************************/
+/*
+* FNV-1a of the checkpoint from the field after Crc to the end.
+*
+******************************************************************************/
+static u32 CkptCrc(const Ckpt *CkptPtr)
+{
+	const u8 *Byte = (const u8 *)&CkptPtr->Direction;
+	const u8 *End = (const u8 *)(CkptPtr + 1);
+	u32 Crc = CKPT_FNV_OFFSET;
+
+	while (Byte < End) {
+		Crc = (Crc ^ *Byte++) * CKPT_FNV_PRIME;
+	}
+
+	return Crc;
+}
+
+/*****************************************************************************/
+/**
+* Length of the regions a range of Size bytes is cut into: Size /
+* CKPT_MAX_REGIONS bytes, at least CKPT_MIN_REGION, rounded up to a power of
+* two. Other tests that work region by region use it as well.
+*
+* @param	Size is the number of bytes of the range
+*
+* @return	Bytes per region
+*
+******************************************************************************/
+u64 Ckpt_RegionLen(u64 Size)
+{
+	u64 RegionLen = CKPT_MIN_REGION;
+
+	while (RegionLen * CKPT_MAX_REGIONS < Size) {
+		RegionLen <<= 1;
+	}
+
+	return RegionLen;
+}
+
+/*****************************************************************************/
+/**
+* Start a checkpoint with nothing tested.
+*
+* @param	CkptPtr is the checkpoint to set up
+* @param	Base is the bus address of the range the steps cover
+* @param	Size is the number of bytes of the range
+* @param	Direction tells runs in different directions apart
+*
+* @return	None
+*
+* @note		Regions are Ckpt_RegionLen(Size) bytes.
+*
+******************************************************************************/
+void Ckpt_Init(Ckpt *CkptPtr, UINTPTR Base, u64 Size, u32 Direction)
+{
+	u64 RegionLen = Ckpt_RegionLen(Size);
+
+	memset(CkptPtr, 0, sizeof(*CkptPtr));
+	CkptPtr->Magic = CKPT_MAGIC;
+	CkptPtr->Version = CKPT_VERSION;
+	CkptPtr->Direction = Direction;
+	CkptPtr->Base = Base;
+	CkptPtr->Size = Size;
+	CkptPtr->RegionLen = RegionLen;
+	CkptPtr->NumRegions = (u32)((Size + RegionLen - 1) / RegionLen);
+}
+
+/*****************************************************************************/
+/**
+* Pick up the checkpoint of an earlier run.
+*
+* @param	CkptPtr receives the checkpoint
+* @param	Base, Size and Direction describe this run, as for Ckpt_Init
+*
+* @return
+*		- XST_SUCCESS if a checkpoint of the same range and direction
+*		  was found and is intact
+*		- XST_FAILURE if not, CkptPtr then holds a fresh checkpoint
+*
+******************************************************************************/
+int Ckpt_Load(Ckpt *CkptPtr, UINTPTR Base, u64 Size, u32 Direction)
+{
+	Ckpt Fresh;
+
+	Ckpt_Init(&Fresh, Base, Size, Direction);
+
+	if (Hal_PersistLoad(CkptPtr, sizeof(*CkptPtr)) != XST_SUCCESS ||
+	    CkptPtr->Magic != CKPT_MAGIC || CkptPtr->Version != CKPT_VERSION ||
+	    CkptPtr->Crc != CkptCrc(CkptPtr) ||
+	    CkptPtr->Direction != Direction || CkptPtr->Base != Fresh.Base ||
+	    CkptPtr->Size != Size || CkptPtr->RegionLen != Fresh.RegionLen) {
+		*CkptPtr = Fresh;
+		return XST_FAILURE;
+	}
+
+	CkptPtr->Resumes++;
+
+	return XST_SUCCESS;
+}
+
+/* Seal the checkpoint and hand it to the backend */
+int Ckpt_Save(Ckpt *CkptPtr)
+{
+	CkptPtr->Crc = CkptCrc(CkptPtr);
+
+	return Hal_PersistStore(CkptPtr, sizeof(*CkptPtr));
+}
+
+/*****************************************************************************/
+/**
+* Record the outcome of a step over a region and move the position past it.
+*
+* @param	CkptPtr is the checkpoint
+* @param	Step is the step, below CKPT_MAX_STEPS
+* @param	Region is the region the step just ran over
+* @param	Passed is 1 if every batch of the region passed
+*
+* @return	None, Ckpt_Save stores the result
+*
+******************************************************************************/
+void Ckpt_Mark(Ckpt *CkptPtr, u32 Step, u32 Region, int Passed)
+{
+	u16 Bit = (u16)(1U << Step);
+
+	if (Passed) {
+		CkptPtr->Passed[Region] |= Bit;
+		CkptPtr->Failed[Region] &= (u16)~Bit;
+	} else {
+		CkptPtr->Passed[Region] &= (u16)~Bit;
+		CkptPtr->Failed[Region] |= Bit;
+	}
+	CkptPtr->Step = Step;
+	CkptPtr->Region = Region + 1U;
+}
+
+/*****************************************************************************/
+/**
+* Tell whether a step still has to run over a region.
+*
+* @param	CkptPtr is the checkpoint
+* @param	Step is the step
+* @param	Region is the region
+* @param	RetestOnly is 0 to resume from the recorded position, 1 to
+*		run wherever the step has not passed yet, whatever the
+*		position
+*
+* @return	1 if the step has to run over the region, 0 if not
+*
+******************************************************************************/
+int Ckpt_Pending(const Ckpt *CkptPtr, u32 Step, u32 Region, int RetestOnly)
+{
+	if (RetestOnly) {
+		return !(CkptPtr->Passed[Region] & (1U << Step));
+	}
+
+	if (CkptPtr->Step == CKPT_STEP_DONE) {
+		return 0;
+	}
+
+	return Step > CkptPtr->Step ||
+		(Step == CkptPtr->Step && Region >= CkptPtr->Region);
+}
+
+/*****************************************************************************/
+/**
+* Count the regions some step failed in last. A resumed run does not run
+* them again, so they stay failed until a re-test passes them.
+*
+* @param	CkptPtr is the checkpoint
+*
+* @return	Number of regions with a bit set in Failed
+*
+******************************************************************************/
+u32 Ckpt_FailedRegions(const Ckpt *CkptPtr)
+{
+	u32 Region;
+	u32 Count = 0;
+
+	for (Region = 0; Region < CkptPtr->NumRegions; Region++) {
+		Count += CkptPtr->Failed[Region] != 0;
+	}
+
+	return Count;
+}
+
+/*****************************************************************************/
+/**
+* Print the position and, per step, how many regions passed, failed and
+* were never covered, with the first failed regions of each step.
+*
+* @param	CkptPtr is the checkpoint
+* @param	NumSteps is the number of steps of the run
+*
+* @return	None
+*
+******************************************************************************/
+void Ckpt_PrintSummary(const Ckpt *CkptPtr, u32 NumSteps)
+{
+	u32 Step;
+	u32 Region;
+	u32 Passed;
+	u32 Failed;
+	u32 Listed;
+	u16 Bit;
+
+	xil_printf("checkpoint: %d regions of %luMB from 0x%lx, resumed %d "
+		"times, ", CkptPtr->NumRegions,
+		(unsigned long)(CkptPtr->RegionLen >> 20),
+		(UINTPTR)CkptPtr->Base, CkptPtr->Resumes);
+	if (CkptPtr->Step == CKPT_STEP_DONE) {
+		xil_printf("finished\r\n");
+	} else {
+		xil_printf("at step %d region %d\r\n", CkptPtr->Step,
+			CkptPtr->Region);
+	}
+
+	for (Step = 0; Step < NumSteps; Step++) {
+		Bit = (u16)(1U << Step);
+		Passed = 0;
+		Failed = 0;
+		for (Region = 0; Region < CkptPtr->NumRegions; Region++) {
+			Passed += (CkptPtr->Passed[Region] & Bit) != 0;
+			Failed += (CkptPtr->Failed[Region] & Bit) != 0;
+		}
+		if (Passed == CkptPtr->NumRegions) {
+			continue;
+		}
+
+		xil_printf("  step %2d: %d passed, %d failed, %d untested",
+			Step, Passed, Failed,
+			CkptPtr->NumRegions - Passed - Failed);
+		Listed = 0;
+		for (Region = 0; Region < CkptPtr->NumRegions &&
+		     Listed < CKPT_PRINT_REGIONS; Region++) {
+			if (CkptPtr->Failed[Region] & Bit) {
+				xil_printf("%s 0x%lx", Listed ? "," : ", failed at",
+					(UINTPTR)(CkptPtr->Base +
+					Region * CkptPtr->RegionLen));
+				Listed++;
+			}
+		}
+		xil_printf("\r\n");
+	}
+}
@@ -0,0 +1,68 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_checkpoint.h
+ *
+ * Progress checkpoints of the long sweeps.
+ *
+ * A full pass over a 32GB DIMM runs the access range test and every
+ * pattern mode over the whole range, and one failure or board reset used
+ * to throw all of it away. The range is cut into at most CKPT_MAX_REGIONS
+ * regions, and each test is a step. After every region the checkpoint
+ * records the step, the next region and, per region, which steps passed
+ * and which failed, and stores itself with Hal_PersistStore: in a reserved
+ * region of PS DDR on the board, in a file on the host.
+ *
+ * A later run picks the checkpoint up with Ckpt_Load and either resumes at
+ * the recorded position or re-tests only the regions a step has not seen
+ * pass, i.e. those that failed or were never covered. Resuming starts after
+ * a failed region, so a run only counts as passed while Ckpt_FailedRegions
+ * finds none.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_CHECKPOINT_H
+#define SODIMM_CHECKPOINT_H
+
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+#define CKPT_MAGIC		0x54504B53U	/* "SKPT" */
+#define CKPT_VERSION		1U
+
+#define CKPT_MAX_REGIONS	4096U
+#define CKPT_MIN_REGION		0x800000ULL	/* 8MB, keeps the pipeline full */
+#define CKPT_MAX_STEPS		16U		/* bits of the per-region masks */
+
+#define CKPT_STEP_DONE		0xFFFFFFFFU	/* every step ran to the end */
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u32 Magic;
+	u32 Version;
+	u32 Crc;		/* FNV-1a of everything after it */
+	u32 Direction;		/* TestDirection of the run */
+	u64 Base;		/* bus address of region 0 */
+	u64 Size;
+	u64 RegionLen;
+	u32 NumRegions;
+	u32 Step;		/* step in progress, or CKPT_STEP_DONE */
+	u32 Region;		/* next region of Step */
+	u32 Resumes;		/* times the run was picked up again */
+	u16 Passed[CKPT_MAX_REGIONS];	/* bit n: step n passed the region */
+	u16 Failed[CKPT_MAX_REGIONS];	/* bit n: step n failed in it last */
+} Ckpt;
+
+/************************** Function Prototypes ******************************/
+
+u64 Ckpt_RegionLen(u64 Size);
+void Ckpt_Init(Ckpt *CkptPtr, UINTPTR Base, u64 Size, u32 Direction);
+int Ckpt_Load(Ckpt *CkptPtr, UINTPTR Base, u64 Size, u32 Direction);
+int Ckpt_Save(Ckpt *CkptPtr);
+void Ckpt_Mark(Ckpt *CkptPtr, u32 Step, u32 Region, int Passed);
+int Ckpt_Pending(const Ckpt *CkptPtr, u32 Step, u32 Region, int RetestOnly);
+u32 Ckpt_FailedRegions(const Ckpt *CkptPtr);
+void Ckpt_PrintSummary(const Ckpt *CkptPtr, u32 NumSteps);
+
+#endif /* SODIMM_CHECKPOINT_H */
@@ -0,0 +1,218 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_fault.c
+ *
+ * Failure recorder, see sodimm_fault.h.
+ *
+ ****************************************************************************/
+#include "sodimm_fault.h"
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/******************** Constant Definitions **********************************/
+
+#define FAULT_ROW_HASH		0x9E3779B1U	/* golden ratio, 32-bit */
+
+/*****************************************************************************/
+/*
+* Count one failing word against its row. Probes at most FAULT_ROW_PROBES
+* slots from the hash of the row.
+*
+******************************************************************************/
+static void FaultRowAdd(FaultLog *LogPtr, u32 Key)
+{
+	u32 Slot = ((Key * FAULT_ROW_HASH) >> 16) & (FAULT_ROW_SLOTS - 1U);
+	u32 Probe;
+
+	for (Probe = 0; Probe < FAULT_ROW_PROBES; Probe++) {
+		FaultRow *RowPtr = &LogPtr->Row[(Slot + Probe) &
+			(FAULT_ROW_SLOTS - 1U)];
+
+		if (RowPtr->Key == Key) {
+			RowPtr->Words++;
+			return;
+		}
+		if (RowPtr->Key == 0) {
+			RowPtr->Key = Key;
+			RowPtr->Words = 1;
+			return;
+		}
+	}
+
+	LogPtr->RowOverflow++;
+}
+
+static void FaultPrintCoord(const GeomCoord *Coord)
+{
+	xil_printf("rank %d bg %d bank %d row 0x%04x", Coord->Rank,
+		Coord->BankGroup, Coord->Bank, Coord->Row);
+}
+
+/*****************************************************************************/
+/**
+* Clear a log.
+*
+* @param	LogPtr is the log to clear
+* @param	Base is the bus address of the PL DDR4, offsets are decoded
+*		from it
+*
+* @return	None
+*
+******************************************************************************/
+void Fault_Init(FaultLog *LogPtr, UINTPTR Base)
+{
+	memset(LogPtr, 0, sizeof(*LogPtr));
+	LogPtr->Base = Base;
+}
+
+/*****************************************************************************/
+/**
+* Record one failing word.
+*
+* @param	LogPtr is the log
+* @param	Addr is the PL DDR4 bus address of the word, 8 byte aligned
+* @param	Expected is the data written
+* @param	Actual is the data read back
+*
+* @return	None
+*
+* @note		Safe to call from several CPUs, the log is locked.
+*
+******************************************************************************/
+void Fault_Record(FaultLog *LogPtr, UINTPTR Addr, u64 Expected, u64 Actual)
+{
+	u64 Offset = Addr - LogPtr->Base;
+	u64 Diff = Expected ^ Actual;
+	GeomCoord Coord;
+	u32 Bank;
+
+	Geom_Decode(Offset, &Coord);
+	Bank = Geom_BankIndex(&Coord);
+
+	Hal_SpinLock(&LogPtr->Lock);
+
+	LogPtr->Words++;
+	LogPtr->RankWords[Coord.Rank]++;
+	LogPtr->BankWords[Bank]++;
+	FaultRowAdd(LogPtr, ((Bank << GEOM_ROW_WIDTH) | Coord.Row) + 1U);
+
+	while (Diff) {
+		LogPtr->DqWords[__builtin_ctzll(Diff)]++;
+		LogPtr->Bits++;
+		Diff &= Diff - 1U;
+	}
+
+	if (LogPtr->NumRecords < FAULT_MAX_RECORDS) {
+		FaultRecord *RecordPtr = &LogPtr->Record[LogPtr->NumRecords++];
+
+		RecordPtr->Offset = Offset;
+		RecordPtr->Expected = Expected;
+		RecordPtr->Actual = Actual;
+		RecordPtr->Coord = Coord;
+	}
+
+	Hal_SpinUnlock(&LogPtr->Lock);
+}
+
+/*****************************************************************************/
+/**
+* Print where the failures of a log sit on the DIMM: per rank, per bank,
+* per DQ bit, the rows with most failures and the first failures in full.
+*
+* @param	LogPtr is the log
+*
+* @return	None
+*
+******************************************************************************/
+void Fault_PrintSummary(const FaultLog *LogPtr)
+{
+	u8 Listed[FAULT_ROW_SLOTS] = { 0 };
+	GeomCoord Coord;
+	u32 Rank;
+	u32 Group;
+	u32 Bank;
+	u32 Index;
+	u32 Top;
+	u32 Best;
+
+	xil_printf("\r\n--- Fault Summary --- \r\n");
+	if (LogPtr->Words == 0) {
+		xil_printf("  no failures recorded\r\n");
+		return;
+	}
+
+	xil_printf("  %lu bad words, %lu bad bits\r\n",
+		(unsigned long)LogPtr->Words, (unsigned long)LogPtr->Bits);
+
+	xil_printf("  bad words per bank\r\n");
+	for (Rank = 0; Rank < GEOM_RANKS; Rank++) {
+		xil_printf("  rank %d: %lu\r\n", Rank,
+			(unsigned long)LogPtr->RankWords[Rank]);
+		for (Group = 0; Group < GEOM_BANK_GROUPS; Group++) {
+			xil_printf("    bg %d:", Group);
+			for (Bank = 0; Bank < GEOM_BANKS_PER_GROUP; Bank++) {
+				xil_printf(" %10lu", (unsigned long)LogPtr->BankWords[
+					(Rank * GEOM_BANK_GROUPS + Group) *
+					GEOM_BANKS_PER_GROUP + Bank]);
+			}
+			xil_printf("\r\n");
+		}
+	}
+
+	xil_printf("  bad words per DQ bit\r\n ");
+	for (Index = 0; Index < 64U; Index++) {
+		if (LogPtr->DqWords[Index]) {
+			xil_printf(" DQ%d: %d", Index, LogPtr->DqWords[Index]);
+		}
+	}
+	xil_printf("\r\n");
+
+	xil_printf("  rows with most bad words\r\n");
+	for (Top = 0; Top < FAULT_TOP_ROWS; Top++) {
+		Best = FAULT_ROW_SLOTS;
+		for (Index = 0; Index < FAULT_ROW_SLOTS; Index++) {
+			if (LogPtr->Row[Index].Key && !Listed[Index] &&
+			    (Best == FAULT_ROW_SLOTS ||
+			     LogPtr->Row[Index].Words > LogPtr->Row[Best].Words)) {
+				Best = Index;
+			}
+		}
+		if (Best == FAULT_ROW_SLOTS) {
+			break;
+		}
+		Listed[Best] = 1;
+
+		Index = LogPtr->Row[Best].Key - 1U;
+		Coord.Row = Index & (GEOM_ROWS - 1U);
+		Index >>= GEOM_ROW_WIDTH;
+		Coord.Bank = (u8)(Index % GEOM_BANKS_PER_GROUP);
+		Coord.BankGroup = (u8)(Index / GEOM_BANKS_PER_GROUP %
+			GEOM_BANK_GROUPS);
+		Coord.Rank = (u8)(Index / GEOM_BANKS_PER_GROUP / GEOM_BANK_GROUPS);
+		xil_printf("    ");
+		FaultPrintCoord(&Coord);
+		xil_printf(": %d\r\n", LogPtr->Row[Best].Words);
+	}
+	if (LogPtr->RowOverflow) {
+		xil_printf("    %lu words in rows past the table\r\n",
+			(unsigned long)LogPtr->RowOverflow);
+	}
+
+	xil_printf("  first bad words\r\n");
+	for (Index = 0; Index < LogPtr->NumRecords; Index++) {
+		const FaultRecord *RecordPtr = &LogPtr->Record[Index];
+
+		xil_printf("    0x%lx ", LogPtr->Base + (UINTPTR)RecordPtr->Offset);
+		FaultPrintCoord(&RecordPtr->Coord);
+		xil_printf(" col 0x%03x: expected 0x%016lx read 0x%016lx\r\n",
+			RecordPtr->Coord.Column, RecordPtr->Expected,
+			RecordPtr->Actual);
+	}
+}
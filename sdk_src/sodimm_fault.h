@@ -0,0 +1,73 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_fault.h
+ *
+ * Failure recorder of the SODIMM tests.
+ *
+ * Every failing 64-bit word found by a compare is decoded into DRAM
+ * coordinates (sodimm_geometry.h) and added to fixed size tables:
+ *
+ * - per rank, and per bank of the whole DIMM
+ * - per DQ bit of the data bus
+ * - per row, in a small open addressing table. Rows that find no free slot
+ *   are only counted, so a flood of failures cannot slow the sweep down.
+ * - the first FAULT_MAX_RECORDS failures in full
+ *
+ * Nothing is allocated, a FaultLog is a fixed size structure and recording
+ * a failure costs a decode and a bounded table probe.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_FAULT_H
+#define SODIMM_FAULT_H
+
+#include "sodimm_geometry.h"
+
+/******************** Constant Definitions **********************************/
+
+#define FAULT_MAX_RECORDS	16U
+
+/* Distinct failing rows tracked, a power of two */
+#define FAULT_ROW_SLOTS		512U
+
+/* Slots probed before a row counts as overflow */
+#define FAULT_ROW_PROBES	16U
+
+/* Rows listed by Fault_PrintSummary */
+#define FAULT_TOP_ROWS		8U
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u64 Offset;		/* from the base of the PL DDR4 */
+	u64 Expected;
+	u64 Actual;
+	GeomCoord Coord;
+} FaultRecord;
+
+typedef struct {
+	u32 Key;		/* bank index << GEOM_ROW_WIDTH | row, plus 1 */
+	u32 Words;
+} FaultRow;
+
+typedef struct {
+	UINTPTR Base;		/* bus address of offset 0 */
+	volatile u32 Lock;	/* CPUs of the multi-core sweep share a log */
+	u64 Words;		/* failing 64-bit words */
+	u64 Bits;		/* failing bits */
+	u64 RankWords[GEOM_RANKS];
+	u64 BankWords[GEOM_NUM_BANKS];
+	u32 DqWords[64];	/* words in which each DQ bit failed */
+	u64 RowOverflow;	/* words of rows that found no slot */
+	u32 NumRecords;
+	FaultRecord Record[FAULT_MAX_RECORDS];
+	FaultRow Row[FAULT_ROW_SLOTS];
+} FaultLog;
+
+/************************** Function Prototypes ******************************/
+
+void Fault_Init(FaultLog *LogPtr, UINTPTR Base);
+void Fault_Record(FaultLog *LogPtr, UINTPTR Addr, u64 Expected, u64 Actual);
+void Fault_PrintSummary(const FaultLog *LogPtr);
+
+#endif /* SODIMM_FAULT_H */
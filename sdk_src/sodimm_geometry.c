@@ -0,0 +1,141 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_geometry.c
+ *
+ * MIG address mapping, see sodimm_geometry.h.
+ *
+ * GeomMap lists the fields of a PL DDR4 offset from bit 0 up. It follows
+ * the MIG ROW_COLUMN_BANK mapping, the default C0.DDR4_Mem_Add_Map that
+ * build.tcl leaves in place: {rank, row, column[9:3], bank, bank group,
+ * column[2:0], byte}. Consecutive bursts alternate bank groups, then banks,
+ * before the column moves on. Edit the table if build.tcl picks another
+ * mapping.
+ *
+ ****************************************************************************/
+#include "sodimm_geometry.h"
+
+/******************** Constant Definitions **********************************/
+
+#define GEOM_FIELD_BYTE		0U
+#define GEOM_FIELD_COLUMN	1U
+#define GEOM_FIELD_BG		2U
+#define GEOM_FIELD_BANK		3U
+#define GEOM_FIELD_ROW		4U
+#define GEOM_FIELD_RANK		5U
+
+/**************************** Type Definitions *******************************/
+
+/* Width bits of a coordinate, starting at bit Shift of that coordinate */
+typedef struct {
+	u8 Field;
+	u8 Shift;
+	u8 Width;
+} GeomField;
+
+/************************** Variable Definitions *****************************/
+
+static const GeomField GeomMap[] = {
+	{ GEOM_FIELD_BYTE, 0, GEOM_BYTE_WIDTH },
+	{ GEOM_FIELD_COLUMN, 0, 3 },
+	{ GEOM_FIELD_BG, 0, GEOM_BG_WIDTH },
+	{ GEOM_FIELD_BANK, 0, GEOM_BANK_WIDTH },
+	{ GEOM_FIELD_COLUMN, 3, GEOM_COL_WIDTH - 3 },
+	{ GEOM_FIELD_ROW, 0, GEOM_ROW_WIDTH },
+	{ GEOM_FIELD_RANK, 0, GEOM_RANK_WIDTH },
+};
+
+#define GEOM_MAP_FIELDS		(sizeof(GeomMap) / sizeof(GeomMap[0]))
+
+/*****************************************************************************/
+/**
+* Split a PL DDR4 offset into DRAM coordinates.
+*
+* @param	Offset is the byte offset from the base of the PL DDR4, bits
+*		above GEOM_ADDR_WIDTH are ignored like the MIG does
+* @param	Coord receives the coordinates
+*
+* @return	None
+*
+******************************************************************************/
+void Geom_Decode(u64 Offset, GeomCoord *Coord)
+{
+	u32 Value[GEOM_FIELD_RANK + 1] = { 0 };
+	u32 Index;
+
+	for (Index = 0; Index < GEOM_MAP_FIELDS; Index++) {
+		const GeomField *FieldPtr = &GeomMap[Index];
+
+		Value[FieldPtr->Field] |= (u32)(Offset &
+			((1ULL << FieldPtr->Width) - 1U)) << FieldPtr->Shift;
+		Offset >>= FieldPtr->Width;
+	}
+
+	Coord->Byte = (u8)Value[GEOM_FIELD_BYTE];
+	Coord->Column = (u16)Value[GEOM_FIELD_COLUMN];
+	Coord->BankGroup = (u8)Value[GEOM_FIELD_BG];
+	Coord->Bank = (u8)Value[GEOM_FIELD_BANK];
+	Coord->Row = Value[GEOM_FIELD_ROW];
+	Coord->Rank = (u8)Value[GEOM_FIELD_RANK];
+}
+
+/*****************************************************************************/
+/**
+* Inverse of Geom_Decode.
+*
+* @param	Coord holds the coordinates, each inside its width
+*
+* @return	Byte offset from the base of the PL DDR4
+*
+******************************************************************************/
+u64 Geom_Encode(const GeomCoord *Coord)
+{
+	u32 Value[GEOM_FIELD_RANK + 1];
+	u64 Offset = 0;
+	u32 Bit = 0;
+	u32 Index;
+
+	Value[GEOM_FIELD_BYTE] = Coord->Byte;
+	Value[GEOM_FIELD_COLUMN] = Coord->Column;
+	Value[GEOM_FIELD_BG] = Coord->BankGroup;
+	Value[GEOM_FIELD_BANK] = Coord->Bank;
+	Value[GEOM_FIELD_ROW] = Coord->Row;
+	Value[GEOM_FIELD_RANK] = Coord->Rank;
+
+	for (Index = 0; Index < GEOM_MAP_FIELDS; Index++) {
+		const GeomField *FieldPtr = &GeomMap[Index];
+
+		Offset |= (u64)((Value[FieldPtr->Field] >> FieldPtr->Shift) &
+			((1U << FieldPtr->Width) - 1U)) << Bit;
+		Bit += FieldPtr->Width;
+	}
+
+	return Offset;
+}
+
+/*****************************************************************************/
+/**
+* Largest aligned block of the PL DDR4 that stays in one row of one bank,
+* i.e. the longest access that is all row buffer hits.
+*
+* @param	None
+*
+* @return	Size of the block in bytes, one burst (64) with the
+*		ROW_COLUMN_BANK mapping
+*
+******************************************************************************/
+u32 Geom_RunBytes(void)
+{
+	u32 Bits = 0;
+	u32 Index;
+
+	for (Index = 0; Index < GEOM_MAP_FIELDS; Index++) {
+		if (GeomMap[Index].Field != GEOM_FIELD_BYTE &&
+		    GeomMap[Index].Field != GEOM_FIELD_COLUMN) {
+			break;
+		}
+		Bits += GeomMap[Index].Width;
+	}
+
+	return 1U << Bits;
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_geometry.h
+ *
+ * DRAM geometry of the SODIMM and the MIG address mapping.
+ *
+ * The widths below are those of DDR4_CUSTOM2 in
+ * sodimm-cfg-files/cfg-32gb.csv, the part build.tcl configures the MIG
+ * with. The MIG addresses the DIMM in units of its 64-bit data bus, so the
+ * low three bits of a PL DDR4 offset pick a byte inside a beat and the bits
+ * above them are split into rank, row, column, bank and bank group by the
+ * table in sodimm_geometry.c.
+ *
+ * The refresh timing of the same part sets how long the refresh hold test
+ * lets data age.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_GEOMETRY_H
+#define SODIMM_GEOMETRY_H
+
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+/* cfg-32gb.csv, DDR4_CUSTOM2 */
+#define GEOM_RANK_WIDTH		1U	/* Rank 2 */
+#define GEOM_ROW_WIDTH		16U
+#define GEOM_COL_WIDTH		10U
+#define GEOM_BANK_WIDTH		2U
+#define GEOM_BG_WIDTH		2U
+#define GEOM_BYTE_WIDTH		3U	/* Data widths 64 */
+
+#define GEOM_RANKS		(1U << GEOM_RANK_WIDTH)
+#define GEOM_BANK_GROUPS	(1U << GEOM_BG_WIDTH)
+#define GEOM_BANKS_PER_GROUP	(1U << GEOM_BANK_WIDTH)
+#define GEOM_ROWS		(1U << GEOM_ROW_WIDTH)
+#define GEOM_COLUMNS		(1U << GEOM_COL_WIDTH)
+
+/* Banks of the whole DIMM, over all ranks and bank groups */
+#define GEOM_NUM_BANKS		(GEOM_RANKS * GEOM_BANK_GROUPS * \
+				 GEOM_BANKS_PER_GROUP)
+
+/* Bytes the MIG can address, higher offset bits alias */
+#define GEOM_ADDR_WIDTH		(GEOM_RANK_WIDTH + GEOM_ROW_WIDTH + \
+				 GEOM_COL_WIDTH + GEOM_BANK_WIDTH + \
+				 GEOM_BG_WIDTH + GEOM_BYTE_WIDTH)
+
+/* Bytes of one row of one bank: a DRAM page over the 64-bit bus */
+#define GEOM_ROW_BYTES		(GEOM_COLUMNS << GEOM_BYTE_WIDTH)
+
+/* cfg-32gb.csv, DDR4_CUSTOM2 refresh timing */
+#define GEOM_TREFI_PS		7800000ULL	/* tREFI, between REF commands */
+#define GEOM_TRFC_PS		550000ULL	/* tRFC, one REF command */
+
+/* REF commands that refresh every row once, JEDEC DDR4 */
+#define GEOM_REFRESH_CMDS	8192U
+
+/* Refresh window: a row holds its data this long between two refreshes */
+#define GEOM_TREFW_PS		(GEOM_TREFI_PS * GEOM_REFRESH_CMDS)
+
+/**************************** Type Definitions *******************************/
+
+/* Position of one byte of the DIMM */
+typedef struct {
+	u32 Row;
+	u16 Column;
+	u8 Rank;
+	u8 BankGroup;
+	u8 Bank;		/* inside its bank group */
+	u8 Byte;		/* byte lane of the 64-bit bus */
+} GeomCoord;
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/* Index of the bank of Coord in [0, GEOM_NUM_BANKS) */
+static inline u32 Geom_BankIndex(const GeomCoord *Coord)
+{
+	return ((u32)Coord->Rank * GEOM_BANK_GROUPS + Coord->BankGroup) *
+		GEOM_BANKS_PER_GROUP + Coord->Bank;
+}
+
+/************************** Function Prototypes ******************************/
+
+void Geom_Decode(u64 Offset, GeomCoord *Coord);
+u64 Geom_Encode(const GeomCoord *Coord);
+u32 Geom_RunBytes(void);
+
+#endif /* SODIMM_GEOMETRY_H */
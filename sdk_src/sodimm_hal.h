@@ -0,0 +1,225 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_hal.h
+ *
+ * Hardware abstraction layer for the SODIMM tester.
+ *
+ * The test code in helloworld.c never touches the XAxiCdma driver, the cache
+ * maintenance calls or the raw bus addresses directly. It goes through the
+ * Hal_* functions declared here, which are implemented by one of two
+ * backends:
+ *
+ * - sodimm_hal_xil.c : the ZCU104 backend (AXI CDMA, OCM BD ring, Xil_*).
+ * - host_sim/sodimm_hal_sim.c : a Linux backend that models the BD ring, the
+ *   PS DDR / PL DDR4 / OCM address windows and a CDMA engine with a
+ *   configurable bandwidth and latency. Build with -DSODIMM_HOST_SIM.
+ *
+ * All buffer addresses handled by the test are bus addresses (UINTPTR) as
+ * seen by the CDMA. The CPU must use Hal_Ptr() to turn them into a pointer
+ * before dereferencing them.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_HAL_H
+#define SODIMM_HAL_H
+
+#ifdef SODIMM_HOST_SIM
+#include "sim_platform.h"
+#else
+#include "xaxicdma.h"
+#include "xdebug.h"
+#include "xil_cache.h"
+#include "xparameters.h"
+#include "xtime_l.h"
+#endif
+
+/******************** Constant Definitions **********************************/
+
+/* Hal_TimeNow() runs off the ARM global timer on the board and off
+ * CLOCK_MONOTONIC (in ns) on the host.
+ */
+#ifdef SODIMM_HOST_SIM
+#define HAL_TICKS_PER_SEC	1000000000ULL
+#else
+#define HAL_TICKS_PER_SEC	((u64)COUNTS_PER_SECOND)
+#endif
+
+/* Upper bound on the CPUs Hal_CpuRun can use. The board backend brings up
+ * HAL_NUM_CPUS of them, see sodimm_hal_xil.c.
+ */
+#define HAL_MAX_CPUS		4
+
+/* Upper bound on the CDMA engines of the design, see build.tcl --num_cdma.
+ * Engine n has Device Id XPAR_AXICDMA_0_DEVICE_ID + n and the OCM BD space
+ * is split evenly between the engines Hal_CdmaCount reports.
+ */
+#define HAL_MAX_CDMAS		4
+
+/* Bytes Hal_PersistStore keeps across a board reset. On the board they are
+ * the top of the PS DDR, which the linker script must leave out.
+ */
+#define HAL_PERSIST_SIZE	0x100000U
+
+/* Bytes of the result stream Hal_LogWrite keeps. On the board they are the
+ * PS DDR right below the persistent bytes, left out of the linker script
+ * with them.
+ */
+#define HAL_LOG_SIZE		0x8000000U
+
+/* CPU mappings of Hal_CpuMapRange */
+#define HAL_MAP_CACHED		0	/* normal memory, write-back cacheable */
+#define HAL_MAP_NONCACHED	1	/* normal memory, non-cacheable */
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+#define HAL_TICKS_TO_US(Ticks)	((u64)(Ticks) * 1000000ULL / HAL_TICKS_PER_SEC)
+
+/* Atomics and a spin lock shared by the CPUs of Hal_CpuRun. The data must
+ * live in cacheable memory on the board, exclusives do not work on device
+ * memory.
+ */
+static inline u32 Hal_AtomicFetchAdd(volatile u32 *Ptr, u32 Value)
+{
+	return __atomic_fetch_add(Ptr, Value, __ATOMIC_ACQ_REL);
+}
+
+static inline u32 Hal_AtomicLoad(volatile u32 *Ptr)
+{
+	return __atomic_load_n(Ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void Hal_AtomicStore(volatile u32 *Ptr, u32 Value)
+{
+	__atomic_store_n(Ptr, Value, __ATOMIC_RELEASE);
+}
+
+#ifdef SODIMM_HOST_SIM
+/* Sleeps while waiting, spinning threads would starve the CDMA model */
+void Hal_SpinLock(volatile u32 *Lock);
+#else
+static inline void Hal_SpinLock(volatile u32 *Lock)
+{
+	while (__atomic_exchange_n(Lock, 1, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(Lock, __ATOMIC_RELAXED)) {
+			/* Wait */
+		}
+	}
+}
+#endif
+
+static inline void Hal_SpinUnlock(volatile u32 *Lock)
+{
+	__atomic_store_n(Lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Wait until every store before it has completed, so a load after it is not
+ * served from the store buffer of the CPU. Needed to read back a store on
+ * normal memory, cacheable or not.
+ */
+static inline void Hal_MemBarrier(void)
+{
+#ifdef SODIMM_HOST_SIM
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+	__asm__ __volatile__("dsb sy" ::: "memory");
+#endif
+}
+
+/**************************** Type Definitions *******************************/
+
+/* Body run on every CPU by Hal_CpuRun, Cpu counts from 0 */
+typedef void (*HalCpuFn)(int Cpu, void *Arg);
+
+/* Completion callback of Hal_CdmaIntrEnable, run in interrupt context.
+ * BdCount is the number of BDs just reaped, or -1 on a transfer error.
+ */
+typedef void (*HalCdmaDoneFn)(void *Ref, int BdCount);
+
+/* Opaque handle for one CDMA engine and its BD ring. The layout is private
+ * to the backend.
+ */
+typedef struct HalCdma HalCdma;
+
+/* One scatter gather transfer, i.e. the contents of one BD.
+ */
+typedef struct {
+	UINTPTR SrcAddr;
+	UINTPTR DstAddr;
+	u32 Length;
+} HalXfer;
+
+/* Datapath of a CDMA engine, see build.tcl --cdma_data_width,
+ * --cdma_burst_len and --cdma_clk.
+ */
+typedef struct {
+	u32 DataWidth;		/* bits of the M_AXI data bus */
+	u32 BurstLen;		/* beats per burst at most */
+	u32 ClockMHz;		/* clock of M_AXI, 0 if unknown */
+} HalDatapath;
+
+/************************** Function Prototypes ******************************/
+
+HalCdma *Hal_CdmaInitialize(u16 DeviceId);
+int Hal_CdmaCount(void);
+void Hal_CdmaDatapath(HalCdma *InstancePtr, HalDatapath *PathPtr);
+int Hal_BdRingCreate(HalCdma *InstancePtr);
+int Hal_BdRingSubmit(HalCdma *InstancePtr, const HalXfer *XferPtr, int NumBd);
+int Hal_BdRingReap(HalCdma *InstancePtr);
+int Hal_CdmaReset(HalCdma *InstancePtr, int TimeOut);
+
+/* Persistent BD chains: the ring is built once as NumChains chains of NumBd
+ * BDs of Length bytes each, and every submit only patches the src/dst
+ * addresses of the next chain. Do not mix with Hal_BdRingSubmit on the
+ * same ring.
+ */
+int Hal_BdChainCreate(HalCdma *InstancePtr, int NumChains, int NumBd,
+		u32 Length);
+int Hal_BdChainSubmit(HalCdma *InstancePtr, UINTPTR SrcAddr, UINTPTR DstAddr);
+
+/* Interrupt driven completion with coalescing, see sodimm_hal_xil.c. While
+ * enabled the backend reaps in interrupt context and Hal_BdRingReap must not
+ * be called. Submits may come from any CPU, the backend serializes them
+ * with the reap. Hal_CdmaWaitIntr sleeps the calling CPU, any of those of
+ * Hal_CpuRun, until *Value != Seen.
+ */
+int Hal_CdmaIntrEnable(HalCdma *InstancePtr, u32 Threshold, u32 Delay,
+		HalCdmaDoneFn DoneFn, void *DoneRef);
+void Hal_CdmaIntrDisable(HalCdma *InstancePtr);
+void Hal_CdmaWaitIntr(HalCdma *InstancePtr, volatile int *Value, int Seen);
+
+void Hal_DCacheFlushRange(UINTPTR Addr, u64 Length);
+void Hal_DCacheInvalidateRange(UINTPTR Addr, u64 Length);
+void Hal_DCacheFlushAll(void);
+
+/* Change how the CPU maps a bus range, in the largest blocks the MMU tables
+ * of the backend allow. Returns the block size used.
+ */
+u64 Hal_CpuMapRange(UINTPTR Addr, u64 Length, int Map);
+
+u64 Hal_TimeNow(void);
+
+/* Wait at least Us microseconds with nothing else to do */
+void Hal_SleepUs(u64 Us);
+
+/* State that outlives the run, see HAL_PERSIST_SIZE. Hal_PersistLoad fails
+ * if nothing was stored yet; the caller checks what it gets back.
+ */
+int Hal_PersistStore(const void *Buf, u32 Length);
+int Hal_PersistLoad(void *Buf, u32 Length);
+
+/* Write Length bytes of the result stream at Offset, see HAL_LOG_SIZE */
+int Hal_LogWrite(u64 Offset, const void *Buf, u32 Length);
+
+/* Run Fn on NumCpus CPUs at once and return when all of them are done. The
+ * calling CPU runs Cpu 0.
+ */
+int Hal_CpuCount(void);
+void Hal_CpuRun(int NumCpus, HalCpuFn Fn, void *Arg);
+
+#ifdef SODIMM_HOST_SIM
+void *Hal_Ptr(UINTPTR Addr);
+#else
+#define Hal_Ptr(Addr)	((void *)(UINTPTR)(Addr))
+#endif
+
+#endif /* SODIMM_HAL_H */
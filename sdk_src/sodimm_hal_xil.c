@@ -0,0 +1,1250 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_hal_xil.c
+ *
+ * ZCU104 backend of the SODIMM tester HAL. This is a thin wrapper over the
+ * xaxicdma driver: the BD rings live in OCM, which is marked uncacheable, and
+ * the cache maintenance calls map straight onto Xil_DCache*.
+ *
+ * With several CDMA engines every engine gets an equal slice of the OCM for
+ * its ring and its own interrupt line into the GIC.
+ *
+ ****************************************************************************/
+#include "sodimm_hal.h"
+
+#include "xil_exception.h"
+#include "xil_io.h"
+#include "xscugic.h"
+#include "xenv.h"	/* memcpy */
+#include "sleep.h"
+
+#ifdef __aarch64__
+#include "xil_mmu.h"
+#endif
+
+/******************** Constant Definitions **********************************/
+
+#define BD_SPACE_BASE (XPAR_PSU_OCM_RAM_0_S_AXI_BASEADDR)
+#define BD_SPACE_HIGH (XPAR_PSU_OCM_RAM_0_S_AXI_HIGHADDR)
+
+#define MARK_UNCACHEABLE	0x701
+
+/* Top of the PS DDR, left out of the linker script. It keeps its contents
+ * across a reset of the APU or a re-run from the debugger, not across a
+ * power cycle.
+ */
+#define PERSIST_BASE	\
+	((UINTPTR)XPAR_PSU_DDR_0_S_AXI_HIGHADDR + 1 - HAL_PERSIST_SIZE)
+
+/* Result stream, dumped over JTAG with xsct mrd -bin */
+#define LOG_BASE	(PERSIST_BASE - HAL_LOG_SIZE)
+
+/* Block sizes of the standalone BSP translation tables: 2 MB level 2 blocks
+ * below 4 GB and 1 GB level 1 blocks above.
+ */
+#define MAP_BLOCK_LOW		0x200000ULL
+#define MAP_BLOCK_HIGH		0x40000000ULL
+#define MAP_LOW_LIMIT		0x100000000ULL
+
+#define INTC_DEVICE_ID		XPAR_SCUGIC_SINGLE_DEVICE_ID
+#define DMA_CTRL_IRPT_PRIORITY	0xA0
+#define DMA_CTRL_IRPT_TRIGGER	0x3	/* rising edge */
+
+/* Clock of the CDMA engines in MHz. Nothing in xparameters.h tells which
+ * clock build.tcl --cdma_clk picked: 100 for pl_clk0, 266 for the MIG ui_clk.
+ */
+#ifndef HAL_CDMA_CLK_MHZ
+#define HAL_CDMA_CLK_MHZ	100
+#endif
+
+/* A53 cores Hal_CpuRun uses. The standalone BSP only brings up the boot
+ * core, HalCpuStart starts the others the first time they are asked for.
+ * Set to 1 to run every CPU of Hal_CpuRun in turn on the boot core.
+ */
+#ifndef HAL_NUM_CPUS
+#ifdef __aarch64__
+#define HAL_NUM_CPUS		4
+#else
+#define HAL_NUM_CPUS		1
+#endif
+#endif
+
+#if HAL_NUM_CPUS > HAL_MAX_CPUS
+#error HAL_NUM_CPUS is above HAL_MAX_CPUS
+#endif
+
+#if HAL_NUM_CPUS > 1
+#ifndef __aarch64__
+#error The secondary cores are only brought up on the A53
+#endif
+
+#define HAL_CPU_STACK_SHIFT	14
+#define HAL_CPU_STACK_SIZE	(1U << HAL_CPU_STACK_SHIFT)	/* per core */
+#define HAL_CPU_START_US	10000U	/* per core to check in */
+#define HAL_CPU_BOOT_CLOSED	0x100U
+
+/* Release of a core from reset at EL3, see UG1087 APU and CRF_APB */
+#define APU_RVBARADDR_L(Cpu)	(0xFD5C0040U + 8U * (Cpu))
+#define APU_RVBARADDR_H(Cpu)	(0xFD5C0044U + 8U * (Cpu))
+#define CRF_APB_RST_FPD_APU	0xFD1A0104U
+#define RST_FPD_APU_ACPU_RESET(Cpu)		(1U << (Cpu))
+#define RST_FPD_APU_ACPU_PWRON_RESET(Cpu)	(1U << (10 + (Cpu)))
+
+/* PSCI 0.2 CPU_ON, SMC64 */
+#define PSCI_CPU_ON		0xC4000003ULL
+#define PSCI_SUCCESS		0ULL
+
+#define HAL_STR2(x)		#x
+#define HAL_STR(x)		HAL_STR2(x)
+#endif
+
+/**************************** Type Definitions *******************************/
+
+struct HalCdma {
+	XAxiCdma Cdma;
+	HalDatapath Datapath;
+	UINTPTR BdSpace;	/* OCM slice of this engine */
+	u32 BdSpaceLen;
+	int IntrConnected;	/* interrupt line hooked up to the GIC */
+	int ChainBds;		/* BDs per chain, 0 if no chains are built */
+	u32 ChainLength;	/* bytes per BD in a chain */
+	int IntrEnabled;	/* completions are reaped by HalCdmaSgCallBack */
+	HalCdmaDoneFn DoneFn;
+	void *DoneRef;
+	volatile u32 RingLock;	/* BD ring counters of the driver, see
+				   HalRingLock */
+};
+
+/************************** Variable Definitions *****************************/
+
+static HalCdma AxiCdmaInstance[HAL_MAX_CDMAS];	/* Instances of the XAxiCdma */
+
+/* GIC interrupt of each engine, in Device Id order */
+static const u16 HalCdmaIntr[HAL_MAX_CDMAS] = {
+	XPAR_FABRIC_AXICDMA_0_VEC_ID,
+#ifdef XPAR_FABRIC_AXICDMA_1_VEC_ID
+	XPAR_FABRIC_AXICDMA_1_VEC_ID,
+#endif
+#ifdef XPAR_FABRIC_AXICDMA_2_VEC_ID
+	XPAR_FABRIC_AXICDMA_2_VEC_ID,
+#endif
+#ifdef XPAR_FABRIC_AXICDMA_3_VEC_ID
+	XPAR_FABRIC_AXICDMA_3_VEC_ID,
+#endif
+};
+
+static XScuGic IntcInstance;	/* Instance of the interrupt controller */
+static int IntcReady;
+
+/************************** Function Prototypes ******************************/
+
+static void HalCdmaSgCallBack(void *CallBackRef, u32 IrqMask, int *NumBdPtr);
+
+#if HAL_NUM_CPUS > 1
+void HalCpuSecondaryEntry(void);
+void HalCpuSecondaryLoop(int Cpu);
+#endif
+
+/* Index of the calling core in the A53 cluster */
+static inline int HalCpuIndex(void)
+{
+#if HAL_NUM_CPUS > 1
+	u64 Mpidr;
+
+	__asm__ __volatile__("mrs %0, mpidr_el1" : "=r" (Mpidr));
+
+	return (int)(Mpidr & 0xFFU);
+#else
+	return 0;
+#endif
+}
+
+/* The xaxicdma driver keeps the BD counts of a ring without any locking.
+ * Completion interrupts only reach CPU 0 and reap there, while any core of
+ * Hal_CpuRun may submit, so every submit and reap takes the lock of the
+ * ring. Masking interrupts keeps CPU 0 from taking its own interrupt while
+ * it holds the lock.
+ */
+static inline void HalRingLock(HalCdma *InstancePtr)
+{
+	Xil_ExceptionDisable();
+	Hal_SpinLock(&InstancePtr->RingLock);
+}
+
+static inline void HalRingUnlock(HalCdma *InstancePtr)
+{
+	Hal_SpinUnlock(&InstancePtr->RingLock);
+	Xil_ExceptionEnable();
+}
+
+/*****************************************************************************/
+/**
+* Look up and initialize the CDMA engine.
+*
+* @param	DeviceId is the Device Id of the XAxiCdma instance
+*
+* @return	Pointer to the engine handle, or NULL if the device cannot be
+*		found or fails to initialize.
+*
+* @note		The OCM used for the BD rings is marked uncacheable here.
+*
+******************************************************************************/
+HalCdma *Hal_CdmaInitialize(u16 DeviceId)
+{
+	int Status;
+	XAxiCdma_Config *CfgPtr;
+	HalCdma *InstancePtr;
+	u32 Engine = DeviceId - XPAR_AXICDMA_0_DEVICE_ID;
+	u32 Slice;
+
+	if (Engine >= (u32)Hal_CdmaCount()) {
+		xdbg_printf(XDBG_DEBUG_ERROR,
+		    "Cannot find config structure for device %d\r\n",
+			DeviceId);
+
+		return NULL;
+	}
+	InstancePtr = &AxiCdmaInstance[Engine];
+
+#ifdef __aarch64__
+	Xil_SetTlbAttributes(BD_SPACE_BASE, MARK_UNCACHEABLE);
+#endif
+
+	CfgPtr = XAxiCdma_LookupConfig(DeviceId);
+	if (!CfgPtr) {
+		xdbg_printf(XDBG_DEBUG_ERROR,
+		    "Cannot find config structure for device %d\r\n",
+			DeviceId);
+
+		return NULL;
+	}
+
+	Status = XAxiCdma_CfgInitialize(&InstancePtr->Cdma, CfgPtr,
+		CfgPtr->BaseAddress);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR,
+		    "Initialization failed with %d\r\n", Status);
+
+		return NULL;
+	}
+
+	Slice = (BD_SPACE_HIGH - BD_SPACE_BASE + 1) / Hal_CdmaCount();
+	Slice &= ~(XAXICDMA_BD_MINIMUM_ALIGNMENT - 1U);
+	InstancePtr->BdSpace = BD_SPACE_BASE + (UINTPTR)Engine * Slice;
+	InstancePtr->BdSpaceLen = Slice;
+	InstancePtr->Datapath.DataWidth = CfgPtr->DataWidth;
+	InstancePtr->Datapath.BurstLen = CfgPtr->BurstLen;
+	InstancePtr->Datapath.ClockMHz = HAL_CDMA_CLK_MHZ;
+	InstancePtr->ChainBds = 0;
+	InstancePtr->IntrEnabled = 0;
+
+	return InstancePtr;
+}
+
+/* CDMA engines of the design, as exported to xparameters.h */
+int Hal_CdmaCount(void)
+{
+	return XPAR_XAXICDMA_NUM_INSTANCES < HAL_MAX_CDMAS ?
+		XPAR_XAXICDMA_NUM_INSTANCES : HAL_MAX_CDMAS;
+}
+
+/* Data width and burst length come from the engine config, the clock from
+ * HAL_CDMA_CLK_MHZ.
+ */
+void Hal_CdmaDatapath(HalCdma *InstancePtr, HalDatapath *PathPtr)
+{
+	*PathPtr = InstancePtr->Datapath;
+}
+
+/*****************************************************************************/
+/**
+* Create the BD ring over the OCM slice of the engine with interrupts
+* disabled.
+*
+* @param	InstancePtr is the engine handle.
+*
+* @return
+*		- XST_SUCCESS if the ring is ready for use
+*		- XST_FAILURE if error occurs
+*
+* @note		None
+*
+******************************************************************************/
+int Hal_BdRingCreate(HalCdma *InstancePtr)
+{
+	int Status;
+	XAxiCdma_Bd BdTemplate;
+	int BdCount;
+
+	XAxiCdma_IntrDisable(&InstancePtr->Cdma, XAXICDMA_XR_IRQ_ALL_MASK);
+	InstancePtr->IntrEnabled = 0;
+	InstancePtr->ChainBds = 0;
+
+	BdCount = XAxiCdma_BdRingCntCalc(XAXICDMA_BD_MINIMUM_ALIGNMENT,
+				    InstancePtr->BdSpaceLen, InstancePtr->BdSpace);
+
+	Status = XAxiCdma_BdRingCreate(&InstancePtr->Cdma, InstancePtr->BdSpace,
+		InstancePtr->BdSpace, XAXICDMA_BD_MINIMUM_ALIGNMENT, BdCount);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD ring failed %d\r\n",
+							 	Status);
+		return XST_FAILURE;
+	}
+
+	/* Setup a BD template to copy to every BD. */
+	XAxiCdma_BdClear(&BdTemplate);
+	Status = XAxiCdma_BdRingClone(&InstancePtr->Cdma, &BdTemplate);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Clone BD ring failed %d\r\n",
+				Status);
+
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Allocate NumBd BDs, fill them from XferPtr and give them to hardware.
+*
+* @param	InstancePtr is the engine handle.
+* @param	XferPtr is an array of NumBd transfers.
+* @param	NumBd is the number of BDs to submit.
+*
+* @return
+*		- XST_SUCCESS if the DMA accepts all the BDs
+*		- XST_FAILURE if error occurs
+*
+* @note		The caller holds the ring lock, see HalRingLock.
+*
+******************************************************************************/
+static int HalBdRingSubmit(HalCdma *InstancePtr, const HalXfer *XferPtr,
+		int NumBd)
+{
+	XAxiCdma_Bd *BdPtr;
+	XAxiCdma_Bd *BdCurPtr;
+	int Status;
+	int Index;
+
+	Status = XAxiCdma_BdRingAlloc(&InstancePtr->Cdma, NumBd, &BdPtr);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Failed bd alloc\r\n");
+
+		return XST_FAILURE;
+	}
+
+	BdCurPtr = BdPtr;
+	for (Index = 0; Index < NumBd; Index++) {
+		Status = XAxiCdma_BdSetSrcBufAddr(BdCurPtr, XferPtr[Index].SrcAddr);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR,
+			    "Set src addr failed %d, %x/%x\r\n",
+			    Status, (unsigned int)(UINTPTR)BdCurPtr,
+			    (unsigned int)XferPtr[Index].SrcAddr);
+
+			return XST_FAILURE;
+		}
+
+		Status = XAxiCdma_BdSetDstBufAddr(BdCurPtr, XferPtr[Index].DstAddr);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR,
+			    "Set dst addr failed %d, %x/%x\r\n",
+			    Status, (unsigned int)(UINTPTR)BdCurPtr,
+			    (unsigned int)XferPtr[Index].DstAddr);
+
+			return XST_FAILURE;
+		}
+
+		Status = XAxiCdma_BdSetLength(BdCurPtr, XferPtr[Index].Length);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR,
+			    "Set BD length failed %d\r\n", Status);
+
+			return XST_FAILURE;
+		}
+
+		BdCurPtr = XAxiCdma_BdRingNext(&InstancePtr->Cdma, BdCurPtr);
+	}
+
+	/* Give the BDs to hardware */
+	Status = XAxiCdma_BdRingToHw(&InstancePtr->Cdma, NumBd, BdPtr,
+		InstancePtr->IntrEnabled ? HalCdmaSgCallBack : NULL, InstancePtr);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Failed to hw %d\r\n", Status);
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+int Hal_BdRingSubmit(HalCdma *InstancePtr, const HalXfer *XferPtr, int NumBd)
+{
+	int Status;
+
+	HalRingLock(InstancePtr);
+	Status = HalBdRingSubmit(InstancePtr, XferPtr, NumBd);
+	HalRingUnlock(InstancePtr);
+
+	return Status;
+}
+
+/*****************************************************************************/
+/**
+* Collect the BDs the hardware has finished, check them and release them.
+*
+* @param	InstancePtr is the engine handle.
+*
+* @return	Number of BDs completed since the last call, or -1 if the
+*		engine or any of the completed BDs reports an error.
+*
+* @note		The caller holds the ring lock, see HalRingLock.
+*
+******************************************************************************/
+static int HalBdRingReap(HalCdma *InstancePtr)
+{
+	int BdCount;
+	XAxiCdma_Bd *BdPtr;
+	XAxiCdma_Bd *BdCurPtr;
+	int Status;
+	int Index;
+
+	/* In some error cases, the DMA engine may not able to update the
+	 * BD that has caused the problem.
+	 */
+	if (XAxiCdma_GetError(&InstancePtr->Cdma) != 0x0) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Transfer error %x\r\n",
+		    (unsigned int)XAxiCdma_GetError(&InstancePtr->Cdma));
+
+		return -1;
+	}
+
+	BdCount = XAxiCdma_BdRingFromHw(&InstancePtr->Cdma, XAXICDMA_ALL_BDS,
+		&BdPtr);
+	if (BdCount <= 0) {
+		return 0;
+	}
+
+	BdCurPtr = BdPtr;
+	for (Index = 0; Index < BdCount; Index++) {
+		if (XAxiCdma_BdGetSts(BdCurPtr) & XAXICDMA_BD_STS_ALL_ERR_MASK) {
+			return -1;
+		}
+
+		BdCurPtr = XAxiCdma_BdRingNext(&InstancePtr->Cdma, BdCurPtr);
+	}
+
+	/* Release the BDs so later submission can use them */
+	Status = XAxiCdma_BdRingFree(&InstancePtr->Cdma, BdCount, BdPtr);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Error free BD %x\r\n", Status);
+
+		return -1;
+	}
+
+	return BdCount;
+}
+
+int Hal_BdRingReap(HalCdma *InstancePtr)
+{
+	int BdCount;
+
+	HalRingLock(InstancePtr);
+	BdCount = HalBdRingReap(InstancePtr);
+	HalRingUnlock(InstancePtr);
+
+	return BdCount;
+}
+
+/*****************************************************************************/
+/**
+* Build the BD ring as NumChains chains of NumBd BDs. The ring holds exactly
+* NumChains * NumBd BDs, so every allocation of NumBd BDs returns the next
+* chain and the length written here stays in place for the whole session.
+*
+* @param	InstancePtr is the engine handle.
+* @param	NumChains is the number of chains that can be in flight.
+* @param	NumBd is the number of BDs in each chain.
+* @param	Length is the transfer length of every BD.
+*
+* @return
+*		- XST_SUCCESS if the ring is ready for use
+*		- XST_FAILURE if it does not fit in the BD space or error occurs
+*
+* @note		None
+*
+******************************************************************************/
+int Hal_BdChainCreate(HalCdma *InstancePtr, int NumChains, int NumBd,
+		u32 Length)
+{
+	int Status;
+	XAxiCdma_Bd BdTemplate;
+	XAxiCdma_Bd *BdCurPtr;
+	int BdCount = NumChains * NumBd;
+	int Index;
+
+	XAxiCdma_IntrDisable(&InstancePtr->Cdma, XAXICDMA_XR_IRQ_ALL_MASK);
+	InstancePtr->IntrEnabled = 0;
+	InstancePtr->ChainBds = 0;
+
+	if (XAxiCdma_BdRingMemCalc(XAXICDMA_BD_MINIMUM_ALIGNMENT, BdCount) >
+	    InstancePtr->BdSpaceLen) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "%d BDs do not fit in OCM\r\n",
+				BdCount);
+		return XST_FAILURE;
+	}
+
+	Status = XAxiCdma_BdRingCreate(&InstancePtr->Cdma, InstancePtr->BdSpace,
+		InstancePtr->BdSpace, XAXICDMA_BD_MINIMUM_ALIGNMENT, BdCount);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Create BD ring failed %d\r\n",
+							 	Status);
+		return XST_FAILURE;
+	}
+
+	XAxiCdma_BdClear(&BdTemplate);
+	Status = XAxiCdma_BdRingClone(&InstancePtr->Cdma, &BdTemplate);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Clone BD ring failed %d\r\n",
+				Status);
+
+		return XST_FAILURE;
+	}
+
+	/* The length is the same for every BD of every batch, write it once */
+	BdCurPtr = (XAxiCdma_Bd *)InstancePtr->BdSpace;
+	for (Index = 0; Index < BdCount; Index++) {
+		Status = XAxiCdma_BdSetLength(BdCurPtr, Length);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR,
+			    "Set BD length failed %d\r\n", Status);
+
+			return XST_FAILURE;
+		}
+
+		BdCurPtr = XAxiCdma_BdRingNext(&InstancePtr->Cdma, BdCurPtr);
+	}
+
+	InstancePtr->ChainBds = NumBd;
+	InstancePtr->ChainLength = Length;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Patch the addresses of the next chain and give it to hardware. BD n of the
+* chain copies ChainLength bytes at SrcAddr + n * ChainLength.
+*
+* @param	InstancePtr is the engine handle.
+* @param	SrcAddr is the bus address the chain reads from.
+* @param	DstAddr is the bus address the chain writes to.
+*
+* @return
+*		- XST_SUCCESS if the DMA accepts the chain
+*		- XST_FAILURE if no chain is free or error occurs
+*
+* @note		None
+*
+******************************************************************************/
+int Hal_BdChainSubmit(HalCdma *InstancePtr, UINTPTR SrcAddr, UINTPTR DstAddr)
+{
+	XAxiCdma_Bd *BdPtr;
+	XAxiCdma_Bd *BdCurPtr;
+	int Status;
+	int Index;
+
+	if (InstancePtr->ChainBds == 0) {
+		return XST_FAILURE;
+	}
+
+	HalRingLock(InstancePtr);
+	Status = XAxiCdma_BdRingAlloc(&InstancePtr->Cdma, InstancePtr->ChainBds,
+		&BdPtr);
+	if (Status != XST_SUCCESS) {
+		HalRingUnlock(InstancePtr);
+		xdbg_printf(XDBG_DEBUG_ERROR, "Failed bd alloc\r\n");
+
+		return XST_FAILURE;
+	}
+
+	BdCurPtr = BdPtr;
+	for (Index = 0; Index < InstancePtr->ChainBds; Index++) {
+		XAxiCdma_BdSetSrcBufAddr(BdCurPtr, SrcAddr);
+		XAxiCdma_BdSetDstBufAddr(BdCurPtr, DstAddr);
+
+		SrcAddr += InstancePtr->ChainLength;
+		DstAddr += InstancePtr->ChainLength;
+		BdCurPtr = XAxiCdma_BdRingNext(&InstancePtr->Cdma, BdCurPtr);
+	}
+
+	Status = XAxiCdma_BdRingToHw(&InstancePtr->Cdma, InstancePtr->ChainBds,
+		BdPtr, InstancePtr->IntrEnabled ? HalCdmaSgCallBack : NULL,
+		InstancePtr);
+	HalRingUnlock(InstancePtr);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Failed to hw %d\r\n", Status);
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Reset the engine and wait for the reset to finish.
+*
+* @param	InstancePtr is the engine handle.
+* @param	TimeOut is the number of times to check that reset is done.
+*
+* @return
+*		- XST_SUCCESS if the reset completed
+*		- XST_FAILURE if it did not complete within TimeOut checks
+*
+* @note		None
+*
+******************************************************************************/
+int Hal_CdmaReset(HalCdma *InstancePtr, int TimeOut)
+{
+	XAxiCdma_Reset(&InstancePtr->Cdma);
+
+	while (TimeOut) {
+		if (XAxiCdma_ResetIsDone(&InstancePtr->Cdma)) {
+			return XST_SUCCESS;
+		}
+		TimeOut -= 1;
+	}
+
+	return XST_FAILURE;
+}
+
+/*****************************************************************************/
+/**
+* Completion callback of the xaxicdma driver, called from
+* XAxiCdma_IntrHandler. It reaps everything the engine has finished and
+* passes the count on to the DoneFn given to Hal_CdmaIntrEnable.
+*
+* @param	CallBackRef is the engine handle.
+* @param	IrqMask is the interrupt mask the driver saw.
+* @param	NumBdPtr is the number of BDs the driver thinks are done. It
+*		is not used, the reap collects every finished BD in one go.
+*
+* @return	None
+*
+******************************************************************************/
+static void HalCdmaSgCallBack(void *CallBackRef, u32 IrqMask, int *NumBdPtr)
+{
+	HalCdma *InstancePtr = (HalCdma *)CallBackRef;
+	int BdCount;
+
+	(void)NumBdPtr;
+
+	if (IrqMask & XAXICDMA_XR_IRQ_ERROR_MASK) {
+		InstancePtr->DoneFn(InstancePtr->DoneRef, -1);
+	} else {
+		/* Interrupts are masked here, only the lock is left to take */
+		Hal_SpinLock(&InstancePtr->RingLock);
+		BdCount = HalBdRingReap(InstancePtr);
+		Hal_SpinUnlock(&InstancePtr->RingLock);
+		if (BdCount != 0) {
+			InstancePtr->DoneFn(InstancePtr->DoneRef, BdCount);
+		}
+	}
+
+	/* Wake the secondary cores in Hal_CdmaWaitIntr */
+	__asm__ __volatile__("dsb sy\n\tsev" ::: "memory");
+}
+
+/*****************************************************************************/
+/**
+* Hook the interrupt of an engine up to the GIC, bringing the GIC up first
+* if no engine did yet. Only done once per engine, the connection stays in
+* place across ring rebuilds.
+*
+* @param	InstancePtr is the engine handle.
+*
+* @return
+*		- XST_SUCCESS if the interrupt is connected
+*		- XST_FAILURE if error occurs
+*
+* @note		None
+*
+******************************************************************************/
+static int HalIntcSetup(HalCdma *InstancePtr)
+{
+	XScuGic_Config *IntcConfig;
+	u16 IntrId = HalCdmaIntr[InstancePtr - AxiCdmaInstance];
+	int Status;
+
+	if (!IntcReady) {
+		IntcConfig = XScuGic_LookupConfig(INTC_DEVICE_ID);
+		if (IntcConfig == NULL) {
+			return XST_FAILURE;
+		}
+
+		Status = XScuGic_CfgInitialize(&IntcInstance, IntcConfig,
+			IntcConfig->CpuBaseAddress);
+		if (Status != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		Xil_ExceptionInit();
+		Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+			(Xil_ExceptionHandler)XScuGic_InterruptHandler,
+			&IntcInstance);
+		Xil_ExceptionEnable();
+
+		IntcReady = 1;
+	}
+
+	XScuGic_SetPriorityTriggerType(&IntcInstance, IntrId,
+		DMA_CTRL_IRPT_PRIORITY, DMA_CTRL_IRPT_TRIGGER);
+
+	Status = XScuGic_Connect(&IntcInstance, IntrId,
+		(Xil_InterruptHandler)XAxiCdma_IntrHandler,
+		&InstancePtr->Cdma);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	XScuGic_Enable(&IntcInstance, IntrId);
+	InstancePtr->IntrConnected = 1;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Switch the engine to interrupt driven completion with interrupt
+* coalescing. From the next submit on, finished BDs are reaped in interrupt
+* context and reported to DoneFn, and Hal_BdRingReap must not be called.
+*
+* @param	InstancePtr is the engine handle.
+* @param	Threshold is the number of completed BDs per interrupt, 1-255.
+* @param	Delay is the idle time after the last completion before a
+*		partial count is flushed, in units of 125 AXI clocks. 0 turns
+*		the delay timer off.
+* @param	DoneFn is called with the BD count of every reap, or -1 on a
+*		transfer error.
+* @param	DoneRef is passed to DoneFn.
+*
+* @return
+*		- XST_SUCCESS if interrupts are on
+*		- XST_FAILURE if error occurs
+*
+* @note		Hal_BdRingCreate and Hal_BdChainCreate switch back to
+*		polling.
+*
+******************************************************************************/
+int Hal_CdmaIntrEnable(HalCdma *InstancePtr, u32 Threshold, u32 Delay,
+		HalCdmaDoneFn DoneFn, void *DoneRef)
+{
+	int Status;
+
+	if (!InstancePtr->IntrConnected) {
+		Status = HalIntcSetup(InstancePtr);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR,
+			    "Interrupt setup failed %d\r\n", Status);
+			return XST_FAILURE;
+		}
+	}
+
+	Status = XAxiCdma_SetCoalesce(&InstancePtr->Cdma, Threshold, Delay);
+	if (Status != XST_SUCCESS) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Set coalesce failed %d\r\n",
+				Status);
+		return XST_FAILURE;
+	}
+
+	InstancePtr->DoneFn = DoneFn;
+	InstancePtr->DoneRef = DoneRef;
+	InstancePtr->IntrEnabled = 1;
+	XAxiCdma_IntrEnable(&InstancePtr->Cdma, XAXICDMA_XR_IRQ_ALL_MASK);
+
+	return XST_SUCCESS;
+}
+
+void Hal_CdmaIntrDisable(HalCdma *InstancePtr)
+{
+	XAxiCdma_IntrDisable(&InstancePtr->Cdma, XAXICDMA_XR_IRQ_ALL_MASK);
+	InstancePtr->IntrEnabled = 0;
+}
+
+/*****************************************************************************/
+/**
+* Sleep until the completion handler changes *Value from Seen. The check and
+* the wfi run with IRQs masked so an interrupt between the two still wakes
+* the core. The GIC only routes the CDMA interrupts to the boot core, the
+* others wait in wfe for the sev HalCdmaSgCallBack sends after the DoneFn.
+*
+* @param	InstancePtr is the engine handle.
+* @param	Value is updated by the DoneFn.
+* @param	Seen is the value read before deciding to wait.
+*
+* @return	None
+*
+******************************************************************************/
+void Hal_CdmaWaitIntr(HalCdma *InstancePtr, volatile int *Value, int Seen)
+{
+	(void)InstancePtr;
+
+	if (HalCpuIndex() != 0) {
+		while (*Value == Seen) {
+			__asm__ __volatile__("wfe" ::: "memory");
+		}
+		return;
+	}
+
+	Xil_ExceptionDisable();
+	while (*Value == Seen) {
+		__asm__ __volatile__("dsb sy\n\twfi" ::: "memory");
+		Xil_ExceptionEnable();
+		Xil_ExceptionDisable();
+	}
+	Xil_ExceptionEnable();
+}
+
+void Hal_DCacheFlushRange(UINTPTR Addr, u64 Length)
+{
+	Xil_DCacheFlushRange(Addr, Length);
+}
+
+void Hal_DCacheInvalidateRange(UINTPTR Addr, u64 Length)
+{
+	Xil_DCacheInvalidateRange(Addr, Length);
+}
+
+void Hal_DCacheFlushAll(void)
+{
+	Xil_DCacheFlush();
+}
+
+/*****************************************************************************/
+/**
+* Remap a bus range for the CPU with Xil_SetTlbAttributes, one translation
+* table block at a time.
+*
+* @param	Addr is the first bus address, rounded down to a block
+* @param	Length is the number of bytes, rounded up to whole blocks
+* @param	Map is HAL_MAP_CACHED or HAL_MAP_NONCACHED
+*
+* @return	Size of the blocks used, 0 if the mapping was not changed
+*
+* @note		Xil_SetTlbAttributes cleans the whole data cache and
+*		invalidates the TLB on every call, so this is for setup, not
+*		for the test loops. Blocks above 4 GB are 1 GB.
+*
+******************************************************************************/
+u64 Hal_CpuMapRange(UINTPTR Addr, u64 Length, int Map)
+{
+#ifdef __aarch64__
+	u64 Attr = (Map == HAL_MAP_CACHED) ? NORM_WB_CACHE : NORM_NONCACHE;
+	u64 Block = (Addr < MAP_LOW_LIMIT) ? MAP_BLOCK_LOW : MAP_BLOCK_HIGH;
+	UINTPTR End = Addr + Length;
+
+	for (Addr &= ~(UINTPTR)(Block - 1); Addr < End; Addr += Block) {
+		Xil_SetTlbAttributes(Addr, Attr);
+	}
+
+	return Block;
+#else
+	(void)Addr;
+	(void)Length;
+	(void)Map;
+
+	return 0;
+#endif
+}
+
+u64 Hal_TimeNow(void)
+{
+	XTime Now;
+
+	XTime_GetTime(&Now);
+
+	return (u64)Now;
+}
+
+void Hal_SleepUs(u64 Us)
+{
+	/* usleep of the BSP waits on the global timer */
+	while (Us > 1000000ULL) {
+		usleep(1000000UL);
+		Us -= 1000000ULL;
+	}
+	usleep((unsigned long)Us);
+}
+
+/*****************************************************************************/
+/**
+* Copy state into the reserved top of the PS DDR and push it out of the
+* data cache, so a reset does not lose it.
+*
+* @param	Buf is the state
+* @param	Length is its size, at most HAL_PERSIST_SIZE
+*
+* @return	XST_SUCCESS, or XST_FAILURE if it does not fit
+*
+******************************************************************************/
+int Hal_PersistStore(const void *Buf, u32 Length)
+{
+	if (Length > HAL_PERSIST_SIZE) {
+		return XST_FAILURE;
+	}
+
+	memcpy(Hal_Ptr(PERSIST_BASE), Buf, Length);
+	Xil_DCacheFlushRange(PERSIST_BASE, Length);
+
+	return XST_SUCCESS;
+}
+
+/* Whatever the reserved region holds, power-on garbage included */
+int Hal_PersistLoad(void *Buf, u32 Length)
+{
+	if (Length > HAL_PERSIST_SIZE) {
+		return XST_FAILURE;
+	}
+
+	Xil_DCacheInvalidateRange(PERSIST_BASE, Length);
+	memcpy(Buf, Hal_Ptr(PERSIST_BASE), Length);
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Copy part of the result stream into its reserved region of the PS DDR and
+* push it out of the data cache, so a JTAG dump sees it.
+*
+* @param	Offset is the byte offset in the stream
+* @param	Buf is the data
+* @param	Length is its size
+*
+* @return	XST_SUCCESS, or XST_FAILURE past HAL_LOG_SIZE
+*
+******************************************************************************/
+int Hal_LogWrite(u64 Offset, const void *Buf, u32 Length)
+{
+	if (Offset > HAL_LOG_SIZE || Length > HAL_LOG_SIZE - Offset) {
+		return XST_FAILURE;
+	}
+
+	memcpy(Hal_Ptr(LOG_BASE + (UINTPTR)Offset), Buf, Length);
+	Xil_DCacheFlushRange(LOG_BASE + (UINTPTR)Offset, Length);
+
+	return XST_SUCCESS;
+}
+
+#if HAL_NUM_CPUS > 1
+/* Work handed to the secondary cores. They live in the same image and
+ * spin on Seq, so this must be in memory all cores map as cacheable.
+ */
+static struct {
+	volatile u32 Seq;
+	volatile u32 Pending;
+	volatile u32 NumCpus;
+	HalCpuFn Fn;
+	void *Arg;
+} HalCpuJob;
+
+/* Translation setup of the boot core, copied by HalCpuSecondaryEntry. The
+ * secondaries read it with the MMU off, so it is flushed to memory first.
+ * The offsets are used by the assembly.
+ */
+static struct {
+	u64 Mair;	/* 0 */
+	u64 Tcr;	/* 8 */
+	u64 Ttbr0;	/* 16 */
+	u64 Vbar;	/* 24 */
+	u64 Sctlr;	/* 32 */
+} HalCpuBoot __attribute__((aligned(64), used));
+
+/* Stacks of the secondary cores, core n runs on HalCpuStack[n] */
+static u8 HalCpuStack[HAL_NUM_CPUS][HAL_CPU_STACK_SIZE]
+	__attribute__((aligned(16), used));
+
+/* Cores in HalCpuSecondaryLoop plus the boot core, and HAL_CPU_BOOT_CLOSED
+ * once HalCpuStart gave up waiting on one.
+ */
+static volatile u32 HalCpuOnline = 1;
+static int HalCpuStarted;
+
+/*****************************************************************************/
+/*
+* Reset entry of the secondary cores, at EL3 after the release from reset or
+* at EL1 after PSCI CPU_ON. Sets up the stack of the core, the translation
+* tables, vectors and SCTLR of the boot core and enters HalCpuSecondaryLoop.
+* The A53 invalidates its caches and TLBs on reset, SMPEN joins the core to
+* the coherency domain before the caches go on.
+*
+******************************************************************************/
+__asm__(
+	"	.section .text.HalCpuSecondaryEntry, \"ax\"\n"
+	"	.balign 64\n"
+	"	.global HalCpuSecondaryEntry\n"
+	"HalCpuSecondaryEntry:\n"
+	"	mrs	x19, mpidr_el1\n"
+	"	and	x19, x19, #0xff\n"
+	"	ldr	x1, =HalCpuStack\n"
+	"	add	x2, x19, #1\n"
+	"	lsl	x2, x2, #" HAL_STR(HAL_CPU_STACK_SHIFT) "\n"
+	"	add	x1, x1, x2\n"
+	"	mov	sp, x1\n"
+	"	ldr	x5, =HalCpuBoot\n"
+	"	mrs	x3, CurrentEL\n"
+	"	cmp	x3, #0xc\n"
+	"	b.ne	1f\n"
+	"	mrs	x4, S3_1_C15_C2_1\n"	/* CPUECTLR_EL1 */
+	"	orr	x4, x4, #(1 << 6)\n"	/* SMPEN */
+	"	msr	S3_1_C15_C2_1, x4\n"
+	"	isb\n"
+	"	ldr	x4, [x5, #0]\n"
+	"	msr	mair_el3, x4\n"
+	"	ldr	x4, [x5, #8]\n"
+	"	msr	tcr_el3, x4\n"
+	"	ldr	x4, [x5, #16]\n"
+	"	msr	ttbr0_el3, x4\n"
+	"	ldr	x4, [x5, #24]\n"
+	"	msr	vbar_el3, x4\n"
+	"	tlbi	alle3\n"
+	"	dsb	sy\n"
+	"	isb\n"
+	"	ldr	x4, [x5, #32]\n"
+	"	msr	sctlr_el3, x4\n"
+	"	isb\n"
+	"	b	2f\n"
+	"1:	ldr	x4, [x5, #0]\n"
+	"	msr	mair_el1, x4\n"
+	"	ldr	x4, [x5, #8]\n"
+	"	msr	tcr_el1, x4\n"
+	"	ldr	x4, [x5, #16]\n"
+	"	msr	ttbr0_el1, x4\n"
+	"	ldr	x4, [x5, #24]\n"
+	"	msr	vbar_el1, x4\n"
+	"	tlbi	vmalle1\n"
+	"	dsb	sy\n"
+	"	isb\n"
+	"	ldr	x4, [x5, #32]\n"
+	"	msr	sctlr_el1, x4\n"
+	"	isb\n"
+	"2:	mov	x0, x19\n"
+	"	bl	HalCpuSecondaryLoop\n"
+	"3:	wfe\n"
+	"	b	3b\n"
+	"	.ltorg\n"
+	"	.text\n");
+
+/* Exception level the image runs at, 3 for the standalone BSP default and
+ * 1 under the ATF.
+ */
+static u32 HalCpuEl(void)
+{
+	u64 El;
+
+	__asm__ __volatile__("mrs %0, CurrentEL" : "=r" (El));
+
+	return (u32)(El >> 2) & 3U;
+}
+
+/* Drop the TLB entries of this core, after the boot core changed the
+ * shared tables with Hal_CpuMapRange.
+ */
+static void HalCpuTlbInvalidate(void)
+{
+	if (HalCpuEl() == 3U) {
+		__asm__ __volatile__("tlbi alle3\n\tdsb sy\n\tisb" ::: "memory");
+	} else {
+		__asm__ __volatile__("tlbi vmalle1\n\tdsb sy\n\tisb" ::: "memory");
+	}
+}
+
+/*****************************************************************************/
+/**
+* Entry of the secondary cores once HalCpuSecondaryEntry has set up their
+* stack, MMU and caches: check in with HalCpuStart, then wait for
+* Hal_CpuRun and run the posted job.
+*
+* @param	Cpu is the index of this core, 1 to HAL_NUM_CPUS - 1
+*
+* @return	Does not return
+*
+******************************************************************************/
+void HalCpuSecondaryLoop(int Cpu)
+{
+	u32 Expected = (u32)Cpu;
+	u32 Seen;
+
+	/* Only the core HalCpuStart is waiting for may join */
+	if (!__atomic_compare_exchange_n(&HalCpuOnline, &Expected, Cpu + 1,
+			0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		while (1) {
+			__asm__ __volatile__("wfe");
+		}
+	}
+	Seen = Hal_AtomicLoad(&HalCpuJob.Seq);
+
+	while (1) {
+		while (Hal_AtomicLoad(&HalCpuJob.Seq) == Seen) {
+			__asm__ __volatile__("wfe");
+		}
+		Seen = Hal_AtomicLoad(&HalCpuJob.Seq);
+
+		if (Cpu < (int)HalCpuJob.NumCpus) {
+			HalCpuTlbInvalidate();
+			HalCpuJob.Fn(Cpu, HalCpuJob.Arg);
+		}
+		Hal_AtomicFetchAdd(&HalCpuJob.Pending, (u32)-1);
+	}
+}
+
+/*****************************************************************************/
+/*
+* Start secondary core Cpu at HalCpuSecondaryEntry. At EL3 there is no
+* firmware to ask, so the reset vector of the core is pointed at the entry
+* and the core is released from reset. At EL1 the ATF does it on PSCI
+* CPU_ON.
+*
+* @param	Cpu is the index of the core, 1 to HAL_NUM_CPUS - 1
+*
+* @return	XST_SUCCESS if the core was started, XST_FAILURE otherwise
+*
+******************************************************************************/
+static int HalCpuPowerOn(int Cpu)
+{
+	register u64 X0 __asm__("x0") = PSCI_CPU_ON;
+	register u64 X1 __asm__("x1") = (u64)Cpu;	/* MPIDR, cluster 0 */
+	register u64 X2 __asm__("x2") = (u64)(UINTPTR)HalCpuSecondaryEntry;
+	register u64 X3 __asm__("x3") = 0;
+	u64 Entry = (u64)(UINTPTR)HalCpuSecondaryEntry;
+
+	if (HalCpuEl() == 3U) {
+		Xil_Out32(APU_RVBARADDR_L(Cpu), (u32)Entry);
+		Xil_Out32(APU_RVBARADDR_H(Cpu), (u32)(Entry >> 32));
+		__asm__ __volatile__("dsb sy" ::: "memory");
+		Xil_Out32(CRF_APB_RST_FPD_APU, Xil_In32(CRF_APB_RST_FPD_APU) &
+			~(RST_FPD_APU_ACPU_RESET(Cpu) |
+			  RST_FPD_APU_ACPU_PWRON_RESET(Cpu)));
+		return XST_SUCCESS;
+	}
+
+	__asm__ __volatile__("smc #0"
+		: "+r" (X0) : "r" (X1), "r" (X2), "r" (X3)
+		: "x4", "x5", "x6", "x7", "x8", "x9", "x10", "x11", "x12",
+		  "x13", "x14", "x15", "x16", "x17", "memory");
+
+	return X0 == PSCI_SUCCESS ? XST_SUCCESS : XST_FAILURE;
+}
+
+/*****************************************************************************/
+/*
+* Bring up the secondary cores once, one at a time. A core that does not
+* check in within HAL_CPU_START_US is left out, and so are the ones after
+* it, so Hal_CpuCount is always the boot core plus the first cores that
+* came up.
+*
+* @return	None
+*
+******************************************************************************/
+static void HalCpuStart(void)
+{
+	u64 Start;
+	u32 Expected;
+	int Cpu;
+
+	if (HalCpuStarted) {
+		return;
+	}
+	HalCpuStarted = 1;
+
+	if (HalCpuEl() == 3U) {
+		__asm__ __volatile__(
+			"mrs %0, mair_el3\n\tmrs %1, tcr_el3\n\t"
+			"mrs %2, ttbr0_el3\n\tmrs %3, vbar_el3\n\tmrs %4, sctlr_el3"
+			: "=r" (HalCpuBoot.Mair), "=r" (HalCpuBoot.Tcr),
+			  "=r" (HalCpuBoot.Ttbr0), "=r" (HalCpuBoot.Vbar),
+			  "=r" (HalCpuBoot.Sctlr));
+	} else {
+		__asm__ __volatile__(
+			"mrs %0, mair_el1\n\tmrs %1, tcr_el1\n\t"
+			"mrs %2, ttbr0_el1\n\tmrs %3, vbar_el1\n\tmrs %4, sctlr_el1"
+			: "=r" (HalCpuBoot.Mair), "=r" (HalCpuBoot.Tcr),
+			  "=r" (HalCpuBoot.Ttbr0), "=r" (HalCpuBoot.Vbar),
+			  "=r" (HalCpuBoot.Sctlr));
+	}
+	Xil_DCacheFlushRange((UINTPTR)&HalCpuBoot, sizeof(HalCpuBoot));
+
+	for (Cpu = 1; Cpu < HAL_NUM_CPUS; Cpu++) {
+		if (HalCpuPowerOn(Cpu) != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR, "CPU %d: power on failed\r\n",
+				Cpu);
+			break;
+		}
+
+		Start = Hal_TimeNow();
+		while (Hal_AtomicLoad(&HalCpuOnline) == (u32)Cpu &&
+		       HAL_TICKS_TO_US(Hal_TimeNow() - Start) < HAL_CPU_START_US) {
+			/* Wait */
+		}
+		if (Hal_AtomicLoad(&HalCpuOnline) == (u32)Cpu + 1) {
+			continue;
+		}
+
+		/* Too late: shut the door so the core parks if it still comes */
+		Expected = (u32)Cpu;
+		if (__atomic_compare_exchange_n(&HalCpuOnline, &Expected,
+				Cpu | HAL_CPU_BOOT_CLOSED, 0, __ATOMIC_ACQ_REL,
+				__ATOMIC_ACQUIRE)) {
+			xdbg_printf(XDBG_DEBUG_ERROR, "CPU %d: did not come up\r\n",
+				Cpu);
+			break;
+		}
+	}
+}
+
+static int HalCpuOnlineCount(void)
+{
+	return (int)(Hal_AtomicLoad(&HalCpuOnline) & ~HAL_CPU_BOOT_CLOSED);
+}
+#endif
+
+int Hal_CpuCount(void)
+{
+#if HAL_NUM_CPUS > 1
+	HalCpuStart();
+	return HalCpuOnlineCount();
+#else
+	return HAL_NUM_CPUS;
+#endif
+}
+
+void Hal_CpuRun(int NumCpus, HalCpuFn Fn, void *Arg)
+{
+	int Cpu;
+
+	if (NumCpus > HAL_NUM_CPUS) {
+		NumCpus = HAL_NUM_CPUS;
+	}
+
+#if HAL_NUM_CPUS > 1
+	if (NumCpus > 1 && NumCpus <= Hal_CpuCount()) {
+		HalCpuJob.Fn = Fn;
+		HalCpuJob.Arg = Arg;
+		HalCpuJob.NumCpus = NumCpus;
+		HalCpuJob.Pending = HalCpuOnlineCount() - 1;
+		Hal_AtomicFetchAdd(&HalCpuJob.Seq, 1);
+		__asm__ __volatile__("dsb sy; sev" ::: "memory");
+
+		Fn(0, Arg);
+		while (Hal_AtomicLoad(&HalCpuJob.Pending)) {
+			/* Wait */
+		}
+		return;
+	}
+#endif
+
+	for (Cpu = 0; Cpu < NumCpus; Cpu++) {
+		Fn(Cpu, Arg);
+	}
+}
@@ -0,0 +1,273 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_log.c
+ *
+ * Binary result stream, see sodimm_log.h.
+ *
+ * Appending a record is a copy into the ring under a spin lock, so the CPUs
+ * of the multi-core sweep can log at the same time. Only a drain reaches
+ * Hal_LogWrite. Records that no longer fit in HAL_LOG_SIZE are counted and
+ * dropped.
+ *
+ ****************************************************************************/
+#include "sodimm_log.h"
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/******************** Constant Definitions **********************************/
+
+/* Records the stream holds after its header */
+#define LOG_MAX_STORED	(HAL_LOG_SIZE / sizeof(LogRecord) - 1U)
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+#define LOG_TICKS_TO_NS(Ticks) \
+	((u64)(Ticks) * 1000000000ULL / HAL_TICKS_PER_SEC)
+
+/************************** Variable Definitions *****************************/
+
+static LogRecord Ring[LOG_RING_RECORDS];
+static u32 RingCount;		/* records waiting in Ring */
+static u32 NextSeq;
+static u64 Stored;		/* records in the stream after the header */
+static u64 Dropped;
+static LogRecord Phase;		/* Test, Mode, Direction and Phase to stamp */
+static u64 LastPrint;
+static volatile u32 LogLock;
+
+/* Nanoseconds of a duration, saturated to 32 bits */
+static u32 LogNs(u64 Ticks)
+{
+	u64 Ns = LOG_TICKS_TO_NS(Ticks);
+
+	return Ns > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (u32)Ns;
+}
+
+static void LogWriteHeader(void)
+{
+	LogRecord Header;
+
+	memset(&Header, 0, sizeof(Header));
+	Header.Magic = LOG_MAGIC;
+	Header.Type = LOG_REC_HEADER;
+	Header.Status = LOG_VERSION;
+	Header.Length = sizeof(LogRecord);
+	Header.Count = (u32)Stored;
+
+	Hal_LogWrite(0, &Header, sizeof(Header));
+}
+
+/* Move the ring into the stream, LogLock held */
+static void LogDrainLocked(void)
+{
+	u32 Fit = RingCount;
+
+	if (RingCount == 0) {
+		return;
+	}
+
+	if (Stored + Fit > LOG_MAX_STORED) {
+		Fit = (u32)(LOG_MAX_STORED - Stored);
+	}
+	if (Fit && Hal_LogWrite((Stored + 1U) * sizeof(LogRecord), Ring,
+			Fit * (u32)sizeof(LogRecord)) != XST_SUCCESS) {
+		Fit = 0;
+	}
+
+	Stored += Fit;
+	Dropped += RingCount - Fit;
+	RingCount = 0;
+	LogWriteHeader();
+}
+
+/* Stamp a record filled in by the caller and queue it */
+static void LogAppend(u8 Type, LogRecord *RecordPtr)
+{
+	Hal_SpinLock(&LogLock);
+
+	RecordPtr->Magic = LOG_MAGIC;
+	RecordPtr->Type = Type;
+	RecordPtr->Test = Phase.Test;
+	RecordPtr->Mode = Phase.Mode;
+	RecordPtr->Direction = Phase.Direction;
+	RecordPtr->Seq = NextSeq++;
+	RecordPtr->Phase = Phase.Phase;
+
+	Ring[RingCount++] = *RecordPtr;
+	if (RingCount == LOG_RING_RECORDS) {
+		LogDrainLocked();
+	}
+
+	Hal_SpinUnlock(&LogLock);
+}
+
+/*****************************************************************************/
+/**
+* Start a new stream, with no records but the header.
+*
+* @return	None
+*
+******************************************************************************/
+void Log_Init(void)
+{
+	memset(&Phase, 0, sizeof(Phase));
+	RingCount = 0;
+	NextSeq = 1;
+	Stored = 0;
+	Dropped = 0;
+	LastPrint = 0;
+	LogLock = 0;
+
+	LogWriteHeader();
+}
+
+/*****************************************************************************/
+/**
+* Open the next phase. Every record up to the next Log_PhaseBegin carries
+* its number, test, mode and direction.
+*
+* @param	Test is one of LOG_TEST_*
+* @param	Mode is the pattern mode, 0 if the test has none
+* @param	Direction is the transfer direction
+* @param	Base is the bus address of the range the phase covers
+* @param	Size is the number of bytes of the range
+*
+* @return	None
+*
+******************************************************************************/
+void Log_PhaseBegin(u8 Test, u8 Mode, u8 Direction, UINTPTR Base, u64 Size)
+{
+	LogRecord Record;
+
+	Hal_SpinLock(&LogLock);
+	Phase.Test = Test;
+	Phase.Mode = Mode;
+	Phase.Direction = Direction;
+	Phase.Phase++;
+	Hal_SpinUnlock(&LogLock);
+
+	memset(&Record, 0, sizeof(Record));
+	Record.Addr = Base;
+	Record.Length = Size;
+	LogAppend(LOG_REC_PHASE, &Record);
+}
+
+/*****************************************************************************/
+/**
+* Close the current phase and drain the ring.
+*
+* @param	Status is XST_SUCCESS if the phase passed
+* @param	Bytes is the number of bytes it tested
+* @param	Batches is the number of batches it ran
+* @param	Ticks is its wall time
+*
+* @return	None
+*
+******************************************************************************/
+void Log_PhaseEnd(int Status, u64 Bytes, u32 Batches, u64 Ticks)
+{
+	LogRecord Record;
+
+	memset(&Record, 0, sizeof(Record));
+	Record.Length = Bytes;
+	Record.Status = Status != XST_SUCCESS;
+	Record.Count = Batches;
+	Record.Value = HAL_TICKS_TO_US(Ticks);
+	LogAppend(LOG_REC_END, &Record);
+
+	Log_Drain();
+}
+
+/* One batch with its StatsBatch timestamps, see sodimm_stats.h */
+void Log_Batch(const StatsBatch *BatchPtr, int Status)
+{
+	LogRecord Record;
+
+	memset(&Record, 0, sizeof(Record));
+	Record.Addr = BatchPtr->PlAddr;
+	Record.Length = BatchPtr->Length;
+	Record.Time[LOG_TIME_SETUP] =
+		LogNs(BatchPtr->Submit - BatchPtr->SetupStart);
+	Record.Time[LOG_TIME_QUEUE] =
+		LogNs(BatchPtr->DmaStart - BatchPtr->Submit);
+	Record.Time[LOG_TIME_DMA] =
+		LogNs(BatchPtr->DmaDone - BatchPtr->DmaStart);
+	Record.Time[LOG_TIME_VERIFY] =
+		LogNs(BatchPtr->VerifyDone - BatchPtr->VerifyStart);
+	Record.Status = Status != XST_SUCCESS;
+	LogAppend(LOG_REC_BATCH, &Record);
+}
+
+/*****************************************************************************/
+/**
+* Summarise a failed data check.
+*
+* @param	PlAddr is the PL DDR4 address of offset 0 of the check
+* @param	Length is the number of bytes checked
+* @param	ResultPtr is the result of the check
+*
+* @return	None
+*
+******************************************************************************/
+void Log_Failure(UINTPTR PlAddr, u32 Length, const VerifyResult *ResultPtr)
+{
+	LogRecord Record;
+	u32 Index;
+
+	memset(&Record, 0, sizeof(Record));
+	Record.Addr = PlAddr;
+	if (ResultPtr->NumFail) {
+		Record.Addr += ResultPtr->FailOffset[0];
+	}
+	Record.Length = Length;
+	Record.Status = 1;
+	Record.Count = ResultPtr->BadWords;
+	for (Index = 0; Index < ResultPtr->NumFail; Index++) {
+		Record.Value |= ResultPtr->FailExpected[Index] ^
+			ResultPtr->FailActual[Index];
+	}
+	LogAppend(LOG_REC_FAIL, &Record);
+}
+
+/* Store what the ring holds, e.g. while waiting for the DMA */
+void Log_Drain(void)
+{
+	Hal_SpinLock(&LogLock);
+	LogDrainLocked();
+	Hal_SpinUnlock(&LogLock);
+}
+
+/*****************************************************************************/
+/**
+* Rate limit of the console progress lines.
+*
+* @return	1 if LOG_PRINT_US passed since the last line let through, or
+*		none was yet, 0 otherwise
+*
+******************************************************************************/
+int Log_PrintDue(void)
+{
+	u64 Now = Hal_TimeNow();
+
+	if (LastPrint && HAL_TICKS_TO_US(Now - LastPrint) < LOG_PRINT_US) {
+		return 0;
+	}
+	LastPrint = Now;
+
+	return 1;
+}
+
+void Log_PrintSummary(void)
+{
+	Log_Drain();
+	xil_printf("result stream: %lu records of %d bytes, %lu dropped\r\n",
+		(unsigned long)Stored, (int)sizeof(LogRecord),
+		(unsigned long)Dropped);
+}
@@ -0,0 +1,106 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_log.h
+ *
+ * Binary result stream of the SODIMM tests.
+ *
+ * A sweep of a 32GB DIMM runs more than 130,000 batches per test, and a
+ * console line per batch at 9600 baud costs more than the test. Instead
+ * every batch, failure and test phase becomes one fixed size LogRecord in
+ * an in-memory ring. The ring is drained into the stream with
+ * Hal_LogWrite while the CPU waits for the DMA, when it is full and at the
+ * end of every phase: on the board into a reserved region of PS DDR, on the
+ * host into a file. host_sim/sodimm_logdump turns the stream into CSV and
+ * per-phase statistics.
+ *
+ * The stream starts with a LOG_REC_HEADER record whose Count is the number
+ * of records stored after it, so a dump of the whole region decodes too.
+ * Records are little endian, as both the A53 and the host are.
+ *
+ * Console progress lines go through Log_PrintDue, which lets one through
+ * at most every LOG_PRINT_US.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_LOG_H
+#define SODIMM_LOG_H
+
+#include "sodimm_stats.h"
+#include "sodimm_verify.h"
+
+/******************** Constant Definitions **********************************/
+
+#define LOG_MAGIC		0x474C4453U	/* "SDLG" */
+#define LOG_VERSION		1U
+
+#define LOG_RING_RECORDS	1024U	/* 64KB, drained when full */
+#define LOG_PRINT_US		1000000U /* console progress at most once a second */
+
+/* Record types */
+#define LOG_REC_HEADER		0U	/* first record of the stream */
+#define LOG_REC_PHASE		1U	/* a test phase starts */
+#define LOG_REC_BATCH		2U	/* one batch went through the pipeline */
+#define LOG_REC_FAIL		3U	/* summary of a failed data check */
+#define LOG_REC_END		4U	/* a test phase ends */
+
+/* Tests a phase belongs to */
+#define LOG_TEST_ACCESS		0U	/* access range test */
+#define LOG_TEST_PATTERN	1U	/* full range pattern sweep, one phase
+					 * per mode */
+#define LOG_TEST_DIRECTION	2U	/* direction sweep, one phase per
+					 * direction */
+#define LOG_TEST_MULTICORE	3U	/* multi-core sweep, one phase per mode */
+#define LOG_TEST_HOLD		4U	/* refresh hold test, writes and delayed
+					 * checks in one phase */
+
+/* Batch timings, in ns */
+#define LOG_TIME_SETUP		0U	/* fill and submit */
+#define LOG_TIME_QUEUE		1U	/* queued behind earlier batches */
+#define LOG_TIME_DMA		2U
+#define LOG_TIME_VERIFY		3U
+#define LOG_NUM_TIMES		4U
+
+/**************************** Type Definitions *******************************/
+
+/* One record of the stream, 64 bytes. What the generic fields hold depends
+ * on Type:
+ *
+ *   HEADER: Status LOG_VERSION, Length sizeof(LogRecord), Count records
+ *           after the header
+ *   PHASE : Addr and Length the range of the phase
+ *   BATCH : Addr and Length the PL DDR4 side, Time, Status
+ *   FAIL  : Addr the first bad word, Length the batch, Count the bad words,
+ *           Value the bits that flipped in the first bad words
+ *   END   : Length bytes tested, Status, Count batches, Value wall time
+ *           in us
+ *
+ * Test, Mode and Direction are those of the phase the record belongs to.
+ */
+typedef struct {
+	u32 Magic;		/* LOG_MAGIC */
+	u8 Type;		/* LOG_REC_* */
+	u8 Test;		/* LOG_TEST_* */
+	u8 Mode;		/* pattern mode */
+	u8 Direction;		/* transfer direction */
+	u32 Seq;		/* record number, the header is 0 */
+	u32 Phase;		/* phase number, from 1, 0 before the first */
+	u64 Addr;
+	u64 Length;
+	u32 Time[LOG_NUM_TIMES];
+	u32 Status;		/* 0 passed, 1 failed */
+	u32 Count;
+	u64 Value;
+} LogRecord;
+
+/************************** Function Prototypes ******************************/
+
+void Log_Init(void);
+void Log_PhaseBegin(u8 Test, u8 Mode, u8 Direction, UINTPTR Base, u64 Size);
+void Log_PhaseEnd(int Status, u64 Bytes, u32 Batches, u64 Ticks);
+void Log_Batch(const StatsBatch *BatchPtr, int Status);
+void Log_Failure(UINTPTR PlAddr, u32 Length, const VerifyResult *ResultPtr);
+void Log_Drain(void);
+int Log_PrintDue(void);
+void Log_PrintSummary(void);
+
+#endif /* SODIMM_LOG_H */
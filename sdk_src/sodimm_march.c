@@ -0,0 +1,487 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_march.c
+ *
+ * CPU-direct March engine, see sodimm_march.h.
+ *
+ * Every element runs one of four line loops: write only, read only, read
+ * then write, or a generic loop for the longer elements of March SS. The
+ * loops keep the two background lines in registers and branch once per
+ * read, the word scan that fills in the failure details only runs on the
+ * cells that differ.
+ *
+ ****************************************************************************/
+#include "sodimm_march.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MARCH_USE_NEON
+#endif
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset, memcpy */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/******************** Constant Definitions **********************************/
+
+#define MARCH_CELL_WORDS	(MARCH_CELL_LEN / sizeof(u64))
+
+#define MARCH_NAME_LEN		24U	/* longest March_ElementName + 1 */
+
+/**************************** Type Definitions *******************************/
+
+/* One cell worth of data, kept in registers by the line loops */
+typedef struct {
+#ifdef MARCH_USE_NEON
+	uint64x2_t Q[4];
+#else
+	u64 W[MARCH_CELL_WORDS];
+#endif
+} MarchLine;
+
+/************************** Variable Definitions *****************************/
+
+/* MATS+: {any(w0); up(r0,w1); down(r1,w0)} */
+const MarchAlgorithm March_MatsPlus = {
+	"MATS+", 3, {
+		{ MARCH_ANY, 1, { MARCH_W0 } },
+		{ MARCH_UP, 2, { MARCH_R0, MARCH_W1 } },
+		{ MARCH_DOWN, 2, { MARCH_R1, MARCH_W0 } },
+	}
+};
+
+/* March C-: {any(w0); up(r0,w1); up(r1,w0); down(r0,w1); down(r1,w0);
+ * any(r0)}
+ */
+const MarchAlgorithm March_CMinus = {
+	"March C-", 6, {
+		{ MARCH_ANY, 1, { MARCH_W0 } },
+		{ MARCH_UP, 2, { MARCH_R0, MARCH_W1 } },
+		{ MARCH_UP, 2, { MARCH_R1, MARCH_W0 } },
+		{ MARCH_DOWN, 2, { MARCH_R0, MARCH_W1 } },
+		{ MARCH_DOWN, 2, { MARCH_R1, MARCH_W0 } },
+		{ MARCH_ANY, 1, { MARCH_R0 } },
+	}
+};
+
+/* March SS: {any(w0); up(r0,r0,w0,r0,w1); up(r1,r1,w1,r1,w0);
+ * down(r0,r0,w0,r0,w1); down(r1,r1,w1,r1,w0); any(r0)}
+ */
+const MarchAlgorithm March_SS = {
+	"March SS", 6, {
+		{ MARCH_ANY, 1, { MARCH_W0 } },
+		{ MARCH_UP, 5, { MARCH_R0, MARCH_R0, MARCH_W0, MARCH_R0,
+			MARCH_W1 } },
+		{ MARCH_UP, 5, { MARCH_R1, MARCH_R1, MARCH_W1, MARCH_R1,
+			MARCH_W0 } },
+		{ MARCH_DOWN, 5, { MARCH_R0, MARCH_R0, MARCH_W0, MARCH_R0,
+			MARCH_W1 } },
+		{ MARCH_DOWN, 5, { MARCH_R1, MARCH_R1, MARCH_W1, MARCH_R1,
+			MARCH_W0 } },
+		{ MARCH_ANY, 1, { MARCH_R0 } },
+	}
+};
+
+/*****************************************************************************/
+/*
+* Line primitives. On the A53 a cell is moved with two ldnp/stnp pairs of
+* q registers, which tell the core not to keep the data in the caches. The
+* host build uses volatile words so a read right after a write of the same
+* cell still goes to memory.
+*
+******************************************************************************/
+static inline void MarchLoad(const u64 *Cell, MarchLine *LinePtr)
+{
+#ifdef MARCH_USE_NEON
+	__asm__ __volatile__(
+		"ldnp %q0, %q1, [%4]\n\t"
+		"ldnp %q2, %q3, [%4, #32]"
+		: "=w"(LinePtr->Q[0]), "=w"(LinePtr->Q[1]),
+		  "=w"(LinePtr->Q[2]), "=w"(LinePtr->Q[3])
+		: "r"(Cell)
+		: "memory");
+#else
+	const volatile u64 *Src = Cell;
+	u32 Index;
+
+	for (Index = 0; Index < MARCH_CELL_WORDS; Index++) {
+		LinePtr->W[Index] = Src[Index];
+	}
+#endif
+}
+
+static inline void MarchStore(u64 *Cell, const MarchLine *LinePtr)
+{
+#ifdef MARCH_USE_NEON
+	__asm__ __volatile__(
+		"stnp %q0, %q1, [%4]\n\t"
+		"stnp %q2, %q3, [%4, #32]"
+		:
+		: "w"(LinePtr->Q[0]), "w"(LinePtr->Q[1]),
+		  "w"(LinePtr->Q[2]), "w"(LinePtr->Q[3]), "r"(Cell)
+		: "memory");
+#else
+	volatile u64 *Dst = Cell;
+	u32 Index;
+
+	for (Index = 0; Index < MARCH_CELL_WORDS; Index++) {
+		Dst[Index] = LinePtr->W[Index];
+	}
+#endif
+}
+
+/* Zero a cell with DC ZVA, only used once MarchZvaLen matched the cell */
+static inline void MarchZero(u64 *Cell)
+{
+#ifdef MARCH_USE_NEON
+	__asm__ __volatile__("dc zva, %0" : : "r"(Cell) : "memory");
+#else
+	(void)Cell;
+#endif
+}
+
+static inline u64 MarchDiff(const MarchLine *Read, const MarchLine *Expected)
+{
+#ifdef MARCH_USE_NEON
+	uint64x2_t Diff0;
+	uint64x2_t Diff1;
+
+	Diff0 = vorrq_u64(veorq_u64(Read->Q[0], Expected->Q[0]),
+		veorq_u64(Read->Q[1], Expected->Q[1]));
+	Diff1 = vorrq_u64(veorq_u64(Read->Q[2], Expected->Q[2]),
+		veorq_u64(Read->Q[3], Expected->Q[3]));
+	Diff0 = vorrq_u64(Diff0, Diff1);
+
+	return vgetq_lane_u64(Diff0, 0) | vgetq_lane_u64(Diff0, 1);
+#else
+	return (Read->W[0] ^ Expected->W[0]) | (Read->W[1] ^ Expected->W[1]) |
+		(Read->W[2] ^ Expected->W[2]) | (Read->W[3] ^ Expected->W[3]) |
+		(Read->W[4] ^ Expected->W[4]) | (Read->W[5] ^ Expected->W[5]) |
+		(Read->W[6] ^ Expected->W[6]) | (Read->W[7] ^ Expected->W[7]);
+#endif
+}
+
+/*****************************************************************************/
+/*
+* Bytes zeroed by one DC ZVA, or 0 if the instruction is not available.
+*
+******************************************************************************/
+static u32 MarchZvaLen(void)
+{
+#ifdef MARCH_USE_NEON
+	u64 Dczid;
+
+	__asm__ __volatile__("mrs %0, dczid_el0" : "=r"(Dczid));
+	if (Dczid & 0x10U) {
+		return 0;	/* DZP, prohibited */
+	}
+
+	return 4U << (Dczid & 0xFU);
+#else
+	return 0;
+#endif
+}
+
+static void MarchFillLine(MarchLine *LinePtr, u64 Value)
+{
+#ifdef MARCH_USE_NEON
+	LinePtr->Q[0] = vdupq_n_u64(Value);
+	LinePtr->Q[1] = LinePtr->Q[0];
+	LinePtr->Q[2] = LinePtr->Q[0];
+	LinePtr->Q[3] = LinePtr->Q[0];
+#else
+	u32 Index;
+
+	for (Index = 0; Index < MARCH_CELL_WORDS; Index++) {
+		LinePtr->W[Index] = Value;
+	}
+#endif
+}
+
+/*****************************************************************************/
+/*
+* Slow path of a read that differs: count the cell and log its bad words.
+*
+******************************************************************************/
+static void MarchRecord(const MarchLine *Read, const MarchLine *Expected,
+		UINTPTR Addr, u32 Element, MarchResult *ResultPtr)
+{
+	u64 Actual[MARCH_CELL_WORDS];
+	u64 Wanted[MARCH_CELL_WORDS];
+	u32 Index;
+
+	memcpy(Actual, Read, sizeof(Actual));
+	memcpy(Wanted, Expected, sizeof(Wanted));
+
+	ResultPtr->BadCells++;
+	for (Index = 0; Index < MARCH_CELL_WORDS; Index++) {
+		if (Actual[Index] == Wanted[Index]) {
+			continue;
+		}
+
+		ResultPtr->BadWords++;
+		if (ResultPtr->Log) {
+			Fault_Record(ResultPtr->Log, Addr + Index * sizeof(u64),
+				Wanted[Index], Actual[Index]);
+		}
+		if (ResultPtr->NumFail < MARCH_MAX_FAIL) {
+			ResultPtr->FailAddr[ResultPtr->NumFail] =
+				Addr + Index * sizeof(u64);
+			ResultPtr->FailExpected[ResultPtr->NumFail] = Wanted[Index];
+			ResultPtr->FailActual[ResultPtr->NumFail] = Actual[Index];
+			ResultPtr->FailElement[ResultPtr->NumFail] = (u8)Element;
+			ResultPtr->NumFail++;
+		}
+	}
+}
+
+/*****************************************************************************/
+/*
+* Run one element over one chunk, cell by cell in the element order.
+*
+* @param	ElemPtr is the element
+* @param	Element is its index in the algorithm, for the failure log
+* @param	Addr is the bus address of the chunk
+* @param	Length is the number of bytes, a multiple of MARCH_CELL_LEN
+* @param	Value holds the "0" and "1" background lines
+* @param	Zva is non-zero to write zeros with DC ZVA
+* @param	ResultPtr collects the failures
+*
+******************************************************************************/
+static void MarchChunk(const MarchElement *ElemPtr, u32 Element, UINTPTR Addr,
+		u32 Length, const MarchLine *Value, int Zva,
+		MarchResult *ResultPtr)
+{
+	u64 *Base = (u64 *)Hal_Ptr(Addr);
+	s64 Cells = Length / MARCH_CELL_LEN;
+	s64 Step = (ElemPtr->Order == MARCH_DOWN) ? -1 : 1;
+	s64 Cell = (Step < 0) ? Cells - 1 : 0;
+	u8 Op0 = ElemPtr->Op[0];
+	u8 Op1 = ElemPtr->Op[1];
+	MarchLine Read;
+	u64 *Ptr;
+	u32 Index;
+
+	if (ElemPtr->NumOps == 1U && MARCH_OP_IS_WRITE(Op0)) {
+		/* any(wX): a plain stream of stores, or DC ZVA for zeros */
+		for (; Cell >= 0 && Cell < Cells; Cell += Step) {
+			Ptr = Base + Cell * MARCH_CELL_WORDS;
+			if (Zva) {
+				MarchZero(Ptr);
+			} else {
+				MarchStore(Ptr, &Value[MARCH_OP_VALUE(Op0)]);
+			}
+		}
+	} else if (ElemPtr->NumOps == 1U) {
+		/* any(rX) */
+		for (; Cell >= 0 && Cell < Cells; Cell += Step) {
+			Ptr = Base + Cell * MARCH_CELL_WORDS;
+			MarchLoad(Ptr, &Read);
+			if (MarchDiff(&Read, &Value[MARCH_OP_VALUE(Op0)])) {
+				MarchRecord(&Read, &Value[MARCH_OP_VALUE(Op0)],
+					Addr + Cell * MARCH_CELL_LEN, Element,
+					ResultPtr);
+			}
+		}
+	} else if (ElemPtr->NumOps == 2U && !MARCH_OP_IS_WRITE(Op0) &&
+		   MARCH_OP_IS_WRITE(Op1)) {
+		/* (rX,wY), the bulk of March C- and MATS+ */
+		for (; Cell >= 0 && Cell < Cells; Cell += Step) {
+			Ptr = Base + Cell * MARCH_CELL_WORDS;
+			MarchLoad(Ptr, &Read);
+			if (MarchDiff(&Read, &Value[MARCH_OP_VALUE(Op0)])) {
+				MarchRecord(&Read, &Value[MARCH_OP_VALUE(Op0)],
+					Addr + Cell * MARCH_CELL_LEN, Element,
+					ResultPtr);
+			}
+			MarchStore(Ptr, &Value[MARCH_OP_VALUE(Op1)]);
+		}
+	} else {
+		for (; Cell >= 0 && Cell < Cells; Cell += Step) {
+			Ptr = Base + Cell * MARCH_CELL_WORDS;
+			for (Index = 0; Index < ElemPtr->NumOps; Index++) {
+				u8 Op = ElemPtr->Op[Index];
+
+				if (MARCH_OP_IS_WRITE(Op)) {
+					MarchStore(Ptr, &Value[MARCH_OP_VALUE(Op)]);
+					continue;
+				}
+				MarchLoad(Ptr, &Read);
+				if (MarchDiff(&Read, &Value[MARCH_OP_VALUE(Op)])) {
+					MarchRecord(&Read,
+						&Value[MARCH_OP_VALUE(Op)],
+						Addr + Cell * MARCH_CELL_LEN,
+						Element, ResultPtr);
+				}
+			}
+		}
+	}
+}
+
+/*****************************************************************************/
+/**
+* Run a March algorithm over a range of the DIMM.
+*
+* Each element walks the whole range, MARCH_CHUNK_LEN at a time, and the
+* data cache is cleaned and invalidated between elements, so the first reads
+* of an element come from the DIMM even when the range is mapped cacheable.
+*
+* @param	AlgPtr is the algorithm
+* @param	Base is the bus address of the range, MARCH_CELL_LEN aligned
+* @param	Size is the number of bytes, a multiple of MARCH_CELL_LEN
+* @param	Background is the "0" data word, "1" is its inverse
+* @param	LogPtr also records every bad word, or NULL
+* @param	ResultPtr receives the failures and the time of each element
+*
+* @return
+*		- XST_SUCCESS if every read matched
+*		- XST_FAILURE otherwise, or if the arguments are invalid
+*
+* @note		The caller maps the range for the CPU, see Hal_CpuMapRange.
+*		Reads that follow a write of the same cell inside an element
+*		(March SS) are served by the cache when the range is cacheable.
+*
+******************************************************************************/
+int March_Run(const MarchAlgorithm *AlgPtr, UINTPTR Base, u64 Size,
+		u64 Background, FaultLog *LogPtr, MarchResult *ResultPtr)
+{
+	MarchLine Value[2];
+	u32 ZvaLen = MarchZvaLen();
+	u32 Element;
+	u64 Offset;
+	u32 Length;
+	u64 Start;
+
+	memset(ResultPtr, 0, sizeof(*ResultPtr));
+	ResultPtr->Log = LogPtr;
+
+	if (Base % MARCH_CELL_LEN || Size % MARCH_CELL_LEN || Size == 0 ||
+	    AlgPtr->NumElements > MARCH_MAX_ELEMENTS) {
+		xil_printf("Invalid March range 0x%lx + 0x%lx\r\n", Base, Size);
+		return XST_FAILURE;
+	}
+
+	MarchFillLine(&Value[0], Background);
+	MarchFillLine(&Value[1], ~Background);
+
+	for (Element = 0; Element < AlgPtr->NumElements; Element++) {
+		const MarchElement *ElemPtr = &AlgPtr->Element[Element];
+		int Zva = ElemPtr->NumOps == 1U &&
+			ElemPtr->Op[0] == MARCH_W0 && Background == 0 &&
+			ZvaLen == MARCH_CELL_LEN;
+
+		Start = Hal_TimeNow();
+		if (ElemPtr->Order == MARCH_DOWN) {
+			for (Offset = Size; Offset > 0; Offset -= Length) {
+				Length = Offset < MARCH_CHUNK_LEN ?
+					(u32)Offset : MARCH_CHUNK_LEN;
+				MarchChunk(ElemPtr, Element,
+					Base + (Offset - Length), Length, Value,
+					Zva, ResultPtr);
+			}
+		} else {
+			for (Offset = 0; Offset < Size; Offset += Length) {
+				Length = Size - Offset < MARCH_CHUNK_LEN ?
+					(u32)(Size - Offset) : MARCH_CHUNK_LEN;
+				MarchChunk(ElemPtr, Element, Base + Offset,
+					Length, Value, Zva, ResultPtr);
+			}
+		}
+		Hal_DCacheFlushAll();
+		ResultPtr->ElementTicks[Element] = Hal_TimeNow() - Start;
+	}
+
+	return ResultPtr->BadCells ? XST_FAILURE : XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Write the name of an element, e.g. "down(r1,w0)", to Buf.
+*
+* @param	ElemPtr is the element
+* @param	Buf receives the name, at least MARCH_NAME_LEN bytes
+*
+* @return	None
+*
+******************************************************************************/
+void March_ElementName(const MarchElement *ElemPtr, char *Buf)
+{
+	static const char *OrderName[] = { "up", "down", "any" };
+	const char *Order = OrderName[ElemPtr->Order <= MARCH_ANY ?
+		ElemPtr->Order : MARCH_ANY];
+	u32 Index;
+
+	while (*Order) {
+		*Buf++ = *Order++;
+	}
+	*Buf++ = '(';
+	for (Index = 0; Index < ElemPtr->NumOps; Index++) {
+		if (Index) {
+			*Buf++ = ',';
+		}
+		*Buf++ = MARCH_OP_IS_WRITE(ElemPtr->Op[Index]) ? 'w' : 'r';
+		*Buf++ = (char)('0' + MARCH_OP_VALUE(ElemPtr->Op[Index]));
+	}
+	*Buf++ = ')';
+	*Buf = '\0';
+}
+
+/*****************************************************************************/
+/**
+* Print the time and access bandwidth of every element of a run, then its
+* failures.
+*
+* @param	AlgPtr is the algorithm that was run
+* @param	ResultPtr is the result of March_Run
+* @param	Size is the number of bytes that were tested
+*
+* @return	None
+*
+******************************************************************************/
+void March_PrintResult(const MarchAlgorithm *AlgPtr,
+		const MarchResult *ResultPtr, u64 Size)
+{
+	char Name[MARCH_NAME_LEN];
+	u64 TotalTicks = 0;
+	u64 Bytes = 0;
+	u64 Us;
+	u32 Element;
+	u32 Index;
+
+	xil_printf("  element                ms     MB/s\r\n");
+	for (Element = 0; Element < AlgPtr->NumElements; Element++) {
+		const MarchElement *ElemPtr = &AlgPtr->Element[Element];
+
+		March_ElementName(ElemPtr, Name);
+		Us = HAL_TICKS_TO_US(ResultPtr->ElementTicks[Element]);
+		xil_printf("  %-20s %6lu %8lu\r\n", Name,
+			(unsigned long)(Us / 1000),
+			(unsigned long)(Us ? Size * ElemPtr->NumOps / Us : 0));
+		TotalTicks += ResultPtr->ElementTicks[Element];
+		Bytes += Size * ElemPtr->NumOps;
+	}
+
+	Us = HAL_TICKS_TO_US(TotalTicks);
+	xil_printf("  %-20s %6lu %8lu\r\n", "total", (unsigned long)(Us / 1000),
+		(unsigned long)(Us ? Bytes / Us : 0));
+
+	if (ResultPtr->BadCells == 0) {
+		return;
+	}
+
+	xil_printf("  %lu bad words in %lu cell reads\r\n",
+		(unsigned long)ResultPtr->BadWords,
+		(unsigned long)ResultPtr->BadCells);
+	for (Index = 0; Index < ResultPtr->NumFail; Index++) {
+		March_ElementName(&AlgPtr->Element[ResultPtr->FailElement[Index]],
+			Name);
+		xil_printf("  0x%lx: expected 0x%016lx read 0x%016lx in %s\r\n",
+			ResultPtr->FailAddr[Index], ResultPtr->FailExpected[Index],
+			ResultPtr->FailActual[Index], Name);
+	}
+}
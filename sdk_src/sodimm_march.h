@@ -0,0 +1,97 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_march.h
+ *
+ * CPU-direct March tests of the PL DDR4.
+ *
+ * The CDMA can only move whole buffers, so it cannot express the ordered
+ * read-compare-write passes of the March algorithms. This engine runs them
+ * from the CPU over the DIMM mapped with Hal_CpuMapRange.
+ *
+ * A March algorithm is a list of elements. Each element walks the range up
+ * or down and applies its operations, e.g. (r0,w1), to one cell before
+ * moving to the next. Here a cell is a 64 byte line: one DDR4 burst of the
+ * 64-bit SODIMM, the smallest access the memory controller issues, so a
+ * finer order inside the line is not visible to the DIMM. "0" is the data
+ * background replicated over the line and "1" its inverse.
+ *
+ * The line kernels use 128-bit NEON registers with ldnp/stnp non-temporal
+ * pairs on the A53, and DC ZVA for elements that only write zeros. Plain
+ * 64-bit accesses are used elsewhere.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_MARCH_H
+#define SODIMM_MARCH_H
+
+#include "sodimm_fault.h"
+
+/******************** Constant Definitions **********************************/
+
+#define MARCH_CELL_LEN		64U	/* bytes per cell, one DDR4 burst */
+
+/* Bytes handed to the line kernels per Hal_Ptr translation */
+#define MARCH_CHUNK_LEN		0x100000U
+
+#define MARCH_MAX_ELEMENTS	8U
+#define MARCH_MAX_OPS		5U
+
+/* Failing words recorded per run */
+#define MARCH_MAX_FAIL		16U
+
+/* Element address order. MARCH_ANY runs up. */
+#define MARCH_UP		0U
+#define MARCH_DOWN		1U
+#define MARCH_ANY		2U
+
+/* Operations, bit 0 is the value */
+#define MARCH_R0		0U
+#define MARCH_R1		1U
+#define MARCH_W0		2U
+#define MARCH_W1		3U
+
+#define MARCH_OP_IS_WRITE(Op)	((Op) & 2U)
+#define MARCH_OP_VALUE(Op)	((Op) & 1U)
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u8 Order;			/* MARCH_UP, MARCH_DOWN or MARCH_ANY */
+	u8 NumOps;
+	u8 Op[MARCH_MAX_OPS];		/* MARCH_R0 ... MARCH_W1 in order */
+} MarchElement;
+
+typedef struct {
+	const char *Name;
+	u32 NumElements;
+	MarchElement Element[MARCH_MAX_ELEMENTS];
+} MarchAlgorithm;
+
+/* Outcome of March_Run. Failures keep going, every cell is tested. */
+typedef struct {
+	u64 BadCells;			/* cell reads that differ */
+	u64 BadWords;			/* 64-bit words that differ */
+	u32 NumFail;			/* entries used in the Fail* arrays */
+	UINTPTR FailAddr[MARCH_MAX_FAIL];
+	u64 FailExpected[MARCH_MAX_FAIL];
+	u64 FailActual[MARCH_MAX_FAIL];
+	u8 FailElement[MARCH_MAX_FAIL];
+	u64 ElementTicks[MARCH_MAX_ELEMENTS];	/* Hal_TimeNow ticks */
+	FaultLog *Log;			/* every bad word is also recorded here */
+} MarchResult;
+
+/************************** Variable Definitions *****************************/
+
+extern const MarchAlgorithm March_MatsPlus;
+extern const MarchAlgorithm March_CMinus;
+extern const MarchAlgorithm March_SS;
+
+/************************** Function Prototypes ******************************/
+
+int March_Run(const MarchAlgorithm *AlgPtr, UINTPTR Base, u64 Size,
+		u64 Background, FaultLog *LogPtr, MarchResult *ResultPtr);
+void March_PrintResult(const MarchAlgorithm *AlgPtr,
+		const MarchResult *ResultPtr, u64 Size);
+void March_ElementName(const MarchElement *ElemPtr, char *Buf);
+
+#endif /* SODIMM_MARCH_H */
@@ -0,0 +1,171 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_pattern.c
+ *
+ * Pattern fill kernels, see sodimm_pattern.h.
+ *
+ * The loops are unrolled to a 64 byte cache line and have no data dependent
+ * branches. With NEON the periodic patterns are kept in vector registers
+ * and written with 128-bit stores.
+ *
+ ****************************************************************************/
+#include "sodimm_pattern.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PATTERN_USE_NEON
+#endif
+
+/*****************************************************************************/
+/**
+* Mode 0: fill Dst with the address pattern, where the word at bus address
+* A holds A in its low half and A + 4 in its high half, XORed with the high
+* bits of A.
+*
+* @param	Dst is the CPU pointer to the buffer
+* @param	Addr is the address to encode for the first word
+* @param	Length is the number of bytes, a multiple of PATTERN_FILL_ALIGN
+*
+* @return	None
+*
+******************************************************************************/
+void Pattern_FillAddr(u64 *Dst, UINTPTR Addr, u32 Length)
+{
+	u64 A = (u64)Addr;
+	u64 *End = Dst + Length / sizeof(u64);
+
+	while (Dst < End) {
+		Dst[0] = ((A + 4) << 32) ^ A;
+		Dst[1] = ((A + 12) << 32) ^ (A + 8);
+		Dst[2] = ((A + 20) << 32) ^ (A + 16);
+		Dst[3] = ((A + 28) << 32) ^ (A + 24);
+		Dst[4] = ((A + 36) << 32) ^ (A + 32);
+		Dst[5] = ((A + 44) << 32) ^ (A + 40);
+		Dst[6] = ((A + 52) << 32) ^ (A + 48);
+		Dst[7] = ((A + 60) << 32) ^ (A + 56);
+		A += 64;
+		Dst += 8;
+	}
+}
+
+/*****************************************************************************/
+/**
+* Modes 1-8: repeat a 4 word TestPattern row over Dst.
+*
+* @param	Dst is the CPU pointer to the buffer
+* @param	Pattern is the 4 word row
+* @param	Length is the number of bytes, a multiple of PATTERN_FILL_ALIGN
+*
+* @return	None
+*
+******************************************************************************/
+void Pattern_FillRepeat4(u64 *Dst, const u64 *Pattern, u32 Length)
+{
+	u64 *End = Dst + Length / sizeof(u64);
+#ifdef PATTERN_USE_NEON
+	uint64x2_t P01 = vld1q_u64(Pattern);
+	uint64x2_t P23 = vld1q_u64(Pattern + 2);
+
+	while (Dst < End) {
+		vst1q_u64(Dst, P01);
+		vst1q_u64(Dst + 2, P23);
+		vst1q_u64(Dst + 4, P01);
+		vst1q_u64(Dst + 6, P23);
+		Dst += 8;
+	}
+#else
+	u64 P0 = Pattern[0];
+	u64 P1 = Pattern[1];
+	u64 P2 = Pattern[2];
+	u64 P3 = Pattern[3];
+
+	while (Dst < End) {
+		Dst[0] = P0;
+		Dst[1] = P1;
+		Dst[2] = P2;
+		Dst[3] = P3;
+		Dst[4] = P0;
+		Dst[5] = P1;
+		Dst[6] = P2;
+		Dst[7] = P3;
+		Dst += 8;
+	}
+#endif
+}
+
+/*****************************************************************************/
+/**
+* Modes 9-10: word n of Dst takes entry (2 * n) mod 128 of the 128 entry
+* Pattern table, the same stride XMt_GetRefVal uses. The output repeats
+* every 64 words.
+*
+* @param	Dst is the CPU pointer to the buffer
+* @param	Pattern is the 128 entry table
+* @param	Length is the number of bytes, a multiple of PATTERN_FILL_ALIGN
+*
+* @return	None
+*
+******************************************************************************/
+void Pattern_FillMask(u64 *Dst, const u64 *Pattern, u32 Length)
+{
+	u64 *End = Dst + Length / sizeof(u64);
+	u32 Index;
+
+	while (Dst < End) {
+		for (Index = 0; Index < 128; Index += 16) {
+#ifdef PATTERN_USE_NEON
+			/* vld2q splits even and odd entries, keep the even */
+			vst1q_u64(Dst, vld2q_u64(&Pattern[Index]).val[0]);
+			vst1q_u64(Dst + 2, vld2q_u64(&Pattern[Index + 4]).val[0]);
+			vst1q_u64(Dst + 4, vld2q_u64(&Pattern[Index + 8]).val[0]);
+			vst1q_u64(Dst + 6, vld2q_u64(&Pattern[Index + 12]).val[0]);
+#else
+			Dst[0] = Pattern[Index];
+			Dst[1] = Pattern[Index + 2];
+			Dst[2] = Pattern[Index + 4];
+			Dst[3] = Pattern[Index + 6];
+			Dst[4] = Pattern[Index + 8];
+			Dst[5] = Pattern[Index + 10];
+			Dst[6] = Pattern[Index + 12];
+			Dst[7] = Pattern[Index + 14];
+#endif
+			Dst += 8;
+		}
+	}
+}
+
+/*****************************************************************************/
+/**
+* Modes 11-14: fill Dst with the random stream Seed, starting at the word
+* for bus address Addr.
+*
+* @param	Dst is the CPU pointer to the buffer
+* @param	Seed selects the stream
+* @param	Addr is the address of the first word in the stream
+* @param	Length is the number of bytes, a multiple of PATTERN_FILL_ALIGN
+*
+* @return	None
+*
+* @note		The eight words of a line are independent, which keeps the
+*		multiplier pipeline full.
+*
+******************************************************************************/
+void Pattern_FillRandom(u64 *Dst, u64 Seed, UINTPTR Addr, u32 Length)
+{
+	u64 State = Seed + ((u64)Addr >> 3) * PATTERN_RANDOM_GAMMA;
+	u64 *End = Dst + Length / sizeof(u64);
+
+	while (Dst < End) {
+		Dst[0] = Pattern_Mix64(State);
+		Dst[1] = Pattern_Mix64(State + PATTERN_RANDOM_GAMMA);
+		Dst[2] = Pattern_Mix64(State + 2 * PATTERN_RANDOM_GAMMA);
+		Dst[3] = Pattern_Mix64(State + 3 * PATTERN_RANDOM_GAMMA);
+		Dst[4] = Pattern_Mix64(State + 4 * PATTERN_RANDOM_GAMMA);
+		Dst[5] = Pattern_Mix64(State + 5 * PATTERN_RANDOM_GAMMA);
+		Dst[6] = Pattern_Mix64(State + 6 * PATTERN_RANDOM_GAMMA);
+		Dst[7] = Pattern_Mix64(State + 7 * PATTERN_RANDOM_GAMMA);
+		State += 8 * PATTERN_RANDOM_GAMMA;
+		Dst += 8;
+	}
+}
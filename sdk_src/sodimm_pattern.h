@@ -0,0 +1,64 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_pattern.h
+ *
+ * Specialized fill kernels for the XMt_Memtest pattern modes.
+ *
+ * XMt_GetRefVal computes one word at a time and decides what to do from the
+ * mode on every call. The kernels here each handle one mode family and fill
+ * a whole buffer with straight-line stores:
+ *
+ * - Pattern_FillAddr    : mode 0, every word encodes its own address
+ * - Pattern_FillRepeat4 : modes 1-8, a 4 word TestPattern row
+ * - Pattern_FillMask    : modes 9-10, a 128 entry pattern/inverted-mask table
+ * - Pattern_FillRandom  : modes 11-14, a pseudo random stream
+ *
+ * Each kernel writes exactly what XMt_GetRefVal returns for Index = 0, 8,
+ * 16, ... from the start of Dst.
+ *
+ * The random stream is counter based: the word at address A is a SplitMix64
+ * hash of Seed + (A / 8) * PATTERN_RANDOM_GAMMA. Any word can be computed on
+ * its own, so a chunk can be generated or verified without the words before
+ * it, in any order and on any core.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_PATTERN_H
+#define SODIMM_PATTERN_H
+
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+/* Lengths passed to the kernels must be a multiple of this, the period of
+ * the longest pattern (Pattern_FillMask).
+ */
+#define PATTERN_FILL_ALIGN	512U
+
+/* Weyl sequence increment of the random stream, per 64-bit word */
+#define PATTERN_RANDOM_GAMMA	0x9E3779B97F4A7C15ULL
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/* SplitMix64 output function */
+static inline u64 Pattern_Mix64(u64 Z)
+{
+	Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBULL;
+	return Z ^ (Z >> 31);
+}
+
+/* Word of the random stream Seed at bus address Addr */
+static inline u64 Pattern_RandomWord(u64 Seed, UINTPTR Addr)
+{
+	return Pattern_Mix64(Seed + ((u64)Addr >> 3) * PATTERN_RANDOM_GAMMA);
+}
+
+/************************** Function Prototypes ******************************/
+
+void Pattern_FillAddr(u64 *Dst, UINTPTR Addr, u32 Length);
+void Pattern_FillRepeat4(u64 *Dst, const u64 *Pattern, u32 Length);
+void Pattern_FillMask(u64 *Dst, const u64 *Pattern, u32 Length);
+void Pattern_FillRandom(u64 *Dst, u64 Seed, UINTPTR Addr, u32 Length);
+
+#endif /* SODIMM_PATTERN_H */
@@ -0,0 +1,221 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_screen.c
+ *
+ * Data and address line screen, see sodimm_screen.h.
+ *
+ * All accesses are single volatile 64-bit loads and stores, in program
+ * order, so what reaches the DIMM is exactly what the code reads. The range
+ * is normal non-cacheable memory, which the A53 may still serve a load from
+ * its store buffer, so a Hal_MemBarrier sits between every store and the
+ * loads that check it.
+ *
+ ****************************************************************************/
+#include "sodimm_screen.h"
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/******************** Constant Definitions **********************************/
+
+/* Written to another burst between a write and its read back, so a floating
+ * DQ line cannot return the last value driven on it.
+ */
+#define SCREEN_DECOY_OFFSET	(SCREEN_BURST_WORDS * sizeof(u64))
+
+/* Tag of the address screen, XORed with the offset of each location */
+#define SCREEN_ADDR_TAG		0xA5C3F00F0FF03C5AULL
+
+/*****************************************************************************/
+/*
+* Write one value to a word, a decoy to another burst, and read the word
+* back. Bits that come back flipped are added to the stuck masks.
+*
+******************************************************************************/
+static void ScreenCheckWord(volatile u64 *Word, volatile u64 *Decoy, u64 Value,
+		ScreenResult *ResultPtr)
+{
+	u64 Diff;
+
+	*Word = Value;
+	*Decoy = ~Value;
+	Hal_MemBarrier();
+	Diff = *Word ^ Value;
+
+	ResultPtr->DataStuckHigh |= Diff & ~Value;
+	ResultPtr->DataStuckLow |= Diff & Value;
+	ResultPtr->Accesses += 3U;
+}
+
+/*****************************************************************************/
+/*
+* Write the tags of the address screen in one order and check them all.
+*
+******************************************************************************/
+static void ScreenAddrPass(UINTPTR Base, u32 NumBits, int Down,
+		ScreenResult *ResultPtr)
+{
+	u64 Offset;
+	u64 Seen;
+	u32 Index;
+	u32 Bit;
+
+	/* Index 0 is the base itself, Index n the offset 1 << (n + MIN - 1) */
+	for (Index = 0; Index <= NumBits; Index++) {
+		Bit = Down ? NumBits - Index : Index;
+		Offset = Bit ? 1ULL << (Bit + SCREEN_MIN_ADDR_BIT - 1U) : 0;
+		*(volatile u64 *)Hal_Ptr(Base + Offset) = SCREEN_ADDR_TAG ^ Offset;
+
+		/* Keep the order of the stores, a later tag overwrites an alias */
+		Hal_MemBarrier();
+	}
+
+	for (Bit = 0; Bit <= NumBits; Bit++) {
+		Offset = Bit ? 1ULL << (Bit + SCREEN_MIN_ADDR_BIT - 1U) : 0;
+		Seen = *(volatile u64 *)Hal_Ptr(Base + Offset) ^ SCREEN_ADDR_TAG;
+		if (Seen == Offset) {
+			continue;
+		}
+
+		/* Another location's tag: the bits that differ alias */
+		if (Seen == 0 || ((Seen & (Seen - 1U)) == 0 &&
+		    Seen >= (1ULL << SCREEN_MIN_ADDR_BIT) &&
+		    Seen < (1ULL << (NumBits + SCREEN_MIN_ADDR_BIT)))) {
+			ResultPtr->AddrBad |= Seen ^ Offset;
+		} else {
+			ResultPtr->AddrCorrupt++;
+		}
+	}
+
+	ResultPtr->Accesses += 2U * (NumBits + 1U);
+}
+
+/*****************************************************************************/
+/**
+* Clear a result before the screens.
+*
+* @param	ResultPtr is the result to clear
+*
+* @return	None
+*
+******************************************************************************/
+void Screen_Reset(ScreenResult *ResultPtr)
+{
+	memset(ResultPtr, 0, sizeof(*ResultPtr));
+}
+
+/*****************************************************************************/
+/**
+* Walk a one and a zero over every DQ bit, in every beat of the burst at
+* Base.
+*
+* @param	Base is the bus address of a 64 byte burst, followed by
+*		another burst used as decoy
+* @param	ResultPtr accumulates the stuck DQ bits, see Screen_Reset
+*
+* @return
+*		- XST_SUCCESS if every DQ bit follows the data written
+*		- XST_FAILURE otherwise
+*
+******************************************************************************/
+int Screen_DataLines(UINTPTR Base, ScreenResult *ResultPtr)
+{
+	volatile u64 *Burst = (volatile u64 *)Hal_Ptr(Base);
+	volatile u64 *Decoy = (volatile u64 *)Hal_Ptr(Base + SCREEN_DECOY_OFFSET);
+	u64 Start = Hal_TimeNow();
+	u32 Beat;
+	u32 Bit;
+
+	for (Beat = 0; Beat < SCREEN_BURST_WORDS; Beat++) {
+		for (Bit = 0; Bit < 64U; Bit++) {
+			ScreenCheckWord(&Burst[Beat], &Decoy[Beat], 1ULL << Bit,
+				ResultPtr);
+			ScreenCheckWord(&Burst[Beat], &Decoy[Beat], ~(1ULL << Bit),
+				ResultPtr);
+		}
+	}
+
+	ResultPtr->Ticks += Hal_TimeNow() - Start;
+
+	return (ResultPtr->DataStuckHigh | ResultPtr->DataStuckLow) ?
+		XST_FAILURE : XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Check that every address bit of a range selects its own location.
+*
+* @param	Base is the bus address of the range, aligned to the largest
+*		power of two below Size
+* @param	Size is the number of bytes in the range
+* @param	ResultPtr accumulates the bad address bits, see Screen_Reset
+*
+* @return
+*		- XST_SUCCESS if no two tested locations alias
+*		- XST_FAILURE otherwise
+*
+* @note		Overwrites one word at Base and at each power of two offset.
+*
+******************************************************************************/
+int Screen_AddressLines(UINTPTR Base, u64 Size, ScreenResult *ResultPtr)
+{
+	u64 Start = Hal_TimeNow();
+	u32 NumBits = 0;
+
+	while ((1ULL << (NumBits + SCREEN_MIN_ADDR_BIT)) < Size) {
+		NumBits++;
+	}
+	ResultPtr->AddrBits = NumBits;
+
+	ScreenAddrPass(Base, NumBits, 0, ResultPtr);
+	ScreenAddrPass(Base, NumBits, 1, ResultPtr);
+
+	ResultPtr->Ticks += Hal_TimeNow() - Start;
+
+	return (ResultPtr->AddrBad || ResultPtr->AddrCorrupt) ?
+		XST_FAILURE : XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Print the outcome of the screens.
+*
+* @param	ResultPtr is the result of Screen_DataLines and
+*		Screen_AddressLines
+*
+* @return	None
+*
+******************************************************************************/
+void Screen_PrintResult(const ScreenResult *ResultPtr)
+{
+	u32 Bit;
+
+	xil_printf("  %d accesses in %lu us, address bits %d-%d\r\n",
+		ResultPtr->Accesses, (unsigned long)HAL_TICKS_TO_US(ResultPtr->Ticks),
+		SCREEN_MIN_ADDR_BIT, SCREEN_MIN_ADDR_BIT + ResultPtr->AddrBits - 1U);
+
+	if (ResultPtr->DataStuckHigh) {
+		xil_printf("  DQ bits reading 1: 0x%016lx\r\n",
+			ResultPtr->DataStuckHigh);
+	}
+	if (ResultPtr->DataStuckLow) {
+		xil_printf("  DQ bits reading 0: 0x%016lx\r\n",
+			ResultPtr->DataStuckLow);
+	}
+
+	for (Bit = 0; Bit < 64U; Bit++) {
+		if (ResultPtr->AddrBad & (1ULL << Bit)) {
+			xil_printf("  address bit %d stuck or shorted\r\n", Bit);
+		}
+	}
+	if (ResultPtr->AddrCorrupt) {
+		xil_printf("  %d address reads matched no tag\r\n",
+			ResultPtr->AddrCorrupt);
+	}
+}
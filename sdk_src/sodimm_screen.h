@@ -0,0 +1,56 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_screen.h
+ *
+ * Quick screen of the PL DDR4 data and address lines.
+ *
+ * A DIMM with a dead DQ or address line fails every bulk test, but only
+ * after sweeping the whole range. The screen finds those parts with a few
+ * hundred CPU accesses:
+ *
+ * - Screen_DataLines walks a one and a zero across the 64 DQ bits, in every
+ *   beat of one burst.
+ * - Screen_AddressLines writes a tag at the base and at every power of two
+ *   offset of the range, once in ascending and once in descending order,
+ *   and reads them back. A stuck or shorted address bit makes two of these
+ *   locations alias, and the tag read back names the other one.
+ *
+ * Every bus address bit above the 64-bit word is a row, column, bank, bank
+ * group or rank bit of the DIMM, so this covers all of them in O(log N)
+ * accesses. The range must be mapped non-cacheable so every access reaches
+ * the DIMM, see Hal_CpuMapRange.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_SCREEN_H
+#define SODIMM_SCREEN_H
+
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+#define SCREEN_BURST_WORDS	8U	/* beats of one DDR4 burst, 64-bit each */
+
+/* Lowest address bit tested, the 64-bit word */
+#define SCREEN_MIN_ADDR_BIT	3U
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u64 DataStuckHigh;	/* DQ bits that read 1 when written 0 */
+	u64 DataStuckLow;	/* DQ bits that read 0 when written 1 */
+	u64 AddrBad;		/* address bits, as an offset mask, that alias */
+	u32 AddrCorrupt;	/* reads that matched no tag at all */
+	u32 AddrBits;		/* address bits tested */
+	u32 Accesses;		/* reads and writes issued */
+	u64 Ticks;		/* Hal_TimeNow ticks of both screens */
+} ScreenResult;
+
+/************************** Function Prototypes ******************************/
+
+void Screen_Reset(ScreenResult *ResultPtr);
+int Screen_DataLines(UINTPTR Base, ScreenResult *ResultPtr);
+int Screen_AddressLines(UINTPTR Base, u64 Size, ScreenResult *ResultPtr);
+void Screen_PrintResult(const ScreenResult *ResultPtr);
+
+#endif /* SODIMM_SCREEN_H */
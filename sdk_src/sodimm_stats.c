@@ -0,0 +1,288 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_stats.c
+ *
+ * Per-batch timing of the SODIMM tests, see sodimm_stats.h.
+ *
+ * Recording a batch is a handful of adds and one bucket lookup per phase,
+ * so it can run for every batch of a full range sweep. All the divisions
+ * are left to Stats_PrintRun.
+ *
+ ****************************************************************************/
+#include "sodimm_stats.h"
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/******************** Constant Definitions **********************************/
+
+#define STATS_BAR_LEN		40U	/* characters of the fastest region */
+
+/* Regions this far below the run average are flagged, in percent */
+#define STATS_SLOW_REGION_PCT	90U
+
+/************************** Variable Definitions *****************************/
+
+static const char *StatsPhaseName[STATS_NUM_PHASES] = {
+	"setup", "dma", "verify", "latency"
+};
+
+/*****************************************************************************/
+/*
+* Histogram bucket of a sample. Samples below STATS_HIST_SUB get a bucket
+* each, above that every power of two is split in STATS_HIST_SUB buckets.
+*
+******************************************************************************/
+static u32 StatsBucket(u64 Ticks)
+{
+	u32 Msb;
+	u32 Index;
+
+	if (Ticks < STATS_HIST_SUB) {
+		return (u32)Ticks;
+	}
+
+	Msb = 63U - (u32)__builtin_clzll(Ticks);
+	Index = (Msb - STATS_HIST_SUB_BITS + 1U) * STATS_HIST_SUB +
+		(u32)((Ticks >> (Msb - STATS_HIST_SUB_BITS)) &
+		(STATS_HIST_SUB - 1U));
+
+	return Index < STATS_HIST_BUCKETS ? Index : STATS_HIST_BUCKETS - 1U;
+}
+
+/* Largest sample that falls in bucket Index */
+static u64 StatsBucketTop(u32 Index)
+{
+	u32 Shift;
+
+	if (Index < STATS_HIST_SUB) {
+		return Index;
+	}
+
+	Shift = Index / STATS_HIST_SUB - 1U;
+
+	return (((u64)(STATS_HIST_SUB + Index % STATS_HIST_SUB) + 1U) << Shift) - 1U;
+}
+
+static void StatsHistAdd(StatsHist *HistPtr, u64 Ticks)
+{
+	if (HistPtr->Samples == 0 || Ticks < HistPtr->MinTicks) {
+		HistPtr->MinTicks = Ticks;
+	}
+	if (Ticks > HistPtr->MaxTicks) {
+		HistPtr->MaxTicks = Ticks;
+	}
+	HistPtr->SumTicks += Ticks;
+	HistPtr->Samples++;
+	HistPtr->Count[StatsBucket(Ticks)]++;
+}
+
+/* Ticks to tenths of a microsecond */
+static unsigned long StatsUsX10(u64 Ticks)
+{
+	return (unsigned long)(Ticks * 10000000ULL / HAL_TICKS_PER_SEC);
+}
+
+/* Bytes per microsecond is MB/s */
+static unsigned long StatsMBps(u64 Bytes, u64 Ticks)
+{
+	u64 Us = HAL_TICKS_TO_US(Ticks);
+
+	return (unsigned long)(Us ? Bytes / Us : 0);
+}
+
+/*****************************************************************************/
+/**
+* Clear a run before its first batch.
+*
+* @param	RunPtr is the run to clear
+* @param	Name names the test in the summary
+* @param	Direction names the transfer direction
+* @param	Base is the PL DDR4 bus address of the tested range
+* @param	Size is the number of bytes in the range, split in
+*		STATS_NUM_REGIONS regions for the bandwidth histogram
+*
+* @return	None
+*
+******************************************************************************/
+void Stats_RunInit(StatsRun *RunPtr, const char *Name,
+		const char *Direction, UINTPTR Base, u64 Size)
+{
+	memset(RunPtr, 0, sizeof(*RunPtr));
+	RunPtr->Name = Name;
+	RunPtr->Direction = Direction;
+	RunPtr->Base = Base;
+	RunPtr->Size = Size;
+}
+
+/*****************************************************************************/
+/**
+* Add one finished batch to a run.
+*
+* @param	RunPtr is the run to update
+* @param	BatchPtr holds the timestamps of the batch, all taken
+*
+* @return	None
+*
+* @note		Not thread safe, CPUs sharing a run must serialize.
+*
+******************************************************************************/
+void Stats_RecordBatch(StatsRun *RunPtr, const StatsBatch *BatchPtr)
+{
+	u64 DmaTicks = BatchPtr->DmaDone - BatchPtr->DmaStart;
+	u32 Region = 0;
+
+	StatsHistAdd(&RunPtr->Phase[STATS_PHASE_SETUP],
+		BatchPtr->Submit - BatchPtr->SetupStart);
+	StatsHistAdd(&RunPtr->Phase[STATS_PHASE_DMA], DmaTicks);
+	StatsHistAdd(&RunPtr->Phase[STATS_PHASE_VERIFY],
+		BatchPtr->VerifyDone - BatchPtr->VerifyStart);
+	StatsHistAdd(&RunPtr->Phase[STATS_PHASE_LATENCY],
+		BatchPtr->DmaDone - BatchPtr->Submit);
+
+	if (RunPtr->Batches == 0 || BatchPtr->SetupStart < RunPtr->FirstTick) {
+		RunPtr->FirstTick = BatchPtr->SetupStart;
+	}
+	if (BatchPtr->VerifyDone > RunPtr->LastTick) {
+		RunPtr->LastTick = BatchPtr->VerifyDone;
+	}
+	RunPtr->Bytes += BatchPtr->Length;
+	RunPtr->Batches++;
+
+	if (BatchPtr->PlAddr >= RunPtr->Base &&
+	    BatchPtr->PlAddr - RunPtr->Base < RunPtr->Size) {
+		Region = (u32)((BatchPtr->PlAddr - RunPtr->Base) *
+			STATS_NUM_REGIONS / RunPtr->Size);
+	}
+	RunPtr->Region[Region].Bytes += BatchPtr->Length;
+	RunPtr->Region[Region].DmaTicks += DmaTicks;
+	RunPtr->Region[Region].Batches++;
+}
+
+/*****************************************************************************/
+/**
+* Read a percentile from a phase histogram.
+*
+* @param	HistPtr is the histogram
+* @param	Permille is the percentile in tenths of a percent, 500 is the
+*		median
+*
+* @return	Upper bound of the bucket holding the percentile, in ticks,
+*		never above the largest sample. 0 if the histogram is empty.
+*
+******************************************************************************/
+u64 Stats_Percentile(const StatsHist *HistPtr, u32 Permille)
+{
+	u64 Target;
+	u64 Seen = 0;
+	u32 Index;
+
+	if (HistPtr->Samples == 0) {
+		return 0;
+	}
+
+	Target = ((u64)HistPtr->Samples * Permille + 999U) / 1000U;
+	if (Target == 0) {
+		Target = 1;
+	}
+
+	for (Index = 0; Index < STATS_HIST_BUCKETS; Index++) {
+		Seen += HistPtr->Count[Index];
+		if (Seen >= Target) {
+			break;
+		}
+	}
+
+	if (Index == STATS_HIST_BUCKETS || StatsBucketTop(Index) > HistPtr->MaxTicks) {
+		return HistPtr->MaxTicks;
+	}
+
+	return StatsBucketTop(Index);
+}
+
+/*****************************************************************************/
+/**
+* Print the summary of a run: throughput, per-phase latency percentiles and
+* the DMA bandwidth of every region of the range. Regions that fall below
+* STATS_SLOW_REGION_PCT of the run's DMA bandwidth are marked "slow".
+*
+* @param	RunPtr is the run to print
+*
+* @return	None
+*
+******************************************************************************/
+void Stats_PrintRun(const StatsRun *RunPtr)
+{
+	const StatsHist *DmaHist = &RunPtr->Phase[STATS_PHASE_DMA];
+	unsigned long RunMBps;
+	unsigned long MaxMBps = 0;
+	unsigned long MBps;
+	UINTPTR RegionBase;
+	u64 RegionSize = RunPtr->Size / STATS_NUM_REGIONS;
+	u32 Index;
+	u32 Bar;
+
+	if (RunPtr->Batches == 0) {
+		return;
+	}
+
+	RunMBps = StatsMBps(RunPtr->Bytes, DmaHist->SumTicks);
+
+	xil_printf("%s, %s: %d batches, %luMB\r\n", RunPtr->Name,
+		RunPtr->Direction, RunPtr->Batches,
+		(unsigned long)(RunPtr->Bytes >> 20));
+	xil_printf("  wall %lu MB/s, dma %lu MB/s\r\n",
+		StatsMBps(RunPtr->Bytes, RunPtr->LastTick - RunPtr->FirstTick),
+		RunMBps);
+
+	xil_printf("  us per batch       p50       p90       p99       max\r\n");
+	for (Index = 0; Index < STATS_NUM_PHASES; Index++) {
+		const StatsHist *HistPtr = &RunPtr->Phase[Index];
+		u64 P50 = Stats_Percentile(HistPtr, 500);
+		u64 P90 = Stats_Percentile(HistPtr, 900);
+		u64 P99 = Stats_Percentile(HistPtr, 990);
+
+		xil_printf("  %-10s %7lu.%lu %7lu.%lu %7lu.%lu %7lu.%lu\r\n",
+			StatsPhaseName[Index],
+			StatsUsX10(P50) / 10, StatsUsX10(P50) % 10,
+			StatsUsX10(P90) / 10, StatsUsX10(P90) % 10,
+			StatsUsX10(P99) / 10, StatsUsX10(P99) % 10,
+			StatsUsX10(HistPtr->MaxTicks) / 10,
+			StatsUsX10(HistPtr->MaxTicks) % 10);
+	}
+
+	for (Index = 0; Index < STATS_NUM_REGIONS; Index++) {
+		MBps = StatsMBps(RunPtr->Region[Index].Bytes,
+			RunPtr->Region[Index].DmaTicks);
+		if (MBps > MaxMBps) {
+			MaxMBps = MBps;
+		}
+	}
+
+	xil_printf("  dma MB/s by region\r\n");
+	for (Index = 0; Index < STATS_NUM_REGIONS; Index++) {
+		const StatsRegion *RegionPtr = &RunPtr->Region[Index];
+
+		if (RegionPtr->Batches == 0) {
+			continue;
+		}
+
+		MBps = StatsMBps(RegionPtr->Bytes, RegionPtr->DmaTicks);
+		RegionBase = RunPtr->Base + (UINTPTR)(RegionSize * Index);
+		xil_printf("  0x%09lx %6lu ", RegionBase, MBps);
+		for (Bar = 0; MaxMBps && Bar < MBps * STATS_BAR_LEN / MaxMBps; Bar++) {
+			xil_printf("#");
+		}
+		if (MBps * 100U < RunMBps * STATS_SLOW_REGION_PCT) {
+			xil_printf(" slow");
+		}
+		xil_printf("\r\n");
+	}
+	xil_printf("\r\n");
+}
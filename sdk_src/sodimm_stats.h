@@ -0,0 +1,99 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_stats.h
+ *
+ * Per-batch timing of the SODIMM tests.
+ *
+ * Every batch is timestamped with Hal_TimeNow (the ARM global timer on the
+ * board) as it goes through three phases:
+ *
+ * - setup  : the CPU writes the source pattern and queues the BDs
+ * - dma    : the CDMA moves the batch, from the later of its submit and the
+ *            end of the previous batch, to its completion
+ * - verify : the CPU checks the destination
+ *
+ * plus its latency, from submit to completion, which includes the time the
+ * batch waits behind the batches queued before it.
+ *
+ * A StatsRun collects the batches of one test in one direction. It keeps a
+ * log-linear histogram per phase, from which percentiles are read, and the
+ * DMA bandwidth of each of STATS_NUM_REGIONS equal slices of the tested
+ * range. Nothing is allocated, a run is a fixed size structure.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_STATS_H
+#define SODIMM_STATS_H
+
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+/* Histogram resolution: 2^STATS_HIST_SUB_BITS buckets per power of two, so
+ * a percentile is within 12.5% of the real value.
+ */
+#define STATS_HIST_SUB_BITS	3U
+#define STATS_HIST_SUB		(1U << STATS_HIST_SUB_BITS)
+
+/* Covers samples up to 2^48 ticks */
+#define STATS_HIST_BUCKETS	((48U - STATS_HIST_SUB_BITS + 1U) * STATS_HIST_SUB)
+
+#define STATS_PHASE_SETUP	0
+#define STATS_PHASE_DMA		1
+#define STATS_PHASE_VERIFY	2
+#define STATS_PHASE_LATENCY	3
+#define STATS_NUM_PHASES	4
+
+/* Slices of the tested range in the bandwidth histogram */
+#define STATS_NUM_REGIONS	16U
+
+/**************************** Type Definitions *******************************/
+
+/* Timestamps of one batch, in Hal_TimeNow ticks */
+typedef struct {
+	UINTPTR PlAddr;		/* PL DDR4 side of the batch */
+	u32 Length;		/* bytes moved */
+	u64 SetupStart;		/* fill begins */
+	u64 Submit;		/* BDs handed to the CDMA */
+	u64 DmaStart;		/* CDMA starts on the batch */
+	u64 DmaDone;		/* completion seen by the CPU */
+	u64 VerifyStart;
+	u64 VerifyDone;
+} StatsBatch;
+
+typedef struct {
+	u32 Count[STATS_HIST_BUCKETS];
+	u32 Samples;
+	u64 MinTicks;
+	u64 MaxTicks;
+	u64 SumTicks;
+} StatsHist;
+
+typedef struct {
+	u64 Bytes;
+	u64 DmaTicks;
+	u32 Batches;
+} StatsRegion;
+
+typedef struct {
+	const char *Name;	/* test */
+	const char *Direction;	/* transfer direction of the test */
+	UINTPTR Base;		/* range mapped by Region */
+	u64 Size;
+	u64 Bytes;		/* moved by all batches */
+	u64 FirstTick;		/* earliest SetupStart */
+	u64 LastTick;		/* latest VerifyDone */
+	u32 Batches;
+	StatsHist Phase[STATS_NUM_PHASES];
+	StatsRegion Region[STATS_NUM_REGIONS];
+} StatsRun;
+
+/************************** Function Prototypes ******************************/
+
+void Stats_RunInit(StatsRun *RunPtr, const char *Name,
+		const char *Direction, UINTPTR Base, u64 Size);
+void Stats_RecordBatch(StatsRun *RunPtr, const StatsBatch *BatchPtr);
+u64 Stats_Percentile(const StatsHist *HistPtr, u32 Permille);
+void Stats_PrintRun(const StatsRun *RunPtr);
+
+#endif /* SODIMM_STATS_H */
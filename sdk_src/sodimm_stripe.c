@@ -0,0 +1,233 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_stripe.c
+ *
+ * Multi-CDMA striped transfers, see sodimm_stripe.h.
+ *
+ ****************************************************************************/
+#include "sodimm_stripe.h"
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+/*****************************************************************************/
+/**
+* Bring up NumEngines engines, each with a fresh free-form BD ring.
+*
+* @param	SchedPtr is the scheduler to set up
+* @param	DeviceId is the Device Id of the first engine, the others
+*		follow it
+* @param	NumEngines is the number of engines to stripe over, at most
+*		Hal_CdmaCount()
+* @param	StripeLen is the number of bytes per stripe
+* @param	BdLen is the number of bytes per BD, StripeLen must be a
+*		multiple of it
+*
+* @return
+*		- XST_SUCCESS if every engine is ready
+*		- XST_FAILURE otherwise
+*
+* @note		The rings are polled. Any chains or interrupt set up on the
+*		engines before are gone.
+*
+******************************************************************************/
+int Stripe_Init(StripeSched *SchedPtr, u16 DeviceId, int NumEngines,
+		u32 StripeLen, u32 BdLen)
+{
+	int Engine;
+	int Status;
+
+	if (NumEngines < 1 || NumEngines > Hal_CdmaCount() || BdLen == 0 ||
+	    StripeLen % BdLen) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Bad stripe setup %d x %u/%u\r\n",
+			NumEngines, StripeLen, BdLen);
+		return XST_FAILURE;
+	}
+
+	memset(SchedPtr, 0, sizeof(*SchedPtr));
+	SchedPtr->NumEngines = NumEngines;
+	SchedPtr->StripeLen = StripeLen;
+	SchedPtr->BdLen = BdLen;
+
+	for (Engine = 0; Engine < NumEngines; Engine++) {
+		StripeEngine *EnginePtr = &SchedPtr->Engine[Engine];
+
+		EnginePtr->Cdma = Hal_CdmaInitialize(DeviceId + Engine);
+		if (EnginePtr->Cdma == NULL) {
+			return XST_FAILURE;
+		}
+
+		Status = Hal_BdRingCreate(EnginePtr->Cdma);
+		if (Status != XST_SUCCESS) {
+			xdbg_printf(XDBG_DEBUG_ERROR,
+			    "Create BD ring of engine %d failed\r\n", Engine);
+			return XST_FAILURE;
+		}
+	}
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/*
+* Queue the next BDs of an engine, up to STRIPE_SUBMIT_BDS and never past
+* its last stripe.
+*
+* @return	XST_SUCCESS, or XST_FAILURE if the engine refused them
+*
+******************************************************************************/
+static int StripeSubmit(StripeSched *SchedPtr, StripeEngine *EnginePtr,
+		UINTPTR PlAddr, u64 NumStripes, UINTPTR PsAddr, u64 PsSize,
+		int Write)
+{
+	HalXfer Xfer[STRIPE_SUBMIT_BDS];
+	u32 BdsPerStripe = SchedPtr->StripeLen / SchedPtr->BdLen;
+	u32 NumBd = 0;
+	u64 Offset;
+	u64 PlOffset;
+
+	while (NumBd < STRIPE_SUBMIT_BDS && EnginePtr->NextStripe < NumStripes) {
+		Offset = EnginePtr->NextStripe * SchedPtr->StripeLen +
+			(u64)EnginePtr->NextBd * SchedPtr->BdLen;
+		PlOffset = SchedPtr->Layout == NULL ? Offset :
+			SchedPtr->Layout(SchedPtr->LayoutRef,
+				Offset / SchedPtr->BdLen);
+
+		Xfer[NumBd].SrcAddr = Write ? PsAddr + (UINTPTR)(Offset % PsSize) :
+			PlAddr + (UINTPTR)PlOffset;
+		Xfer[NumBd].DstAddr = Write ? PlAddr + (UINTPTR)PlOffset :
+			PsAddr + (UINTPTR)(Offset % PsSize);
+		Xfer[NumBd].Length = SchedPtr->BdLen;
+		NumBd++;
+
+		if (++EnginePtr->NextBd == BdsPerStripe) {
+			EnginePtr->NextBd = 0;
+			EnginePtr->NextStripe += SchedPtr->NumEngines;
+		}
+	}
+
+	if (Hal_BdRingSubmit(EnginePtr->Cdma, Xfer, NumBd) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+	EnginePtr->Queued += NumBd;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Lay the PL DDR4 side of the next runs out with Layout instead of walking
+* the range linearly.
+*
+* @param	SchedPtr is a scheduler set up by Stripe_Init
+* @param	Layout returns the offset from PlAddr of every BD of a run,
+*		NULL to go back to the linear range
+* @param	LayoutRef is passed to Layout
+*
+* @return	None
+*
+******************************************************************************/
+void Stripe_SetLayout(StripeSched *SchedPtr, StripeLayoutFn Layout,
+		void *LayoutRef)
+{
+	SchedPtr->Layout = Layout;
+	SchedPtr->LayoutRef = LayoutRef;
+}
+
+/*****************************************************************************/
+/**
+* Move a PL DDR4 range to or from a PS DDR window, striped over the
+* engines of the scheduler.
+*
+* @param	SchedPtr is a scheduler set up by Stripe_Init
+* @param	PlAddr is the bus address of the PL DDR4 range
+* @param	Size is the number of bytes, a multiple of the stripe length.
+*		With a layout it is the bytes moved, the BDs go where the
+*		layout puts them.
+* @param	PsAddr is the bus address of the PS DDR window
+* @param	PsSize is the size of the window, a multiple of the BD length.
+*		Byte n of the range pairs with byte n % PsSize of the window.
+*		The window may also be another part of the PL DDR4, which
+*		turns a write into a PL->PL copy.
+* @param	Write is 1 to copy the window into the range, 0 to copy the
+*		range into the window
+*
+* @return
+*		- XST_SUCCESS if every BD completed
+*		- XST_FAILURE on a submit or transfer error
+*
+* @note		Per engine BD counts and times are left in SchedPtr->Engine.
+*
+******************************************************************************/
+int Stripe_Run(StripeSched *SchedPtr, UINTPTR PlAddr, u64 Size,
+		UINTPTR PsAddr, u64 PsSize, int Write)
+{
+	u64 NumStripes = Size / SchedPtr->StripeLen;
+	u64 TotalBds = Size / SchedPtr->BdLen;
+	u64 Reaped = 0;
+	u64 Start;
+	int Engine;
+	int BdCount;
+
+	if (Size % SchedPtr->StripeLen || PsSize == 0 ||
+	    PsSize % SchedPtr->BdLen) {
+		xdbg_printf(XDBG_DEBUG_ERROR, "Bad stripe run 0x%lx + 0x%lx\r\n",
+			PlAddr, Size);
+		return XST_FAILURE;
+	}
+
+	for (Engine = 0; Engine < SchedPtr->NumEngines; Engine++) {
+		StripeEngine *EnginePtr = &SchedPtr->Engine[Engine];
+
+		EnginePtr->NextStripe = Engine;
+		EnginePtr->NextBd = 0;
+		EnginePtr->Queued = 0;
+		EnginePtr->Bds = 0;
+		EnginePtr->Ticks = 0;
+	}
+
+	Start = Hal_TimeNow();
+	while (Reaped < TotalBds) {
+		/* Top every engine up first, then collect from all of them */
+		for (Engine = 0; Engine < SchedPtr->NumEngines; Engine++) {
+			StripeEngine *EnginePtr = &SchedPtr->Engine[Engine];
+
+			while (EnginePtr->NextStripe < NumStripes &&
+			       EnginePtr->Queued + STRIPE_SUBMIT_BDS <=
+			       STRIPE_MAX_QUEUED) {
+				if (StripeSubmit(SchedPtr, EnginePtr, PlAddr,
+						NumStripes, PsAddr, PsSize,
+						Write) != XST_SUCCESS) {
+					xdbg_printf(XDBG_DEBUG_ERROR,
+					    "Submit to engine %d failed\r\n", Engine);
+					return XST_FAILURE;
+				}
+			}
+		}
+
+		for (Engine = 0; Engine < SchedPtr->NumEngines; Engine++) {
+			StripeEngine *EnginePtr = &SchedPtr->Engine[Engine];
+
+			if (EnginePtr->Queued == 0) {
+				continue;
+			}
+
+			BdCount = Hal_BdRingReap(EnginePtr->Cdma);
+			if (BdCount < 0) {
+				xdbg_printf(XDBG_DEBUG_ERROR,
+				    "Transfer error on engine %d\r\n", Engine);
+				return XST_FAILURE;
+			}
+			if (BdCount) {
+				EnginePtr->Queued -= BdCount;
+				EnginePtr->Bds += BdCount;
+				EnginePtr->Ticks = Hal_TimeNow() - Start;
+				Reaped += BdCount;
+			}
+		}
+	}
+
+	return XST_SUCCESS;
+}
@@ -0,0 +1,71 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_stripe.h
+ *
+ * Striped transfers over several CDMA engines.
+ *
+ * One CDMA moves one BD at a time and cannot keep the SODIMM busy on its
+ * own. The scheduler cuts a PL DDR4 range into stripes of StripeLen bytes
+ * and deals them out round robin: stripe n goes to engine n % NumEngines.
+ * Every engine has its own BD ring and walks its stripes in address order,
+ * so each one still streams linearly. The CPU keeps up to
+ * STRIPE_MAX_QUEUED BDs queued on every engine and polls all of them for
+ * completions in turn.
+ *
+ * The PS DDR side of a transfer wraps inside a small window, so a write of
+ * the whole DIMM can be fed from one buffer.
+ *
+ * Stripe_SetLayout replaces the linear PL DDR4 side with any BD address
+ * layout, e.g. those of sodimm_traffic.h. The BDs are still dealt out a
+ * stripe at a time, so with one BD per stripe BD n of the layout runs on
+ * engine n % NumEngines, next to BDs n + 1 ... on the other engines.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_STRIPE_H
+#define SODIMM_STRIPE_H
+
+#include "sodimm_hal.h"
+
+/******************** Constant Definitions **********************************/
+
+#define STRIPE_SUBMIT_BDS	16U	/* BDs per Hal_BdRingSubmit */
+
+/* BDs queued per engine at most, well inside the ring of one of
+ * HAL_MAX_CDMAS engines
+ */
+#define STRIPE_MAX_QUEUED	256U
+
+/**************************** Type Definitions *******************************/
+
+/* Offset from PlAddr of the PL DDR4 side of BD Bd of a run */
+typedef u64 (*StripeLayoutFn)(void *Ref, u64 Bd);
+
+typedef struct {
+	HalCdma *Cdma;
+	u64 NextStripe;		/* next stripe of this engine to submit */
+	u32 NextBd;		/* next BD inside that stripe */
+	u32 Queued;		/* BDs submitted and not reaped yet */
+	u64 Bds;		/* BDs completed by the last Stripe_Run */
+	u64 Ticks;		/* from the start of the run to its last BD */
+} StripeEngine;
+
+typedef struct {
+	int NumEngines;
+	u32 StripeLen;		/* bytes per stripe, a multiple of BdLen */
+	u32 BdLen;		/* bytes per BD */
+	StripeLayoutFn Layout;	/* NULL for the linear range */
+	void *LayoutRef;
+	StripeEngine Engine[HAL_MAX_CDMAS];
+} StripeSched;
+
+/************************** Function Prototypes ******************************/
+
+int Stripe_Init(StripeSched *SchedPtr, u16 DeviceId, int NumEngines,
+		u32 StripeLen, u32 BdLen);
+void Stripe_SetLayout(StripeSched *SchedPtr, StripeLayoutFn Layout,
+		void *LayoutRef);
+int Stripe_Run(StripeSched *SchedPtr, UINTPTR PlAddr, u64 Size,
+		UINTPTR PsAddr, u64 PsSize, int Write);
+
+#endif /* SODIMM_STRIPE_H */
@@ -0,0 +1,128 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_traffic.c
+ *
+ * BD address layouts, see sodimm_traffic.h.
+ *
+ * Every layout keeps rank 0 and the rows below Rows, so the addresses stay
+ * inside [Base, Base + Size) whatever the mapping puts above the row bits.
+ *
+ ****************************************************************************/
+#include "sodimm_traffic.h"
+
+/******************** Constant Definitions **********************************/
+
+/* Banks the FAW storm cycles through, those of one rank */
+#define TRAFFIC_RANK_BANKS	(GEOM_BANK_GROUPS * GEOM_BANKS_PER_GROUP)
+
+/************************** Variable Definitions *****************************/
+
+static const char *TrafficNames[TRAFFIC_NUM_PATTERNS] = {
+	"linear 4K", "linear run", "row hit", "bg interleave", "row conflict",
+	"faw storm",
+};
+
+/*****************************************************************************/
+/**
+* Set up a layout.
+*
+* @param	GenPtr is the layout to set up
+* @param	Pattern is one of TRAFFIC_LINEAR ... TRAFFIC_FAW_STORM
+* @param	Base is the bus address of the PL DDR4. The coordinates are
+*		only those of the DIMM if it is offset 0 of the MIG.
+* @param	Size is the number of bytes from Base the BDs may touch
+*
+* @return
+*		- XST_SUCCESS if the layout is ready
+*		- XST_FAILURE if Size holds less than two rows of each bank
+*
+******************************************************************************/
+int Traffic_Init(TrafficGen *GenPtr, int Pattern, UINTPTR Base, u64 Size)
+{
+	GeomCoord Coord = { 0 };
+	u64 RowStride;
+	u64 Rows;
+
+	if (Pattern < 0 || Pattern >= TRAFFIC_NUM_PATTERNS ||
+	    Size % TRAFFIC_LINEAR_LEN) {
+		return XST_FAILURE;
+	}
+
+	/* Offset of row 1 of bank 0: everything below it is one row */
+	Coord.Row = 1;
+	RowStride = Geom_Encode(&Coord);
+	Rows = Size / RowStride;
+	if (Rows > GEOM_ROWS) {
+		Rows = GEOM_ROWS;
+	}
+	if (Rows < 2) {
+		return XST_FAILURE;
+	}
+
+	GenPtr->Pattern = Pattern;
+	GenPtr->Base = Base;
+	GenPtr->Size = Size;
+	GenPtr->Length = Pattern == TRAFFIC_LINEAR ? TRAFFIC_LINEAR_LEN :
+		Geom_RunBytes();
+	GenPtr->RowRuns = GEOM_ROW_BYTES / Geom_RunBytes();
+	GenPtr->Rows = (u32)Rows;
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+* Bus address of the PL DDR4 side of a BD.
+*
+* @param	GenPtr is the layout
+* @param	Index is the number of the BD, the layouts wrap around
+*
+* @return	Address of the first byte the BD moves
+*
+******************************************************************************/
+UINTPTR Traffic_Addr(const TrafficGen *GenPtr, u32 Index)
+{
+	GeomCoord Coord = { 0 };
+	u32 Run;
+
+	switch (GenPtr->Pattern) {
+	case TRAFFIC_ROW_HIT:
+		Run = Index % GenPtr->RowRuns;
+		Coord.Row = Index / GenPtr->RowRuns % GenPtr->Rows;
+		break;
+	case TRAFFIC_BG_INTERLEAVE:
+		Coord.BankGroup = (u8)(Index % GEOM_BANK_GROUPS);
+		Index /= GEOM_BANK_GROUPS;
+		Run = Index % GenPtr->RowRuns;
+		Coord.Row = Index / GenPtr->RowRuns % GenPtr->Rows;
+		break;
+	case TRAFFIC_ROW_CONFLICT:
+		Coord.Row = Index % GenPtr->Rows;
+		Run = Index / GenPtr->Rows % GenPtr->RowRuns;
+		break;
+	case TRAFFIC_FAW_STORM:
+		Coord.BankGroup = (u8)(Index % GEOM_BANK_GROUPS);
+		Coord.Bank = (u8)(Index / GEOM_BANK_GROUPS % GEOM_BANKS_PER_GROUP);
+		Index /= TRAFFIC_RANK_BANKS;
+		Coord.Row = Index % GenPtr->Rows;
+		Run = Index / GenPtr->Rows % GenPtr->RowRuns;
+		break;
+	default:
+		return GenPtr->Base + (UINTPTR)((u64)Index * GenPtr->Length %
+			GenPtr->Size);
+	}
+
+	Coord.Column = (u16)((Run * GenPtr->Length) >> GEOM_BYTE_WIDTH);
+
+	return GenPtr->Base + (UINTPTR)Geom_Encode(&Coord);
+}
+
+const char *Traffic_Name(int Pattern)
+{
+	if (Pattern < 0 || Pattern >= TRAFFIC_NUM_PATTERNS) {
+		return "?";
+	}
+
+	return TrafficNames[Pattern];
+}
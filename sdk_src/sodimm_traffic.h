@@ -0,0 +1,68 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_traffic.h
+ *
+ * Geometry-aware BD address layouts of the PL DDR4.
+ *
+ * DoTransfer walks the DIMM linearly in 4KB BDs, which the MIG spreads
+ * over every bank of a row before it opens the next one. The layouts below
+ * use the address mapping of sodimm_geometry.c to aim each BD at a chosen
+ * bank and row instead, so the CDMA sees one DRAM behaviour at a time:
+ *
+ * - TRAFFIC_LINEAR        4KB BDs in address order, as DoTransfer. Length
+ *                         may be changed after Traffic_Init to any divisor
+ *                         of Size.
+ * - TRAFFIC_LINEAR_RUN    short BDs in address order, the control for the
+ *                         layouts below
+ * - TRAFFIC_ROW_HIT       consecutive columns of one row of one bank
+ * - TRAFFIC_BG_INTERLEAVE the same row and column in each bank group in
+ *                         turn, bank group fastest
+ * - TRAFFIC_ROW_CONFLICT  one bank, another row on every BD
+ * - TRAFFIC_FAW_STORM     the 16 banks of rank 0 in turn, another row on
+ *                         every BD, so each BD is an activate and only
+ *                         tRRD and tFAW pace them
+ *
+ * All but TRAFFIC_LINEAR move Geom_RunBytes() per BD, the longest access
+ * that stays inside one row of one bank, 64 bytes with ROW_COLUMN_BANK. At
+ * that length the per-BD cost of the CDMA dominates, so a layout is only
+ * read against TRAFFIC_LINEAR_RUN, which pays the same per-BD cost in
+ * address order: what a layout loses against it comes from the DIMM, and
+ * only shows when several engines keep BDs in flight at once.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_TRAFFIC_H
+#define SODIMM_TRAFFIC_H
+
+#include "sodimm_geometry.h"
+
+/******************** Constant Definitions **********************************/
+
+#define TRAFFIC_LINEAR		0
+#define TRAFFIC_LINEAR_RUN	1
+#define TRAFFIC_ROW_HIT		2
+#define TRAFFIC_BG_INTERLEAVE	3
+#define TRAFFIC_ROW_CONFLICT	4
+#define TRAFFIC_FAW_STORM	5
+#define TRAFFIC_NUM_PATTERNS	6
+
+#define TRAFFIC_LINEAR_LEN	4096U	/* BD length of TRAFFIC_LINEAR */
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	int Pattern;
+	UINTPTR Base;		/* bus address of PL DDR4 offset 0 */
+	u64 Size;		/* bytes the layout stays inside */
+	u32 Length;		/* bytes per BD */
+	u32 RowRuns;		/* BDs that fit in one row of one bank */
+	u32 Rows;		/* rows of each bank inside Size */
+} TrafficGen;
+
+/************************** Function Prototypes ******************************/
+
+int Traffic_Init(TrafficGen *GenPtr, int Pattern, UINTPTR Base, u64 Size);
+UINTPTR Traffic_Addr(const TrafficGen *GenPtr, u32 Index);
+const char *Traffic_Name(int Pattern);
+
+#endif /* SODIMM_TRAFFIC_H */
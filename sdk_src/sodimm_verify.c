@@ -0,0 +1,229 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_verify.c
+ *
+ * Buffer compare kernel, see sodimm_verify.h.
+ *
+ * The hot loop only XORs and ORs a cache line worth of data and branches
+ * once per line, so a passing batch is compared at load bandwidth. The
+ * word-by-word scan that fills in the failure details only runs on the
+ * lines that differ.
+ *
+ ****************************************************************************/
+#include "sodimm_verify.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VERIFY_USE_NEON
+#endif
+
+#ifndef SODIMM_HOST_SIM
+#include "xenv.h"	/* memset */
+#endif
+
+#if (!defined(DEBUG))
+extern void xil_printf(const char *format, ...);
+#endif
+
+/*****************************************************************************/
+/**
+* Check whether one cache line of Expected and Actual differ.
+*
+* @param	Expected points to the first word of the expected line
+* @param	Actual points to the first word of the line read back
+*
+* @return	Non-zero if any bit of the line differs
+*
+******************************************************************************/
+static inline u64 VerifyLineDiff(const u64 *Expected, const u64 *Actual)
+{
+#ifdef VERIFY_USE_NEON
+	uint64x2_t Diff0;
+	uint64x2_t Diff1;
+
+	Diff0 = veorq_u64(vld1q_u64(Expected), vld1q_u64(Actual));
+	Diff1 = veorq_u64(vld1q_u64(Expected + 2), vld1q_u64(Actual + 2));
+	Diff0 = vorrq_u64(Diff0, veorq_u64(vld1q_u64(Expected + 4),
+		vld1q_u64(Actual + 4)));
+	Diff1 = vorrq_u64(Diff1, veorq_u64(vld1q_u64(Expected + 6),
+		vld1q_u64(Actual + 6)));
+	Diff0 = vorrq_u64(Diff0, Diff1);
+
+	return vgetq_lane_u64(Diff0, 0) | vgetq_lane_u64(Diff0, 1);
+#else
+	return ((Expected[0] ^ Actual[0]) | (Expected[1] ^ Actual[1]) |
+		(Expected[2] ^ Actual[2]) | (Expected[3] ^ Actual[3]) |
+		(Expected[4] ^ Actual[4]) | (Expected[5] ^ Actual[5]) |
+		(Expected[6] ^ Actual[6]) | (Expected[7] ^ Actual[7]));
+#endif
+}
+
+/*****************************************************************************/
+/**
+* Clear a result before a new compare.
+*
+* @param	ResultPtr is the result to clear
+*
+* @return	None
+*
+******************************************************************************/
+void Verify_Reset(VerifyResult *ResultPtr)
+{
+	memset(ResultPtr, 0, sizeof(*ResultPtr));
+}
+
+/*****************************************************************************/
+/**
+* Record a cache line known to differ: mark it in the bitmap and log its
+* bad words, also to ResultPtr->Log when set. Callers with their own compare
+* loop use this for the slow path.
+*
+* @param	Expected is the expected data of the line
+* @param	Actual is the data read back
+* @param	NumWords is the number of 64-bit words in the line
+* @param	Offset is the byte offset of the line in the buffer
+* @param	ResultPtr is updated with the failures
+*
+* @return	None
+*
+******************************************************************************/
+void Verify_RecordLine(const u64 *Expected, const u64 *Actual, u32 NumWords,
+		u32 Offset, VerifyResult *ResultPtr)
+{
+	u32 Index;
+	u32 Line = Offset / VERIFY_LINE_LEN;
+
+	if (Line < VERIFY_MAX_LEN / VERIFY_LINE_LEN) {
+		ResultPtr->LineBitmap[Line / 64U] |= 1ULL << (Line % 64U);
+	}
+	ResultPtr->BadLines++;
+
+	for (Index = 0; Index < NumWords; Index++) {
+		if (Expected[Index] == Actual[Index]) {
+			continue;
+		}
+
+		ResultPtr->BadWords++;
+		if (ResultPtr->Log) {
+			Fault_Record(ResultPtr->Log, ResultPtr->LogAddr + Offset +
+				Index * sizeof(u64), Expected[Index], Actual[Index]);
+		}
+		if (ResultPtr->NumFail < VERIFY_MAX_FAIL_OFFSETS) {
+			ResultPtr->FailOffset[ResultPtr->NumFail] =
+				Offset + Index * sizeof(u64);
+			ResultPtr->FailExpected[ResultPtr->NumFail] = Expected[Index];
+			ResultPtr->FailActual[ResultPtr->NumFail] = Actual[Index];
+			ResultPtr->NumFail++;
+		}
+	}
+}
+
+/*****************************************************************************/
+/**
+* Compare Length bytes of Actual against Expected and record where they
+* differ. The whole buffer is always compared, it does not stop at the first
+* mismatch.
+*
+* @param	Expected is the reference data, 8 byte aligned
+* @param	Actual is the data read back, 8 byte aligned
+* @param	Length is the number of bytes, a multiple of 8. Lines past
+*		VERIFY_MAX_LEN are counted but not mapped in LineBitmap.
+* @param	ResultPtr receives the mismatch bitmap and first failures
+*
+* @return	Number of 64-bit words that differ, 0 if the buffers match
+*
+* @note		The caller handles cache maintenance of both buffers.
+*
+******************************************************************************/
+u32 Verify_Compare(const void *Expected, const void *Actual, u32 Length,
+		VerifyResult *ResultPtr)
+{
+	Verify_Reset(ResultPtr);
+
+	return Verify_CompareChunk(Expected, Actual, Length, 0, ResultPtr);
+}
+
+/*****************************************************************************/
+/**
+* Compare one chunk of a larger buffer and add its failures to ResultPtr.
+* This lets a caller regenerate the expected data a small chunk at a time
+* instead of holding a full reference buffer.
+*
+* @param	Expected is the expected data of the chunk, 8 byte aligned
+* @param	Actual is the data read back, 8 byte aligned
+* @param	Length is the number of bytes in the chunk, a multiple of 8
+* @param	Offset is the byte offset of the chunk in the buffer, a
+*		multiple of VERIFY_LINE_LEN
+* @param	ResultPtr accumulates the failures, see Verify_Reset
+*
+* @return	Number of 64-bit words that differ so far in ResultPtr
+*
+* @note		None
+*
+******************************************************************************/
+u32 Verify_CompareChunk(const void *Expected, const void *Actual, u32 Length,
+		u32 Offset, VerifyResult *ResultPtr)
+{
+	const u64 *ExpPtr = (const u64 *)Expected;
+	const u64 *ActPtr = (const u64 *)Actual;
+	u32 Lines = Length / VERIFY_LINE_LEN;
+	u32 TailWords = (Length % VERIFY_LINE_LEN) / sizeof(u64);
+	u32 Line;
+
+	for (Line = 0; Line < Lines; Line++) {
+		if (VerifyLineDiff(ExpPtr, ActPtr)) {
+			Verify_RecordLine(ExpPtr, ActPtr, VERIFY_LINE_WORDS,
+				Offset + Line * VERIFY_LINE_LEN, ResultPtr);
+		}
+		ExpPtr += VERIFY_LINE_WORDS;
+		ActPtr += VERIFY_LINE_WORDS;
+	}
+
+	if (TailWords) {
+		u32 Index;
+
+		for (Index = 0; Index < TailWords; Index++) {
+			if (ExpPtr[Index] != ActPtr[Index]) {
+				Verify_RecordLine(ExpPtr, ActPtr, TailWords,
+					Offset + Lines * VERIFY_LINE_LEN,
+					ResultPtr);
+				break;
+			}
+		}
+	}
+
+	return ResultPtr->BadWords;
+}
+
+/*****************************************************************************/
+/**
+* Print the failures recorded by Verify_Compare.
+*
+* @param	ResultPtr is the result of the compare
+* @param	BaseAddr is the bus address the offsets are relative to
+*
+* @return	None
+*
+******************************************************************************/
+void Verify_PrintResult(const VerifyResult *ResultPtr, UINTPTR BaseAddr)
+{
+	u32 Index;
+
+	xil_printf("  %d bad words in %d cache lines\r\n",
+		ResultPtr->BadWords, ResultPtr->BadLines);
+
+	for (Index = 0; Index < ResultPtr->NumFail; Index++) {
+		xil_printf("  0x%lx: expected 0x%016lx read 0x%016lx\r\n",
+			BaseAddr + ResultPtr->FailOffset[Index],
+			ResultPtr->FailExpected[Index],
+			ResultPtr->FailActual[Index]);
+	}
+
+	for (Index = 0; Index < VERIFY_BITMAP_WORDS; Index++) {
+		if (ResultPtr->LineBitmap[Index]) {
+			xil_printf("  lines %d-%d: 0x%016lx\r\n", Index * 64,
+				Index * 64 + 63, ResultPtr->LineBitmap[Index]);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+/*****************************************************************************/
+/**
+ *
+ * @file sodimm_verify.h
+ *
+ * Buffer compare kernel used to verify every DMA batch.
+ *
+ * The compare runs one 64 byte cache line at a time with 128-bit NEON loads
+ * on the A53 (64-bit words elsewhere) and only drops to a word scan for the
+ * lines that differ. Besides pass/fail it reports which cache lines differ,
+ * as a bitmap, and the first VERIFY_MAX_FAIL_OFFSETS failing words.
+ *
+ ****************************************************************************/
+#ifndef SODIMM_VERIFY_H
+#define SODIMM_VERIFY_H
+
+#include "sodimm_fault.h"
+
+/******************** Constant Definitions **********************************/
+
+#define VERIFY_LINE_LEN		64U	/* A53 cache line */
+
+/* Largest buffer one Verify_Compare call can map in its line bitmap */
+#define VERIFY_MAX_LEN		(256U * 1024U)
+
+/* Failing words recorded per compare */
+#define VERIFY_MAX_FAIL_OFFSETS	8U
+
+#define VERIFY_LINE_WORDS	(VERIFY_LINE_LEN / sizeof(u64))
+
+#define VERIFY_BITMAP_WORDS	(VERIFY_MAX_LEN / VERIFY_LINE_LEN / 64U)
+
+/**************************** Type Definitions *******************************/
+
+/* Outcome of one Verify_Compare call. Offsets are in bytes from the start of
+ * the buffers and are 8 byte aligned.
+ */
+typedef struct {
+	u32 BadLines;		/* cache lines with at least one bad word */
+	u32 BadWords;		/* total number of 64-bit words that differ */
+	u32 NumFail;		/* entries used in the Fail* arrays */
+	u32 FailOffset[VERIFY_MAX_FAIL_OFFSETS];
+	u64 FailExpected[VERIFY_MAX_FAIL_OFFSETS];
+	u64 FailActual[VERIFY_MAX_FAIL_OFFSETS];
+	u64 LineBitmap[VERIFY_BITMAP_WORDS];	/* bit n set: line n differs */
+	FaultLog *Log;		/* every bad word is also recorded here, or NULL */
+	UINTPTR LogAddr;	/* PL DDR4 address of offset 0, for Log */
+} VerifyResult;
+
+/************************** Function Prototypes ******************************/
+
+u32 Verify_Compare(const void *Expected, const void *Actual, u32 Length,
+		VerifyResult *ResultPtr);
+u32 Verify_CompareChunk(const void *Expected, const void *Actual, u32 Length,
+		u32 Offset, VerifyResult *ResultPtr);
+void Verify_Reset(VerifyResult *ResultPtr);
+void Verify_RecordLine(const u64 *Expected, const u64 *Actual, u32 NumWords,
+		u32 Offset, VerifyResult *ResultPtr);
+void Verify_PrintResult(const VerifyResult *ResultPtr, UINTPTR BaseAddr);
+
+#endif /* SODIMM_VERIFY_H */